@@ -0,0 +1,247 @@
+#include "Benchmark.hpp"
+#include "AllocationCounting.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	AllocationStats allocationStats()
+	{
+		AllocationStats stats = { threadAllocationCount(), threadAllocationBytes() };
+		return stats;
+	}
+
+	uint64_t nowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	uint64_t peakRssBytes()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+#if defined(__APPLE__)
+		return (uint64_t)usage.ru_maxrss;
+#else
+		// kilobytes everywhere else
+		return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+	}
+
+	Arguments::Arguments(int argc, char **argv, int first)
+	{
+		for (int i = first; i < argc; ++i)
+		{
+			string arg(argv[i]);
+			if (arg.compare(0, 2, "--") != 0)
+			{
+				positionals.push_back(arg);
+				continue;
+			}
+			string::size_type equals = arg.find('=');
+			if (equals == string::npos)
+				named[arg.substr(2)] = "";
+			else
+				named[arg.substr(2, equals - 2)] = arg.substr(equals + 1);
+		}
+	}
+
+	bool Arguments::has(const string &name) const
+	{
+		return named.find(name) != named.end();
+	}
+
+	string Arguments::get(const string &name, const string &fallback) const
+	{
+		std::map<string, string>::const_iterator it = named.find(name);
+		return it == named.end() ? fallback : it->second;
+	}
+
+	double Arguments::getDouble(const string &name, double fallback) const
+	{
+		std::map<string, string>::const_iterator it = named.find(name);
+		return it == named.end() ? fallback : std::stod(it->second);
+	}
+
+	uint64_t Arguments::getSize(const string &name, uint64_t fallback) const
+	{
+		std::map<string, string>::const_iterator it = named.find(name);
+		return it == named.end() ? fallback : parseSize(it->second);
+	}
+
+	const std::vector<string> &Arguments::positional() const
+	{
+		return positionals;
+	}
+
+	uint64_t parseSize(const string &text)
+	{
+		std::size_t end = 0;
+		uint64_t size = std::stoull(text, &end);
+		if (end == text.size())
+			return size;
+		switch (text[end])
+		{
+		case 'k': case 'K':
+			return size << 10;
+		case 'm': case 'M':
+			return size << 20;
+		case 'g': case 'G':
+			return size << 30;
+		default:
+			throw std::invalid_argument("invalid size - " + text);
+		}
+	}
+
+	Format parseFormat(const Arguments &args)
+	{
+		string format = args.get("format", "text");
+		if (format == "json")
+			return Format::JSON;
+		if (format == "csv")
+			return Format::CSV;
+		if (format != "text")
+			throw std::invalid_argument("unknown --format - " + format);
+		return Format::TEXT;
+	}
+
+	void Suite::add(const string &name, Benchmark benchmark)
+	{
+		benchmarks.push_back(std::make_pair(name, benchmark));
+	}
+
+	std::vector<Result> Suite::run(const Arguments &args) const
+	{
+		string filter = args.get("filter", "");
+		double minTime = args.getDouble("min-time", 0.2);
+		int repetitions = (int)args.getDouble("repetitions", 5);
+		std::vector<Result> results;
+		for (std::size_t i = 0; i < benchmarks.size(); ++i)
+		{
+			if (benchmarks[i].first.find(filter) == string::npos)
+				continue;
+			results.push_back(measure(benchmarks[i].first, benchmarks[i].second, minTime, std::max(repetitions, 1)));
+		}
+		return results;
+	}
+
+	Result Suite::measure(const string &name, const Benchmark &benchmark, double minTime, int repetitions) const
+	{
+		// warm up and find an iteration count which runs for at least minTime
+		uint64_t iterations = 1;
+		uint64_t minNs = (uint64_t)(minTime * 1e9);
+		for (;;)
+		{
+			uint64_t start = nowNs();
+			benchmark(iterations);
+			uint64_t elapsed = nowNs() - start;
+			if (elapsed >= minNs)
+				break;
+			uint64_t next = elapsed > 0 ? (uint64_t)(iterations * 1.2 * minNs / elapsed) : iterations * 100;
+			iterations = std::max(iterations * 2, std::min(next, iterations * 100));
+		}
+
+		std::vector<double> nsPerOp;
+		nsPerOp.reserve(repetitions);
+		AllocationStats before = allocationStats();
+		for (int run = 0; run < repetitions; ++run)
+		{
+			uint64_t start = nowNs();
+			benchmark(iterations);
+			nsPerOp.push_back((double)(nowNs() - start) / iterations);
+		}
+		AllocationStats after = allocationStats();
+		std::sort(nsPerOp.begin(), nsPerOp.end());
+
+		double ops = (double)iterations * repetitions;
+		Result result = { name, iterations, nsPerOp[nsPerOp.size() / 2],
+			(after.count - before.count) / ops, (after.bytes - before.bytes) / ops };
+		return result;
+	}
+
+	void report(const std::vector<Result> &results, Format format, std::ostream &out)
+	{
+		switch (format)
+		{
+		case Format::JSON:
+			out << "{\"benchmarks\":[";
+			for (std::size_t i = 0; i < results.size(); ++i)
+			{
+				const Result &r = results[i];
+				out << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.name) << "\",\"iterations\":" << r.iterations
+					<< ",\"ns_per_op\":" << r.nsPerOp << ",\"allocs_per_op\":" << r.allocsPerOp
+					<< ",\"bytes_per_op\":" << r.bytesPerOp << "}";
+			}
+			out << "\n]}\n";
+			break;
+		case Format::CSV:
+			out << "name,iterations,ns_per_op,allocs_per_op,bytes_per_op\n";
+			for (const Result &r : results)
+				out << r.name << "," << r.iterations << "," << r.nsPerOp << "," << r.allocsPerOp << "," << r.bytesPerOp << "\n";
+			break;
+		case Format::TEXT:
+			out << std::left << std::setw(48) << "benchmark" << std::right << std::setw(14) << "ns/op"
+				<< std::setw(14) << "allocs/op" << std::setw(14) << "bytes/op" << std::setw(14) << "iterations" << "\n";
+			for (const Result &r : results)
+			{
+				out << std::left << std::setw(48) << r.name << std::right << std::fixed << std::setprecision(1)
+					<< std::setw(14) << r.nsPerOp << std::setprecision(2) << std::setw(14) << r.allocsPerOp
+					<< std::setprecision(1) << std::setw(14) << r.bytesPerOp << std::setw(14) << r.iterations << "\n";
+				out.unsetf(std::ios::fixed);
+			}
+			break;
+		}
+		out.flush();
+	}
+
+	string jsonEscape(const string &text)
+	{
+		string escaped;
+		escaped.reserve(text.size());
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20)
+				{
+					char buffer[8];
+					std::snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned)(unsigned char)c);
+					escaped += buffer;
+				}
+				else
+					escaped += c;
+			}
+		}
+		return escaped;
+	}
+
+}
+}
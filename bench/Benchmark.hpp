@@ -0,0 +1,105 @@
+#ifndef BENCHMARK_HPP
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace luapath{
+namespace bench{
+
+	/** @brief Running totals of the global operator new calls made by the current thread*/
+	struct AllocationStats
+	{
+		std::uint64_t count;
+		std::uint64_t bytes;
+	};
+
+	AllocationStats allocationStats();
+
+	/** Keeps the compiler from optimizing away the computation of @p value*/
+	template<class T>
+	inline void doNotOptimize(const T &value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		const volatile T *sink = &value;
+		(void)sink;
+#endif
+	}
+
+	/** Nanoseconds from a monotonic clock*/
+	std::uint64_t nowNs();
+
+	/** The peak resident set size of the process in bytes or 0 if the platform doesn't report it*/
+	std::uint64_t peakRssBytes();
+
+	/** @brief Command line arguments of the form --name=value or --flag*/
+	class Arguments
+	{
+	public:
+		/** parses argv starting at @p first. Anything not starting with "--" is a positional argument*/
+		Arguments(int argc, char **argv, int first);
+
+		bool has(const std::string &name) const;
+		std::string get(const std::string &name, const std::string &fallback) const;
+		double getDouble(const std::string &name, double fallback) const;
+		std::uint64_t getSize(const std::string &name, std::uint64_t fallback) const;
+
+		const std::vector<std::string> &positional() const;
+	private:
+		std::map<std::string, std::string> named;
+		std::vector<std::string> positionals;
+	};
+
+	/** Parses a size like "512", "64K", "16M" or "1G" (powers of 1024)*/
+	std::uint64_t parseSize(const std::string &text);
+
+	enum class Format{ TEXT, JSON, CSV };
+
+	/** Reads --format=text|json|csv*/
+	Format parseFormat(const Arguments &args);
+
+	/** @brief The outcome of a single benchmark*/
+	struct Result
+	{
+		std::string name;
+		std::uint64_t iterations;
+		double nsPerOp;
+		double allocsPerOp;
+		double bytesPerOp;
+	};
+
+	/** @brief A set of named microbenchmarks
+		@details Each benchmark is a function running the measured operation the given number of times.
+		The number of iterations is calibrated so that a run lasts at least --min-time seconds and the
+		median of --repetitions runs is reported.
+	*/
+	class Suite
+	{
+	public:
+		typedef std::function<void(std::uint64_t iterations)> Benchmark;
+
+		void add(const std::string &name, Benchmark benchmark);
+
+		/** Runs every benchmark whose name contains --filter*/
+		std::vector<Result> run(const Arguments &args) const;
+	private:
+		Result measure(const std::string &name, const Benchmark &benchmark, double minTime, int repetitions) const;
+
+		std::vector<std::pair<std::string, Benchmark> > benchmarks;
+	};
+
+	/** Prints @p results as an aligned table, a JSON document or CSV*/
+	void report(const std::vector<Result> &results, Format format, std::ostream &out);
+
+	/** Escapes @p text for use inside a JSON string*/
+	std::string jsonEscape(const std::string &text);
+
+}
+}
+#endif // !BENCHMARK_HPP
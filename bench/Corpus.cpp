@@ -0,0 +1,323 @@
+#include "Corpus.hpp"
+#include "Benchmark.hpp"
+#include "luapath/luapath.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	Random::Random(uint64_t seed)
+		: state(seed ? seed : 0x9E3779B97F4A7C15ull)
+	{
+	}
+
+	uint64_t Random::next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+
+	uint64_t Random::below(uint64_t bound)
+	{
+		return bound ? next() % bound : 0;
+	}
+
+	double Random::unit()
+	{
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	CorpusOptions::CorpusOptions()
+		: size(1 << 20), depth(4), fanout(16), arrayRatio(0.25), nestRatio(0.15), numericDensity(0.5),
+		stringLength(12), stringDistribution(StringDistribution::UNIFORM), seed(42), name("config")
+	{
+	}
+
+	namespace
+	{
+		const std::size_t FLUSH_SIZE = 1 << 16;
+		const char STRING_ALPHABET[] = "abcdefghijklmnopqrstuvwxyz0123456789 /._-ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+		class CorpusWriter
+		{
+		public:
+			CorpusWriter(const CorpusOptions &options, std::ostream &out)
+				: options(options), out(out), random(options.seed), written(0)
+			{
+				buffer.reserve(FLUSH_SIZE * 2);
+			}
+
+			uint64_t write()
+			{
+				buffer += options.name;
+				buffer += " = {\n";
+				// keep adding sections until the size is reached
+				for (uint64_t section = 1; !exhausted(); ++section)
+				{
+					buffer += "\tsection";
+					buffer += std::to_string(section);
+					buffer += " = ";
+					writeTable(1);
+					buffer += ",\n";
+					flush(false);
+				}
+				buffer += "}\n";
+				flush(true);
+				return written;
+			}
+
+		private:
+			bool exhausted() const
+			{
+				return written + buffer.size() >= options.size;
+			}
+
+			void indent(int depth)
+			{
+				buffer += '\n';
+				buffer.append(depth + 1, '\t');
+			}
+
+			void writeTable(int depth)
+			{
+				buffer += '{';
+				int positional = (int)std::lround(options.fanout * options.arrayRatio);
+				for (int field = 0; field < options.fanout && !exhausted(); ++field)
+				{
+					indent(depth);
+					if (field >= positional)
+					{
+						buffer += "field";
+						buffer += std::to_string(field);
+						buffer += " = ";
+					}
+					if (depth < options.depth && random.unit() < options.nestRatio)
+						writeTable(depth + 1);
+					else
+						writeLeaf();
+					buffer += ',';
+					flush(false);
+				}
+				indent(depth - 1);
+				buffer += '}';
+			}
+
+			void writeLeaf()
+			{
+				double kind = random.unit();
+				if (kind < options.numericDensity)
+					writeNumber();
+				else if (random.below(20) == 0)
+					buffer += random.below(2) ? "true" : "false";
+				else
+					writeString();
+			}
+
+			void writeNumber()
+			{
+				uint64_t kind = random.below(20);
+				if (kind < 10)
+					buffer += std::to_string(random.below(1000000));
+				else
+				{
+					if (random.below(4) == 0)
+						buffer += '-';
+					buffer += std::to_string(random.below(10000));
+					buffer += '.';
+					buffer += std::to_string(random.below(1000000));
+					if (kind == 19)
+					{
+						buffer += "e-";
+						buffer += std::to_string(random.below(10));
+					}
+				}
+			}
+
+			std::size_t stringLength()
+			{
+				double mean = options.stringLength;
+				switch (options.stringDistribution)
+				{
+				case CorpusOptions::StringDistribution::FIXED:
+					return (std::size_t)mean;
+				case CorpusOptions::StringDistribution::EXPONENTIAL:
+					return (std::size_t)(-std::log(1.0 - random.unit()) * mean);
+				case CorpusOptions::StringDistribution::UNIFORM:
+				default:
+					return (std::size_t)random.below((uint64_t)(2 * mean) + 1);
+				}
+			}
+
+			void writeString()
+			{
+				std::size_t length = stringLength();
+				buffer += '"';
+				for (std::size_t i = 0; i < length; ++i)
+				{
+					// an escape sequence now and then so that lexers can't take shortcuts
+					if (random.below(64) == 0)
+					{
+						buffer += random.below(2) ? "\\n" : "\\\"";
+						continue;
+					}
+					buffer += STRING_ALPHABET[random.below(sizeof(STRING_ALPHABET) - 1)];
+				}
+				buffer += '"';
+			}
+
+			void flush(bool force)
+			{
+				if (!force && buffer.size() < FLUSH_SIZE)
+					return;
+				out.write(buffer.data(), buffer.size());
+				written += buffer.size();
+				buffer.clear();
+			}
+
+			const CorpusOptions &options;
+			std::ostream &out;
+			Random random;
+			uint64_t written;
+			string buffer;
+		};
+	}
+
+	uint64_t generateCorpus(const CorpusOptions &options, std::ostream &out)
+	{
+		CorpusWriter writer(options, out);
+		return writer.write();
+	}
+
+	SnapshotSampler::SnapshotSampler(const Table &root, std::size_t maxSamples, uint64_t seed)
+		: leaves(0), tableCount(0), random(seed), maxSamples(maxSamples)
+	{
+		string path;
+		walk(root, path);
+	}
+
+	namespace
+	{
+		void appendKey(string &path, const Key &key)
+		{
+			path += key.type == Key::Type::NUMBER ? NUMBER_TOKEN : STRING_TOKEN;
+			path += key.key;
+		}
+
+		/** Algorithm R: keeps each of the @p seen items with the same probability*/
+		template<class T>
+		bool reservoirSlot(Random &random, std::vector<T> &samples, std::size_t maxSamples, uint64_t seen, std::size_t &slot)
+		{
+			if (samples.size() < maxSamples)
+			{
+				slot = samples.size();
+				samples.push_back(T());
+				return true;
+			}
+			uint64_t candidate = random.below(seen);
+			slot = (std::size_t)candidate;
+			return candidate < maxSamples;
+		}
+	}
+
+	void SnapshotSampler::walk(const Table &table, string &path)
+	{
+		std::size_t length = path.size();
+		for (const Table::LeafSet::value_type &leaf : table.leaves())
+		{
+			std::size_t slot;
+			if (reservoirSlot(random, valuePaths, maxSamples, ++leaves, slot))
+			{
+				appendKey(path, leaf.first);
+				valuePaths[slot] = path;
+				path.resize(length);
+			}
+		}
+		for (const Table::NestedSet::value_type &nested : table.tables())
+		{
+			appendKey(path, nested.first);
+			std::size_t slot;
+			if (reservoirSlot(random, tablePaths, maxSamples, ++tableCount, slot))
+			{
+				if (slot == tables.size())
+					tables.push_back(nullptr);
+				tablePaths[slot] = path;
+				tables[slot] = &nested.second;
+			}
+			walk(nested.second, path);
+			path.resize(length);
+		}
+	}
+
+	CorpusOptions corpusOptions(const Arguments &args)
+	{
+		CorpusOptions options;
+		options.size = args.getSize("size", options.size);
+		options.depth = (int)args.getDouble("depth", options.depth);
+		options.fanout = (int)args.getDouble("fanout", options.fanout);
+		options.arrayRatio = args.getDouble("array-ratio", options.arrayRatio);
+		options.nestRatio = args.getDouble("nest-ratio", options.nestRatio);
+		options.numericDensity = args.getDouble("numeric-density", options.numericDensity);
+		options.stringLength = args.getDouble("string-length", options.stringLength);
+		options.seed = (uint64_t)args.getDouble("seed", (double)options.seed);
+		options.name = args.get("table", options.name);
+		string distribution = args.get("string-dist", "uniform");
+		if (distribution == "fixed")
+			options.stringDistribution = CorpusOptions::StringDistribution::FIXED;
+		else if (distribution == "exponential")
+			options.stringDistribution = CorpusOptions::StringDistribution::EXPONENTIAL;
+		else if (distribution != "uniform")
+			throw std::invalid_argument("unknown --string-dist - " + distribution);
+		return options;
+	}
+
+	void forEachCorpus(const Arguments &args,
+		const std::function<void(const string &label, const string &path, const string &tableName)> &run,
+		const string &defaultSizes)
+	{
+		string file = args.get("file", "");
+		if (!file.empty())
+		{
+			run(file, file, args.get("table", "config"));
+			return;
+		}
+
+		// ascending sizes so that the peak RSS measured for each corpus belongs to it
+		string dir = args.get("dir", ".");
+		std::istringstream sizes(args.get("sizes", defaultSizes));
+		string size;
+		while (std::getline(sizes, size, ','))
+		{
+			CorpusOptions options = corpusOptions(args);
+			options.size = parseSize(size);
+			string path = dir + "/luapath_corpus_" + size + ".lua";
+			{
+				std::ofstream out(path.c_str(), std::ios::binary);
+				if (!out)
+					throw std::runtime_error("could not open " + path);
+				generateCorpus(options, out);
+			}
+			try
+			{
+				run(size, path, options.name);
+			}
+			catch (...)
+			{
+				std::remove(path.c_str());
+				throw;
+			}
+			if (!args.has("keep"))
+				std::remove(path.c_str());
+		}
+	}
+
+}
+}
@@ -0,0 +1,97 @@
+#ifndef CORPUS_HPP
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace luapath{
+	class Table;
+
+namespace bench{
+
+	/** @brief A small deterministic random number generator (xorshift64*)
+		@details Used instead of the standard distributions so that a seed produces the same corpus everywhere*/
+	class Random
+	{
+	public:
+		explicit Random(std::uint64_t seed);
+		std::uint64_t next();
+		/** uniform in [0, bound)*/
+		std::uint64_t below(std::uint64_t bound);
+		/** uniform in [0, 1)*/
+		double unit();
+	private:
+		std::uint64_t state;
+	};
+
+	/** @brief Shape of a generated configuration file*/
+	struct CorpusOptions
+	{
+		enum class StringDistribution{ FIXED, UNIFORM, EXPONENTIAL };
+
+		CorpusOptions();
+
+		/** approximate size of the generated file in bytes*/
+		std::uint64_t size;
+		/** maximum nesting depth below the sections of the root table*/
+		int depth;
+		/** number of fields of every table*/
+		int fanout;
+		/** fraction of the fields of a table which are positional (number keys)*/
+		double arrayRatio;
+		/** probability that a field is a nested table while the depth allows it*/
+		double nestRatio;
+		/** fraction of the leaves which are numbers. Of the rest 1 in 20 is a boolean and the others strings*/
+		double numericDensity;
+		/** mean length of a string value*/
+		double stringLength;
+		StringDistribution stringDistribution;
+		std::uint64_t seed;
+		/** name of the single global table holding the whole corpus*/
+		std::string name;
+	};
+
+	/** Writes a lua file which assigns one global table according to @p options
+		@return the number of bytes written */
+	std::uint64_t generateCorpus(const CorpusOptions &options, std::ostream &out);
+
+	class Arguments;
+
+	/** @brief Uniform samples of the value and table paths of a snapshot
+		@details Walks the whole Table once counting its nodes and keeps up to @p maxSamples paths of each kind
+		(reservoir sampling). Pointers to the sampled nested tables point into the walked Table.
+	*/
+	class SnapshotSampler
+	{
+	public:
+		SnapshotSampler(const Table &root, std::size_t maxSamples, std::uint64_t seed);
+
+		std::vector<std::string> valuePaths;
+		std::vector<std::string> tablePaths;
+		std::vector<const Table*> tables;
+		std::uint64_t leaves;
+		std::uint64_t tableCount;
+	private:
+		void walk(const Table &table, std::string &path);
+
+		Random random;
+		std::size_t maxSamples;
+	};
+
+	/** Reads the corpus options (--size, --depth, --fanout ...) from @p args*/
+	CorpusOptions corpusOptions(const Arguments &args);
+
+	/** @brief Calls @p run(label, path, tableName) for every corpus selected by @p args
+		@details That is either --file=FILE holding the global table --table or one generated corpus per
+		entry of --sizes (@p defaultSizes) in ascending order, written to --dir and removed afterwards unless --keep is given.
+	*/
+	void forEachCorpus(const Arguments &args,
+		const std::function<void(const std::string &label, const std::string &path, const std::string &tableName)> &run,
+		const std::string &defaultSizes = "1K,64K,1M,16M");
+
+}
+}
+#endif // !CORPUS_HPP
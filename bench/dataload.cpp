@@ -0,0 +1,127 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		struct DataLoadResult
+		{
+			string label;
+			uint64_t fileBytes;
+			uint64_t vmNs;
+			uint64_t fastNs;
+			bool parsed;
+			bool identical;
+		};
+
+		string printed(const Table &table)
+		{
+			std::ostringstream out;
+			out << table;
+			return out.str();
+		}
+
+		/** the best of @p rounds runs of @p load*/
+		template<class Load>
+		uint64_t bestOf(int rounds, Load load)
+		{
+			uint64_t best = UINT64_MAX;
+			for (int round = 0; round < rounds; ++round)
+			{
+				uint64_t start = nowNs();
+				load();
+				uint64_t elapsed = nowNs() - start;
+				if (elapsed < best)
+					best = elapsed;
+			}
+			return best;
+		}
+	}
+
+	int runDataLoad(const Arguments &args)
+	{
+		int rounds = (int)args.getSize("rounds", 3);
+		Format format = parseFormat(args);
+		std::vector<DataLoadResult> results;
+		forEachCorpus(args, [&](const string &label, const string &path, const string &) {
+			DataLoadResult result;
+			result.label = label;
+			std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+			result.fileBytes = (uint64_t)file.tellg();
+
+			string vmPrinted, fastPrinted;
+			result.vmNs = bestOf(rounds, [&]() {
+				LuaState state;
+				state.loadFile(path);
+				Table globals = state.getGlobals();
+				doNotOptimize(globals);
+				if (vmPrinted.empty())
+					vmPrinted = printed(globals);
+			});
+			result.fastNs = bestOf(rounds, [&]() {
+				Table globals = DataLoader::loadFile(path);
+				doNotOptimize(globals);
+				if (fastPrinted.empty())
+					fastPrinted = printed(globals);
+			});
+			std::ifstream source(path.c_str(), std::ios::binary);
+			std::ostringstream contents;
+			contents << source.rdbuf();
+			Table ignored;
+			result.parsed = DataLoader::parse(contents.str(), ignored);
+			result.identical = vmPrinted == fastPrinted;
+			results.push_back(result);
+		});
+
+		switch (format)
+		{
+		case Format::JSON:
+			std::cout << "{\"dataload\":[";
+			for (std::size_t i = 0; i < results.size(); ++i)
+			{
+				const DataLoadResult &r = results[i];
+				std::cout << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"file_bytes\":" << r.fileBytes
+					<< ",\"vm_ms\":" << r.vmNs / 1e6 << ",\"fast_ms\":" << r.fastNs / 1e6
+					<< ",\"speedup\":" << (double)r.vmNs / r.fastNs << ",\"fast_path\":" << (r.parsed ? "true" : "false")
+					<< ",\"identical\":" << (r.identical ? "true" : "false") << "}";
+			}
+			std::cout << "\n]}\n";
+			break;
+		case Format::CSV:
+			std::cout << "name,file_bytes,vm_ms,fast_ms,speedup,fast_path,identical\n";
+			for (const DataLoadResult &r : results)
+			{
+				std::cout << r.label << "," << r.fileBytes << "," << r.vmNs / 1e6 << "," << r.fastNs / 1e6 << ","
+					<< (double)r.vmNs / r.fastNs << "," << r.parsed << "," << r.identical << "\n";
+			}
+			break;
+		case Format::TEXT:
+			std::cout << std::left << std::setw(24) << "corpus" << std::right << std::setw(14) << "bytes"
+				<< std::setw(12) << "vm ms" << std::setw(12) << "fast ms" << std::setw(10) << "speedup"
+				<< std::setw(11) << "fast path" << std::setw(11) << "identical" << "\n";
+			for (const DataLoadResult &r : results)
+			{
+				std::cout << std::left << std::setw(24) << r.label << std::right << std::setw(14) << r.fileBytes << std::fixed
+					<< std::setprecision(2) << std::setw(12) << r.vmNs / 1e6 << std::setw(12) << r.fastNs / 1e6
+					<< std::setw(9) << (double)r.vmNs / r.fastNs << "x" << std::setw(11) << (r.parsed ? "yes" : "no")
+					<< std::setw(11) << (r.identical ? "yes" : "NO") << "\n";
+				std::cout.unsetf(std::ios::fixed);
+			}
+			break;
+		}
+		return 0;
+	}
+
+}
+}
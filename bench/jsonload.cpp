@@ -0,0 +1,120 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		struct JsonLoadResult
+		{
+			string label;
+			uint64_t jsonBytes;
+			uint64_t luaNs;
+			uint64_t jsonNs;
+			bool identical;
+		};
+
+		string printed(const Table &table)
+		{
+			std::ostringstream out;
+			out << table;
+			return out.str();
+		}
+
+		/** the best of @p rounds runs of @p load*/
+		template<class Load>
+		uint64_t bestOf(int rounds, Load load)
+		{
+			uint64_t best = UINT64_MAX;
+			for (int round = 0; round < rounds; ++round)
+			{
+				uint64_t start = nowNs();
+				load();
+				uint64_t elapsed = nowNs() - start;
+				if (elapsed < best)
+					best = elapsed;
+			}
+			return best;
+		}
+	}
+
+	int runJsonLoad(const Arguments &args)
+	{
+		int rounds = (int)args.getSize("rounds", 3);
+		Format format = parseFormat(args);
+		std::vector<JsonLoadResult> results;
+		forEachCorpus(args, [&](const string &label, const string &path, const string &tableName) {
+			// the corpus as JSON and as the lua source of exactly the same data
+			string json = JsonWriter::toString(DataLoader::loadFile(path).getTable("." + tableName));
+			string lua = LuaWriter::toString(JsonReader::parse(json, Key(tableName)), WriteStyle::COMPACT);
+
+			JsonLoadResult result;
+			result.label = label;
+			result.jsonBytes = json.size();
+			string luaPrinted, jsonPrinted;
+			result.luaNs = bestOf(rounds, [&]() {
+				LuaState state;
+				state.loadString(lua);
+				Table table = state.getGlobalTable(tableName);
+				doNotOptimize(table);
+				if (luaPrinted.empty())
+					luaPrinted = printed(table);
+			});
+			result.jsonNs = bestOf(rounds, [&]() {
+				Table table = JsonReader::parse(json, Key(tableName));
+				doNotOptimize(table);
+				if (jsonPrinted.empty())
+					jsonPrinted = printed(table);
+			});
+			result.identical = luaPrinted == jsonPrinted;
+			results.push_back(result);
+		});
+
+		switch (format)
+		{
+		case Format::JSON:
+			std::cout << "{\"jsonload\":[";
+			for (std::size_t i = 0; i < results.size(); ++i)
+			{
+				const JsonLoadResult &r = results[i];
+				std::cout << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"json_bytes\":" << r.jsonBytes
+					<< ",\"lua_ms\":" << r.luaNs / 1e6 << ",\"json_ms\":" << r.jsonNs / 1e6
+					<< ",\"speedup\":" << (double)r.luaNs / r.jsonNs
+					<< ",\"identical\":" << (r.identical ? "true" : "false") << "}";
+			}
+			std::cout << "\n]}\n";
+			break;
+		case Format::CSV:
+			std::cout << "name,json_bytes,lua_ms,json_ms,speedup,identical\n";
+			for (const JsonLoadResult &r : results)
+			{
+				std::cout << r.label << "," << r.jsonBytes << "," << r.luaNs / 1e6 << "," << r.jsonNs / 1e6 << ","
+					<< (double)r.luaNs / r.jsonNs << "," << r.identical << "\n";
+			}
+			break;
+		case Format::TEXT:
+			std::cout << std::left << std::setw(24) << "corpus" << std::right << std::setw(14) << "json bytes"
+				<< std::setw(12) << "lua ms" << std::setw(12) << "json ms" << std::setw(10) << "speedup"
+				<< std::setw(11) << "identical" << "\n";
+			for (const JsonLoadResult &r : results)
+			{
+				std::cout << std::left << std::setw(24) << r.label << std::right << std::setw(14) << r.jsonBytes << std::fixed
+					<< std::setprecision(2) << std::setw(12) << r.luaNs / 1e6 << std::setw(12) << r.jsonNs / 1e6
+					<< std::setw(9) << (double)r.luaNs / r.jsonNs << "x" << std::setw(11) << (r.identical ? "yes" : "NO") << "\n";
+				std::cout.unsetf(std::ios::fixed);
+			}
+			break;
+		}
+		return 0;
+	}
+
+}
+}
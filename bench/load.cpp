@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		struct LoadResult
+		{
+			string label;
+			uint64_t fileBytes;
+			uint64_t loadNs;
+			uint64_t snapshotNs;
+			uint64_t nodes;
+			uint64_t lookups;
+			uint64_t lookupNs;
+			uint64_t peakRssLoad;
+			uint64_t peakRssSnapshot;
+		};
+
+		uint64_t fileSize(const string &path)
+		{
+			std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+			if (!file)
+				throw std::runtime_error("could not open " + path);
+			return (uint64_t)file.tellg();
+		}
+
+		/** the collector options of --gc and --gc-pause*/
+		LoadOptions loadOptions(const Arguments &args)
+		{
+			LoadOptions options;
+			string policy = args.get("gc", "incremental");
+			if (policy == "stopped")
+				options.gcPolicy = GcPolicy::STOPPED;
+			else if (policy == "generational")
+				options.gcPolicy = GcPolicy::GENERATIONAL;
+			else if (policy != "incremental")
+				throw std::runtime_error("unknown --gc " + policy);
+			options.gcPause = (int)args.getSize("gc-pause", 0);
+			return options;
+		}
+
+		LoadResult loadOne(const string &label, const string &path, const string &tableName, uint64_t lookups,
+			LoadOptions options, bool sizeHint)
+		{
+			LoadResult result;
+			result.label = label;
+			result.fileBytes = fileSize(path);
+			if (sizeHint)
+				options.expectedSourceBytes = (std::size_t)result.fileBytes;
+
+			LuaState state;
+			uint64_t start = nowNs();
+			state.loadFile(path, options);
+			result.loadNs = nowNs() - start;
+			result.peakRssLoad = peakRssBytes();
+
+			start = nowNs();
+			Table root = state.getGlobalTable(tableName);
+			result.snapshotNs = nowNs() - start;
+			result.peakRssSnapshot = peakRssBytes();
+
+			SnapshotSampler sampler(root, 4096, 7);
+			result.nodes = sampler.leaves + sampler.tableCount + 1;
+			result.lookups = sampler.valuePaths.empty() ? 0 : lookups;
+
+			Random random(11);
+			std::vector<std::size_t> order(4096);
+			for (std::size_t i = 0; i < order.size() && !sampler.valuePaths.empty(); ++i)
+				order[i] = (std::size_t)random.below(sampler.valuePaths.size());
+			start = nowNs();
+			for (uint64_t i = 0; i < result.lookups; ++i)
+				doNotOptimize(root.getValue(sampler.valuePaths[order[i % order.size()]]));
+			result.lookupNs = nowNs() - start;
+			return result;
+		}
+
+		void reportLoad(const std::vector<LoadResult> &results, Format format, std::ostream &out)
+		{
+			switch (format)
+			{
+			case Format::JSON:
+				out << "{\"load\":[";
+				for (std::size_t i = 0; i < results.size(); ++i)
+				{
+					const LoadResult &r = results[i];
+					out << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"file_bytes\":" << r.fileBytes
+						<< ",\"load_ms\":" << r.loadNs / 1e6 << ",\"snapshot_ms\":" << r.snapshotNs / 1e6
+						<< ",\"nodes\":" << r.nodes << ",\"lookups\":" << r.lookups
+						<< ",\"lookup_ns_per_op\":" << (r.lookups ? (double)r.lookupNs / r.lookups : 0.0)
+						<< ",\"peak_rss_load\":" << r.peakRssLoad << ",\"peak_rss_snapshot\":" << r.peakRssSnapshot << "}";
+				}
+				out << "\n]}\n";
+				break;
+			case Format::CSV:
+				out << "name,file_bytes,load_ms,snapshot_ms,nodes,lookups,lookup_ns_per_op,peak_rss_load,peak_rss_snapshot\n";
+				for (const LoadResult &r : results)
+				{
+					out << r.label << "," << r.fileBytes << "," << r.loadNs / 1e6 << "," << r.snapshotNs / 1e6 << ","
+						<< r.nodes << "," << r.lookups << "," << (r.lookups ? (double)r.lookupNs / r.lookups : 0.0) << ","
+						<< r.peakRssLoad << "," << r.peakRssSnapshot << "\n";
+				}
+				break;
+			case Format::TEXT:
+				out << std::left << std::setw(24) << "corpus" << std::right << std::setw(14) << "bytes" << std::setw(12) << "load ms"
+					<< std::setw(14) << "snapshot ms" << std::setw(12) << "nodes" << std::setw(14) << "lookup ns/op"
+					<< std::setw(14) << "rss load MB" << std::setw(16) << "rss snapshot MB" << "\n";
+				for (const LoadResult &r : results)
+				{
+					out << std::left << std::setw(24) << r.label << std::right << std::setw(14) << r.fileBytes << std::fixed
+						<< std::setprecision(2) << std::setw(12) << r.loadNs / 1e6 << std::setw(14) << r.snapshotNs / 1e6
+						<< std::setw(12) << r.nodes << std::setprecision(1) << std::setw(14) << (r.lookups ? (double)r.lookupNs / r.lookups : 0.0)
+						<< std::setw(14) << r.peakRssLoad / 1048576.0 << std::setw(16) << r.peakRssSnapshot / 1048576.0 << "\n";
+					out.unsetf(std::ios::fixed);
+				}
+				break;
+			}
+			out.flush();
+		}
+	}
+
+	int runGenerate(const Arguments &args)
+	{
+		CorpusOptions options = corpusOptions(args);
+		string output = args.get("output", "");
+		if (output.empty())
+		{
+			generateCorpus(options, std::cout);
+			return 0;
+		}
+		std::ofstream file(output.c_str(), std::ios::binary);
+		if (!file)
+			throw std::runtime_error("could not open " + output);
+		uint64_t written = generateCorpus(options, file);
+		std::cerr << "wrote " << written << " bytes to " << output << std::endl;
+		return 0;
+	}
+
+	int runLoad(const Arguments &args)
+	{
+		uint64_t lookups = args.getSize("lookups", 100000);
+		LoadOptions options = loadOptions(args);
+		bool sizeHint = args.has("size-hint");
+		std::vector<LoadResult> results;
+		if (args.has("stats"))
+			enableStats(true);
+		if (args.has("trace"))
+			startTracing();
+
+		forEachCorpus(args, [&](const string &label, const string &path, const string &tableName) {
+			results.push_back(loadOne(label, path, tableName, lookups, options, sizeHint));
+		});
+		reportLoad(results, parseFormat(args), std::cout);
+		if (tracing())
+		{
+			stopTracing();
+			std::ofstream trace(args.get("trace", "").c_str());
+			writeChromeTrace(trace);
+			if (!trace)
+				throw std::runtime_error("could not write " + args.get("trace", ""));
+		}
+		if (statsEnabled())
+		{
+			Stats counters = stats();
+			std::cerr << (parseFormat(args) == Format::JSON ? counters.toJson() + "\n" : counters.toText());
+		}
+		return 0;
+	}
+
+}
+}
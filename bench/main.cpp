@@ -0,0 +1,146 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "Benchmark.hpp"
+
+namespace luapath{
+namespace bench{
+	int runMicro(const Arguments &args);
+	int runGenerate(const Arguments &args);
+	int runLoad(const Arguments &args);
+	int runMemory(const Arguments &args);
+	int runThreads(const Arguments &args);
+	int runShape(const Arguments &args);
+	int runRelayout(const Arguments &args);
+	int runDataLoad(const Arguments &args);
+	int runJsonLoad(const Arguments &args);
+	int runScan(const Arguments &args);
+}
+}
+
+namespace
+{
+	void usage()
+	{
+		std::cerr <<
+			"usage: luapath_bench [micro|generate|load|memory|threads|shape|relayout|dataload|jsonload|scan] [options]\n"
+			"\n"
+			"micro      microbenchmarks of the core operations (default)\n"
+			"           --filter=TEXT        only run benchmarks whose name contains TEXT\n"
+			"           --min-time=SECONDS   minimum duration of a measured run (0.2)\n"
+			"           --repetitions=N      measured runs per benchmark, the median is reported (5)\n"
+			"\n"
+			"generate   writes a synthetic lua config holding a single global table\n"
+			"           --output=FILE        write to FILE instead of stdout\n"
+			"           --size=SIZE          approximate file size e.g. 512K, 64M, 1G (1M)\n"
+			"           --depth=N            maximum nesting depth (4)\n"
+			"           --fanout=N           fields per table (16)\n"
+			"           --array-ratio=R      fraction of positional fields (0.25)\n"
+			"           --nest-ratio=R       probability of a field being a nested table (0.15)\n"
+			"           --numeric-density=R  fraction of number leaves (0.5)\n"
+			"           --string-length=N    mean string length (12)\n"
+			"           --string-dist=fixed|uniform|exponential\n"
+			"           --seed=N --table=NAME (config)\n"
+			"\n"
+			"load       end to end loadFile -> getGlobalTable -> getValue benchmark reporting\n"
+			"           wall time per phase and peak RSS\n"
+			"           --file=FILE          load FILE instead of generated corpora\n"
+			"           --sizes=LIST         generated corpus sizes (1K,64K,1M,16M)\n"
+			"           --dir=DIR            where to write the corpora (.), --keep keeps them\n"
+			"           --lookups=N          lookups of sampled leaf paths (100000)\n"
+			"           --gc=POLICY          collector during the load: incremental, stopped or\n"
+			"                                generational (incremental)\n"
+			"           --gc-pause=N         pause of the collector in percent during the load\n"
+			"           --size-hint          pass the file size as LoadOptions::expectedSourceBytes\n"
+			"           --stats              enable luapath::stats and print them to stderr\n"
+			"           --trace=FILE         write a Chrome trace (needs -DLUAPATH_ENABLE_TRACING=ON)\n"
+			"           accepts the corpus options of generate\n"
+			"\n"
+			"memory     lua heap after load against the bytes held by the Table snapshot\n"
+			"           broken down into value nodes, nested tables, key and value strings\n"
+			"           takes --file or --sizes like load\n"
+			"\n"
+			"threads    1 to N threads reading one shared snapshot with a mix of getValue,\n"
+			"           getTable and toArray. Reports throughput and p50/p99/p999 latency\n"
+			"           --threads=LIST       thread counts (powers of two up to the core count)\n"
+			"           --mix=V,T,A          percentages of getValue, getTable, toArray (60,30,10)\n"
+			"           --ops=N              operations per thread (100000)\n"
+			"           takes --file or --sizes (1M) like load\n"
+			"\n"
+			"shape      entry counts, depth, estimated bytes, duplicated strings and the\n"
+			"           largest subtrees of a table, read straight from the lua state\n"
+			"           --top=N              number of largest subtrees listed (20)\n"
+			"           takes --file or --sizes (64K) like load, text or json only\n"
+			"\n"
+			"relayout   records an access profile of a skewed lookup workload and compares\n"
+			"           lookups on the snapshot with lookups on Table::relayout of it\n"
+			"           --hot=R              fraction of the sampled paths that are hot (0.02)\n"
+			"           --hot-share=R        fraction of the lookups going to hot paths (0.98)\n"
+			"           --lookups=N          measured lookups per table and round (1000000)\n"
+			"           --profile=FILE       also save the recorded profile\n"
+			"           takes --file or --sizes (1M,16M) like load\n"
+			"\n"
+			"dataload   loadFile + getGlobals against DataLoader::loadFile, checking that\n"
+			"           both produce the same Table\n"
+			"           --rounds=N           runs of each loader, the fastest is reported (3)\n"
+			"           takes --file or --sizes like load\n"
+			"\n"
+			"jsonload   JsonReader::parse against loading the same data as lua source with\n"
+			"           loadString + getGlobalTable, checking that both produce the same Table\n"
+			"           --rounds=N           runs of each loader, the fastest is reported (3)\n"
+			"           takes --file or --sizes like load\n"
+			"\n"
+			"scan       DataLoader::parse throughput with every ScanLevel the CPU supports on\n"
+			"           a string heavy and a number heavy corpus, next to a lua load\n"
+			"           --size=SIZE          size of each generated corpus (16M)\n"
+			"           --string-length=N    mean string length of the string corpus (64)\n"
+			"           --rounds=N           parses per level, the fastest is reported (3)\n"
+			"           --file=FILE          scan FILE instead\n"
+			"\n"
+			"common     --format=text|json|csv\n";
+	}
+}
+
+int main(int argc, char **argv)
+{
+	using namespace luapath::bench;
+	std::string mode = argc > 1 && argv[1][0] != '-' ? argv[1] : "micro";
+	int first = argc > 1 && argv[1][0] != '-' ? 2 : 1;
+	try
+	{
+		Arguments args(argc, argv, first);
+		if (args.has("help"))
+		{
+			usage();
+			return 0;
+		}
+		if (mode == "micro")
+			return runMicro(args);
+		if (mode == "generate")
+			return runGenerate(args);
+		if (mode == "load")
+			return runLoad(args);
+		if (mode == "memory")
+			return runMemory(args);
+		if (mode == "threads")
+			return runThreads(args);
+		if (mode == "shape")
+			return runShape(args);
+		if (mode == "relayout")
+			return runRelayout(args);
+		if (mode == "dataload")
+			return runDataLoad(args);
+		if (mode == "jsonload")
+			return runJsonLoad(args);
+		if (mode == "scan")
+			return runScan(args);
+		usage();
+		return 1;
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << "error: " << e.what() << std::endl;
+		return 1;
+	}
+}
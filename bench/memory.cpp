@@ -0,0 +1,126 @@
+#include <iomanip>
+#include <iostream>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		struct MemoryResult
+		{
+			string label;
+			uint64_t luaHeap;
+			uint64_t luaHeapCollected;
+			Table::Footprint footprint;
+			uint64_t snapshotAllocations;
+			uint64_t snapshotAllocatedBytes;
+		};
+
+		MemoryResult measure(const string &label, const string &path, const string &tableName)
+		{
+			MemoryResult result;
+			result.label = label;
+
+			LuaState state;
+			state.loadFile(path);
+			result.luaHeap = state.heapSize();
+			state.collectGarbage();
+			result.luaHeapCollected = state.heapSize();
+
+			AllocationStats before = allocationStats();
+			Table root = state.getGlobalTable(tableName);
+			AllocationStats after = allocationStats();
+			result.snapshotAllocations = after.count - before.count;
+			result.snapshotAllocatedBytes = after.bytes - before.bytes;
+			result.footprint = root.footprint();
+			return result;
+		}
+
+		double perEntry(uint64_t bytes, const Table::Footprint &footprint)
+		{
+			std::size_t entries = footprint.leaves + footprint.tables;
+			return entries ? (double)bytes / entries : 0.0;
+		}
+
+		void reportMemory(const std::vector<MemoryResult> &results, Format format, std::ostream &out)
+		{
+			switch (format)
+			{
+			case Format::JSON:
+				out << "{\"memory\":[";
+				for (std::size_t i = 0; i < results.size(); ++i)
+				{
+					const MemoryResult &r = results[i];
+					const Table::Footprint &f = r.footprint;
+					out << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"lua_heap\":" << r.luaHeap
+						<< ",\"lua_heap_collected\":" << r.luaHeapCollected << ",\"entries\":" << f.leaves + f.tables
+						<< ",\"leaves\":" << f.leaves << ",\"tables\":" << f.tables
+						<< ",\"snapshot_bytes\":" << f.totalBytes() << ",\"leaf_node_bytes\":" << f.leafNodeBytes
+						<< ",\"nested_table_bytes\":" << f.nestedTableBytes << ",\"key_string_bytes\":" << f.keyStringBytes
+						<< ",\"value_string_bytes\":" << f.valueStringBytes
+						<< ",\"snapshot_allocations\":" << r.snapshotAllocations << ",\"snapshot_allocated_bytes\":" << r.snapshotAllocatedBytes
+						<< ",\"snapshot_bytes_per_entry\":" << perEntry(f.totalBytes(), f)
+						<< ",\"lua_bytes_per_entry\":" << perEntry(r.luaHeapCollected, f)
+						<< ",\"snapshot_to_lua_ratio\":" << (r.luaHeapCollected ? (double)f.totalBytes() / r.luaHeapCollected : 0.0) << "}";
+				}
+				out << "\n]}\n";
+				break;
+			case Format::CSV:
+				out << "name,lua_heap,lua_heap_collected,entries,snapshot_bytes,leaf_node_bytes,nested_table_bytes,key_string_bytes,"
+					"value_string_bytes,snapshot_allocations,snapshot_allocated_bytes,snapshot_bytes_per_entry,lua_bytes_per_entry,snapshot_to_lua_ratio\n";
+				for (const MemoryResult &r : results)
+				{
+					const Table::Footprint &f = r.footprint;
+					out << r.label << "," << r.luaHeap << "," << r.luaHeapCollected << "," << f.leaves + f.tables << ","
+						<< f.totalBytes() << "," << f.leafNodeBytes << "," << f.nestedTableBytes << "," << f.keyStringBytes << ","
+						<< f.valueStringBytes << "," << r.snapshotAllocations << "," << r.snapshotAllocatedBytes << ","
+						<< perEntry(f.totalBytes(), f) << "," << perEntry(r.luaHeapCollected, f) << ","
+						<< (r.luaHeapCollected ? (double)f.totalBytes() / r.luaHeapCollected : 0.0) << "\n";
+				}
+				break;
+			case Format::TEXT:
+				for (const MemoryResult &r : results)
+				{
+					const Table::Footprint &f = r.footprint;
+					out << std::fixed << std::setprecision(1)
+						<< r.label << "\n"
+						<< "  lua heap after load          " << std::setw(14) << r.luaHeap << " bytes\n"
+						<< "  lua heap after full gc       " << std::setw(14) << r.luaHeapCollected << " bytes  "
+						<< perEntry(r.luaHeapCollected, f) << " per entry\n"
+						<< "  entries                      " << std::setw(14) << f.leaves + f.tables
+						<< "  (" << f.leaves << " values, " << f.tables << " tables)\n"
+						<< "  snapshot                     " << std::setw(14) << f.totalBytes() << " bytes  "
+						<< perEntry(f.totalBytes(), f) << " per entry  "
+						<< (r.luaHeapCollected ? (double)f.totalBytes() / r.luaHeapCollected : 0.0) << "x the lua heap\n"
+						<< "    value nodes                " << std::setw(14) << f.leafNodeBytes << "\n"
+						<< "    nested tables              " << std::setw(14) << f.nestedTableBytes << "\n"
+						<< "    key strings                " << std::setw(14) << f.keyStringBytes << "\n"
+						<< "    value strings              " << std::setw(14) << f.valueStringBytes << "\n"
+						<< "  allocated while snapshotting " << std::setw(14) << r.snapshotAllocatedBytes << " bytes in "
+						<< r.snapshotAllocations << " allocations\n";
+					out.unsetf(std::ios::fixed);
+				}
+				break;
+			}
+			out.flush();
+		}
+	}
+
+	int runMemory(const Arguments &args)
+	{
+		std::vector<MemoryResult> results;
+		forEachCorpus(args, [&](const string &label, const string &path, const string &tableName) {
+			results.push_back(measure(label, path, tableName));
+		});
+		reportMemory(results, parseFormat(args), std::cout);
+		return 0;
+	}
+
+}
+}
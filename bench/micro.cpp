@@ -0,0 +1,346 @@
+#include <memory>
+#include <streambuf>
+
+#include "Benchmark.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		/** A stream buffer which throws away everything written to it*/
+		class NullBuffer
+			: public std::streambuf
+		{
+		protected:
+			int_type overflow(int_type c) { return traits_type::not_eof(c); }
+			std::streamsize xsputn(const char *, std::streamsize count) { return count; }
+		};
+
+		/** A chain of @p depth tables each with @p fanout number fields and a "next" table*/
+		string nestedSource(const string &name, int depth, int fanout)
+		{
+			string source = name + " = ";
+			for (int level = 0; level < depth; ++level)
+			{
+				source += "{ ";
+				for (int field = 1; field <= fanout; ++field)
+					source += "k" + std::to_string(field) + " = " + std::to_string(level * fanout + field) + ".5, ";
+				if (level + 1 < depth)
+					source += "next = ";
+			}
+			source += "}";
+			for (int level = 1; level < depth; ++level)
+				source += " }";
+			return source + "\n";
+		}
+
+		/** The search path of the last field of the deepest table of nestedSource*/
+		string nestedPath(int depth, int fanout)
+		{
+			string path;
+			for (int level = 1; level < depth; ++level)
+				path += ".next";
+			return path + ".k" + std::to_string(fanout);
+		}
+
+		string arraySource(const string &name, int size, bool strings)
+		{
+			string source = name + " = {";
+			for (int i = 0; i < size; ++i)
+				source += strings ? "\"item" + std::to_string(i) + "\"," : std::to_string(i) + ".25,";
+			return source + "}\n";
+		}
+
+		void addValueBenchmarks(Suite &suite)
+		{
+			suite.add("key/construct/string", [](uint64_t n) {
+				string name("vertexShader");
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					Key key(name);
+					doNotOptimize(key);
+				}
+			});
+			suite.add("key/construct/number", [](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					Key key((int)(i & 1023));
+					doNotOptimize(key);
+				}
+			});
+			suite.add("key/convert/int", [](uint64_t n) {
+				Key key(4711);
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize((int)key);
+			});
+			suite.add("key/compare/number", [](uint64_t n) {
+				Key a(17), b(4711);
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize(a < b);
+			});
+			suite.add("value/construct/number", [](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					Value value(Value::Type::NUMBER, 40.8f);
+					doNotOptimize(value);
+				}
+			});
+			suite.add("value/construct/string", [](uint64_t n) {
+				string text("models/barbarian/exported/barbarian7.dae");
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					Value value(Value::Type::STRING, text);
+					doNotOptimize(value);
+				}
+			});
+			suite.add("value/convert/float", [](uint64_t n) {
+				Value value(Value::Type::NUMBER, 40.8f);
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize((float)value);
+			});
+			suite.add("value/convert/int", [](uint64_t n) {
+				Value value(Value::Type::NUMBER, 2014.0f);
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize((int)value);
+			});
+			suite.add("value/convert/bool", [](uint64_t n) {
+				Value value(Value::Type::BOOL, true);
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize((bool)value);
+			});
+			suite.add("value/convert/string", [](uint64_t n) {
+				Value value(Value::Type::STRING, "Dublin");
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					string text = value;
+					doNotOptimize(text);
+				}
+			});
+		}
+
+		void addTableBenchmarks(Suite &suite)
+		{
+			const int depths[] = { 1, 4, 16 };
+			const int fanouts[] = { 4, 64 };
+			// the path parsing is measured as part of the lookups, which parse it segment by segment
+			for (int depth : depths)
+			{
+				for (int fanout : fanouts)
+				{
+					LuaState state;
+					state.loadString(nestedSource("nested", depth, fanout));
+					Table table = state.getGlobalTable("nested");
+					string suffix = "/depth" + std::to_string(depth) + "/fanout" + std::to_string(fanout);
+					string valuePath = nestedPath(depth, fanout);
+					string tablePath = depth > 1 ? valuePath.substr(0, valuePath.rfind('.')) : "";
+
+					suite.add("table/getValue" + suffix, [table, valuePath](uint64_t n) {
+						for (uint64_t i = 0; i < n; ++i)
+							doNotOptimize(table.getValue(valuePath));
+					});
+					if (depth > 1)
+					{
+						suite.add("table/getTable" + suffix, [table, tablePath](uint64_t n) {
+							for (uint64_t i = 0; i < n; ++i)
+								doNotOptimize(table.getTable(tablePath));
+						});
+					}
+					suite.add("table/tryGetValue" + suffix, [table, valuePath](uint64_t n) {
+						for (uint64_t i = 0; i < n; ++i)
+							doNotOptimize(table.tryGetValue(valuePath));
+					});
+					// misses in the last segment, the common case of probing optional settings
+					string missPath = valuePath + "x";
+					suite.add("table/getValue/miss" + suffix, [table, missPath](uint64_t n) {
+						Value value;
+						for (uint64_t i = 0; i < n; ++i)
+							doNotOptimize(table.getValue(missPath, value));
+					});
+					suite.add("table/tryGetValue/miss" + suffix, [table, missPath](uint64_t n) {
+						for (uint64_t i = 0; i < n; ++i)
+							doNotOptimize(table.tryGetValue(missPath));
+					});
+					suite.add("table/print" + suffix, [table](uint64_t n) {
+						NullBuffer buffer;
+						std::ostream out(&buffer);
+						for (uint64_t i = 0; i < n; ++i)
+							out << table;
+					});
+					suite.add("table/writeLua/compact" + suffix, [table](uint64_t n) {
+						NullBuffer buffer;
+						std::ostream out(&buffer);
+						StreamSink sink(out);
+						for (uint64_t i = 0; i < n; ++i)
+							LuaWriter::write(table, sink, WriteStyle::COMPACT);
+					});
+					suite.add("table/writeLua/pretty" + suffix, [table](uint64_t n) {
+						NullBuffer buffer;
+						std::ostream out(&buffer);
+						StreamSink sink(out);
+						for (uint64_t i = 0; i < n; ++i)
+							LuaWriter::write(table, sink, WriteStyle::PRETTY);
+					});
+				}
+			}
+
+			const int sizes[] = { 16, 1024 };
+			for (int size : sizes)
+			{
+				LuaState state;
+				state.loadString(arraySource("numbers", size, false) + arraySource("strings", size, true));
+				Table numbers = state.getGlobalTable("numbers");
+				Table strings = state.getGlobalTable("strings");
+				suite.add("table/toArray/float/" + std::to_string(size), [numbers](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(numbers.toArray<float>());
+				});
+				suite.add("table/toArray/string/" + std::to_string(size), [strings](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(strings.toArray<string>());
+				});
+			}
+		}
+
+		void addPersistentBenchmarks(Suite &suite)
+		{
+			const int sizes[] = { 16, 1024, 16384 };
+			for (int size : sizes)
+			{
+				LuaState state;
+				state.loadString(arraySource("numbers", size, false));
+				Table table = state.getGlobalTable("numbers");
+				PersistentTable persistent(table);
+				string path = "#" + std::to_string(size / 2);
+				string suffix = "/" + std::to_string(size);
+				// a Table can only be edited by copying it, the baseline for a new version
+				suite.add("table/copy" + suffix, [table](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(Table(table));
+				});
+				suite.add("persistent/with" + suffix, [persistent, path](uint64_t n) {
+					Value value(Value::Type::NUMBER, 1.0);
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(persistent.with(path, value));
+				});
+				suite.add("persistent/without" + suffix, [persistent, path](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(persistent.without(path));
+				});
+				suite.add("persistent/tryGetValue" + suffix, [persistent, path](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(persistent.tryGetValue(path));
+				});
+				suite.add("table/tryGetValue" + suffix, [table, path](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i)
+						doNotOptimize(table.tryGetValue(path));
+				});
+			}
+		}
+
+		void addExportBenchmarks(Suite &suite)
+		{
+			std::shared_ptr<LuaState> state = std::make_shared<LuaState>();
+			state->loadString(nestedSource("nested", 16, 64) + arraySource("strings", 1024, true));
+			const char *names[] = { "nested", "strings" };
+			for (const char *name : names)
+			{
+				Table table = state->getGlobalTable(name);
+				string suffix = string("/") + name;
+				suite.add("export/print" + suffix, [table](uint64_t n) {
+					NullBuffer buffer;
+					std::ostream out(&buffer);
+					for (uint64_t i = 0; i < n; ++i)
+						out << table;
+				});
+				suite.add("export/json/table" + suffix, [table](uint64_t n) {
+					NullBuffer buffer;
+					std::ostream out(&buffer);
+					StreamSink sink(out);
+					for (uint64_t i = 0; i < n; ++i)
+						JsonWriter::write(table, sink);
+				});
+				suite.add("export/json/state" + suffix, [state, name](uint64_t n) {
+					NullBuffer buffer;
+					std::ostream out(&buffer);
+					StreamSink sink(out);
+					for (uint64_t i = 0; i < n; ++i)
+						JsonWriter::write(*state, name, sink);
+				});
+				suite.add("export/msgpack/table" + suffix, [table](uint64_t n) {
+					NullBuffer buffer;
+					std::ostream out(&buffer);
+					StreamSink sink(out);
+					for (uint64_t i = 0; i < n; ++i)
+						MessagePackWriter::write(table, sink);
+				});
+				suite.add("export/msgpack/state" + suffix, [state, name](uint64_t n) {
+					NullBuffer buffer;
+					std::ostream out(&buffer);
+					StreamSink sink(out);
+					for (uint64_t i = 0; i < n; ++i)
+						MessagePackWriter::write(*state, name, sink);
+				});
+			}
+		}
+
+		void addLuaStateBenchmarks(Suite &suite)
+		{
+			std::shared_ptr<LuaState> state = std::make_shared<LuaState>();
+			state->loadString("N1 = 5.0 str1 = \"models/barbarian/exported/barbarian7.dae\" bool1 = false");
+			suite.add("luastate/getGlobalValue/number", [state](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize(state->getGlobalValue("N1"));
+			});
+			suite.add("luastate/getGlobalValue/string", [state](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize(state->getGlobalValue("str1"));
+			});
+			suite.add("luastate/getGlobalValue/bool", [state](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+					doNotOptimize(state->getGlobalValue("bool1"));
+			});
+
+			// a tuning console changing 100 fields of a table at once, written back or regenerated and reloaded
+			const int fields = 100;
+			std::shared_ptr<LuaState> tuned = std::make_shared<LuaState>();
+			tuned->loadString(nestedSource("tuning", 4, fields));
+			std::shared_ptr<TableEdit> edit = std::make_shared<TableEdit>(tuned->editGlobalTable("tuning"));
+			string path = nestedPath(4, fields);
+			path = path.substr(0, path.rfind('.'));
+			// the lambda holds on to the state the edit writes to
+			suite.add("luastate/edit/apply100", [tuned, edit, path, fields](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					for (int field = 1; field <= fields; ++field)
+						edit->set(path + ".k" + std::to_string(field), Value(Value::Type::NUMBER, (double)(i + field)));
+					edit->apply();
+				}
+			});
+			suite.add("luastate/edit/reload100", [fields](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					LuaState reloaded;
+					reloaded.loadString(nestedSource("tuning", 4, fields));
+				}
+			});
+		}
+	}
+
+	int runMicro(const Arguments &args)
+	{
+		Suite suite;
+		addValueBenchmarks(suite);
+		addTableBenchmarks(suite);
+		addPersistentBenchmarks(suite);
+		addExportBenchmarks(suite);
+		addLuaStateBenchmarks(suite);
+		report(suite.run(args), parseFormat(args), std::cout);
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		struct RelayoutResult
+		{
+			string label;
+			uint64_t hotPaths;
+			uint64_t profiledPaths;
+			double originalNs;
+			double relaidNs;
+		};
+
+		/** the index into @p paths of the next lookup: @p hotShare of them go to the first @p hot paths*/
+		std::size_t nextPath(Random &random, std::size_t hot, std::size_t total, double hotShare)
+		{
+			if (random.unit() < hotShare || hot == total)
+				return (std::size_t)random.below(hot);
+			return hot + (std::size_t)random.below(total - hot);
+		}
+
+		double lookupNs(const Table &table, const std::vector<string> &paths, std::size_t hot, double hotShare, uint64_t lookups)
+		{
+			Random random(99);
+			uint64_t start = nowNs();
+			for (uint64_t i = 0; i < lookups; ++i)
+				doNotOptimize(table.getValue(paths[nextPath(random, hot, paths.size(), hotShare)]));
+			return (double)(nowNs() - start) / lookups;
+		}
+
+		void reportRelayout(const std::vector<RelayoutResult> &results, Format format, std::ostream &out)
+		{
+			switch (format)
+			{
+			case Format::JSON:
+				out << "{\"relayout\":[";
+				for (std::size_t i = 0; i < results.size(); ++i)
+				{
+					const RelayoutResult &r = results[i];
+					out << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"hot_paths\":" << r.hotPaths
+						<< ",\"profiled_paths\":" << r.profiledPaths << ",\"original_ns_per_lookup\":" << r.originalNs
+						<< ",\"relaid_ns_per_lookup\":" << r.relaidNs << "}";
+				}
+				out << "\n]}\n";
+				break;
+			case Format::CSV:
+				out << "name,hot_paths,profiled_paths,original_ns_per_lookup,relaid_ns_per_lookup\n";
+				for (const RelayoutResult &r : results)
+					out << r.label << "," << r.hotPaths << "," << r.profiledPaths << "," << r.originalNs << "," << r.relaidNs << "\n";
+				break;
+			case Format::TEXT:
+				out << std::left << std::setw(16) << "corpus" << std::right << std::setw(12) << "hot paths" << std::setw(16) << "profiled paths"
+					<< std::setw(14) << "original ns" << std::setw(14) << "relaid ns" << std::setw(10) << "speedup" << "\n";
+				for (const RelayoutResult &r : results)
+				{
+					out << std::left << std::setw(16) << r.label << std::right << std::setw(12) << r.hotPaths << std::setw(16) << r.profiledPaths
+						<< std::fixed << std::setprecision(1) << std::setw(14) << r.originalNs << std::setw(14) << r.relaidNs
+						<< std::setprecision(2) << std::setw(10) << r.originalNs / r.relaidNs << "\n";
+					out.unsetf(std::ios::fixed);
+				}
+				break;
+			}
+			out.flush();
+		}
+	}
+
+	int runRelayout(const Arguments &args)
+	{
+		double hotFraction = args.getDouble("hot", 0.02);
+		double hotShare = args.getDouble("hot-share", 0.98);
+		uint64_t lookups = args.getSize("lookups", 1000000);
+		std::vector<RelayoutResult> results;
+
+		forEachCorpus(args, [&](const string &label, const string &path, const string &tableName) {
+			LuaState state;
+			state.loadFile(path);
+			Table original = state.getGlobalTable(tableName);
+			SnapshotSampler sampler(original, 1 << 16, 11);
+			if (sampler.valuePaths.empty())
+				throw std::runtime_error("the snapshot of " + label + " has no values");
+			std::size_t hot = std::max<std::size_t>(1, (std::size_t)(sampler.valuePaths.size() * hotFraction));
+
+			// profile a tenth of the measured workload, as a running process would
+			clearAccessRecording();
+			startAccessRecording();
+			lookupNs(original, sampler.valuePaths, hot, hotShare, lookups / 10 + 1);
+			stopAccessRecording();
+			AccessProfile profile = AccessProfile::capture(original);
+			clearAccessRecording();
+			if (args.has("profile"))
+			{
+				std::ofstream file(args.get("profile", "").c_str());
+				profile.save(file);
+			}
+
+			Table relaid = original.relayout(profile);
+			RelayoutResult result = { label, hot, profile.size(), 0.0, 0.0 };
+			// alternate so both tables see the same cache and frequency conditions
+			for (int round = 0; round < 3; ++round)
+			{
+				double originalNs = lookupNs(original, sampler.valuePaths, hot, hotShare, lookups);
+				double relaidNs = lookupNs(relaid, sampler.valuePaths, hot, hotShare, lookups);
+				result.originalNs = round == 0 ? originalNs : std::min(result.originalNs, originalNs);
+				result.relaidNs = round == 0 ? relaidNs : std::min(result.relaidNs, relaidNs);
+			}
+			results.push_back(result);
+		}, "1M,16M");
+		reportRelayout(results, parseFormat(args), std::cout);
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,144 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		const char *const LEVEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+		struct ScanResult
+		{
+			string label;
+			string level;
+			uint64_t bytes;
+			uint64_t parseNs;
+			uint64_t vmNs;
+		};
+
+		/** the fastest of @p rounds parses of @p source*/
+		uint64_t timeParse(const string &source, int rounds)
+		{
+			uint64_t best = UINT64_MAX;
+			for (int round = 0; round < rounds; ++round)
+			{
+				Table globals;
+				uint64_t start = nowNs();
+				if (!DataLoader::parse(source, globals))
+					throw std::runtime_error("the corpus is not data only");
+				uint64_t elapsed = nowNs() - start;
+				doNotOptimize(globals);
+				if (elapsed < best)
+					best = elapsed;
+			}
+			return best;
+		}
+
+		void scanCorpus(const string &label, const string &source, int rounds, std::vector<ScanResult> &results)
+		{
+			uint64_t start = nowNs();
+			{
+				LuaState state;
+				state.loadString(source);
+				Table globals = state.getGlobals();
+				doNotOptimize(globals);
+			}
+			uint64_t vmNs = nowNs() - start;
+
+			ScanLevel previous = scanLevel();
+			for (int level = 0; level <= (int)supportedScanLevel(); ++level)
+			{
+				setScanLevel((ScanLevel)level);
+				ScanResult result = { label, LEVEL_NAMES[level], source.size(), timeParse(source, rounds), vmNs };
+				results.push_back(result);
+			}
+			setScanLevel(previous);
+		}
+
+		string generated(CorpusOptions options)
+		{
+			std::ostringstream out;
+			generateCorpus(options, out);
+			return out.str();
+		}
+	}
+
+	int runScan(const Arguments &args)
+	{
+		int rounds = (int)args.getSize("rounds", 3);
+		std::vector<ScanResult> results;
+		string file = args.get("file", "");
+		if (!file.empty())
+		{
+			std::ifstream in(file.c_str(), std::ios::binary);
+			if (!in)
+				throw std::runtime_error("could not open " + file);
+			std::ostringstream contents;
+			contents << in.rdbuf();
+			scanCorpus(file, contents.str(), rounds, results);
+		}
+		else
+		{
+			// a manifest of long strings and a table of numbers
+			CorpusOptions strings = corpusOptions(args);
+			strings.size = args.getSize("size", 16 << 20);
+			strings.numericDensity = 0.05;
+			strings.stringLength = args.getDouble("string-length", 64);
+			scanCorpus("strings", generated(strings), rounds, results);
+
+			CorpusOptions numbers = corpusOptions(args);
+			numbers.size = strings.size;
+			numbers.numericDensity = 0.95;
+			numbers.arrayRatio = 0.75;
+			scanCorpus("numbers", generated(numbers), rounds, results);
+		}
+
+		switch (parseFormat(args))
+		{
+		case Format::JSON:
+			std::cout << "{\"scan\":[";
+			for (std::size_t i = 0; i < results.size(); ++i)
+			{
+				const ScanResult &r = results[i];
+				std::cout << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"level\":\"" << r.level
+					<< "\",\"bytes\":" << r.bytes << ",\"parse_ms\":" << r.parseNs / 1e6
+					<< ",\"mb_per_s\":" << r.bytes / 1048576.0 / (r.parseNs / 1e9) << ",\"vm_ms\":" << r.vmNs / 1e6 << "}";
+			}
+			std::cout << "\n]}\n";
+			break;
+		case Format::CSV:
+			std::cout << "name,level,bytes,parse_ms,mb_per_s,vm_ms\n";
+			for (const ScanResult &r : results)
+			{
+				std::cout << r.label << "," << r.level << "," << r.bytes << "," << r.parseNs / 1e6 << ","
+					<< r.bytes / 1048576.0 / (r.parseNs / 1e9) << "," << r.vmNs / 1e6 << "\n";
+			}
+			break;
+		case Format::TEXT:
+			std::cout << std::left << std::setw(24) << "corpus" << std::setw(8) << "level" << std::right << std::setw(14) << "bytes"
+				<< std::setw(12) << "parse ms" << std::setw(10) << "MB/s" << std::setw(12) << "vm ms" << "\n";
+			for (const ScanResult &r : results)
+			{
+				std::cout << std::left << std::setw(24) << r.label << std::setw(8) << r.level << std::right << std::setw(14) << r.bytes
+					<< std::fixed << std::setprecision(2) << std::setw(12) << r.parseNs / 1e6
+					<< std::setprecision(1) << std::setw(10) << r.bytes / 1048576.0 / (r.parseNs / 1e9)
+					<< std::setprecision(2) << std::setw(12) << r.vmNs / 1e6 << "\n";
+				std::cout.unsetf(std::ios::fixed);
+			}
+			break;
+		}
+		return 0;
+	}
+
+}
+}
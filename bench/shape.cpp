@@ -0,0 +1,40 @@
+#include <iostream>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+
+	int runShape(const Arguments &args)
+	{
+		Format format = parseFormat(args);
+		std::size_t top = (std::size_t)args.getSize("top", 20);
+		bool first = true;
+		if (format == Format::JSON)
+			std::cout << "{\"shape\":[";
+		forEachCorpus(args, [&](const string &label, const string &path, const string &tableName) {
+			LuaState state;
+			state.loadFile(path);
+			// walk the lua table directly, the report doesn't need a snapshot
+			ShapeAnalyzer analyzer(top);
+			state.visitGlobalTable(tableName, analyzer);
+			ShapeReport report = analyzer.report();
+			if (format == Format::JSON)
+				std::cout << (first ? "\n" : ",\n") << "{\"name\":\"" << jsonEscape(label) << "\",\"report\":" << report.toJson() << "}";
+			else
+			{
+				std::cout << (first ? "" : "\n") << "[" << label << "]\n";
+				report.write(std::cout);
+			}
+			first = false;
+		}, "64K");
+		if (format == Format::JSON)
+			std::cout << "\n]}\n";
+		return 0;
+	}
+
+}
+}
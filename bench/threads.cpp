@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "luapath/luapath.hpp"
+
+namespace luapath{
+namespace bench{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		enum class Operation{ GET_VALUE, GET_TABLE, TO_ARRAY };
+
+		/** @brief What every reader thread works on. Shared read only between all threads*/
+		struct Workload
+		{
+			const Table *root;
+			const SnapshotSampler *sampler;
+			/** percentages of getValue and getTable, the rest is toArray*/
+			unsigned valuePercent;
+			unsigned tablePercent;
+			uint64_t opsPerThread;
+		};
+
+		struct ThreadResult
+		{
+			std::vector<std::uint32_t> latencies;
+		};
+
+		void reader(const Workload &work, unsigned index, const std::atomic<bool> &go, ThreadResult &result)
+		{
+			Random random(1000 + index);
+			const SnapshotSampler &sampler = *work.sampler;
+			result.latencies.reserve((std::size_t)work.opsPerThread);
+			while (!go.load(std::memory_order_acquire))
+				std::this_thread::yield();
+
+			for (uint64_t i = 0; i < work.opsPerThread; ++i)
+			{
+				unsigned pick = (unsigned)random.below(100);
+				Operation op = pick < work.valuePercent ? Operation::GET_VALUE :
+					pick < work.valuePercent + work.tablePercent ? Operation::GET_TABLE : Operation::TO_ARRAY;
+				if (op != Operation::GET_VALUE && sampler.tables.empty())
+					op = Operation::GET_VALUE;
+
+				uint64_t start = nowNs();
+				switch (op)
+				{
+				case Operation::GET_VALUE:
+					doNotOptimize(work.root->getValue(sampler.valuePaths[(std::size_t)random.below(sampler.valuePaths.size())]));
+					break;
+				case Operation::GET_TABLE:
+					doNotOptimize(work.root->getTable(sampler.tablePaths[(std::size_t)random.below(sampler.tablePaths.size())]));
+					break;
+				case Operation::TO_ARRAY:
+					doNotOptimize(sampler.tables[(std::size_t)random.below(sampler.tables.size())]->toArray<string>());
+					break;
+				}
+				uint64_t elapsed = nowNs() - start;
+				result.latencies.push_back((std::uint32_t)std::min<uint64_t>(elapsed, 0xFFFFFFFFu));
+			}
+		}
+
+		struct ScalingResult
+		{
+			string label;
+			unsigned threads;
+			uint64_t ops;
+			double seconds;
+			double p50, p99, p999, max;
+		};
+
+		double percentile(const std::vector<std::uint32_t> &sorted, double fraction)
+		{
+			if (sorted.empty())
+				return 0.0;
+			std::size_t index = (std::size_t)(fraction * (sorted.size() - 1) + 0.5);
+			return sorted[std::min(index, sorted.size() - 1)];
+		}
+
+		ScalingResult runThreads(const string &label, const Workload &work, unsigned threadCount)
+		{
+			std::vector<ThreadResult> results(threadCount);
+			std::vector<std::thread> threads;
+			std::atomic<bool> go(false);
+			for (unsigned i = 0; i < threadCount; ++i)
+				threads.push_back(std::thread(reader, std::cref(work), i, std::cref(go), std::ref(results[i])));
+
+			// give the threads a moment to reach the start line
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			uint64_t start = nowNs();
+			go.store(true, std::memory_order_release);
+			for (std::thread &thread : threads)
+				thread.join();
+			uint64_t elapsed = nowNs() - start;
+
+			std::vector<std::uint32_t> all;
+			all.reserve((std::size_t)(work.opsPerThread * threadCount));
+			for (const ThreadResult &result : results)
+				all.insert(all.end(), result.latencies.begin(), result.latencies.end());
+			std::sort(all.begin(), all.end());
+
+			ScalingResult scaling = { label, threadCount, (uint64_t)all.size(), elapsed / 1e9,
+				percentile(all, 0.5), percentile(all, 0.99), percentile(all, 0.999), all.empty() ? 0.0 : all.back() };
+			return scaling;
+		}
+
+		void reportScaling(const std::vector<ScalingResult> &results, Format format, std::ostream &out)
+		{
+			switch (format)
+			{
+			case Format::JSON:
+				out << "{\"threads\":[";
+				for (std::size_t i = 0; i < results.size(); ++i)
+				{
+					const ScalingResult &r = results[i];
+					out << (i ? "," : "") << "\n{\"name\":\"" << jsonEscape(r.label) << "\",\"threads\":" << r.threads
+						<< ",\"ops\":" << r.ops << ",\"seconds\":" << r.seconds << ",\"ops_per_second\":" << r.ops / r.seconds
+						<< ",\"p50_ns\":" << r.p50 << ",\"p99_ns\":" << r.p99 << ",\"p999_ns\":" << r.p999 << ",\"max_ns\":" << r.max << "}";
+				}
+				out << "\n]}\n";
+				break;
+			case Format::CSV:
+				out << "name,threads,ops,seconds,ops_per_second,p50_ns,p99_ns,p999_ns,max_ns\n";
+				for (const ScalingResult &r : results)
+				{
+					out << r.label << "," << r.threads << "," << r.ops << "," << r.seconds << "," << r.ops / r.seconds << ","
+						<< r.p50 << "," << r.p99 << "," << r.p999 << "," << r.max << "\n";
+				}
+				break;
+			case Format::TEXT:
+				out << std::left << std::setw(16) << "corpus" << std::right << std::setw(8) << "threads" << std::setw(16) << "ops/s"
+					<< std::setw(12) << "speedup" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns"
+					<< std::setw(12) << "p999 ns" << std::setw(12) << "max ns" << "\n";
+				for (const ScalingResult &r : results)
+				{
+					const ScalingResult &single = results.front();
+					out << std::left << std::setw(16) << r.label << std::right << std::setw(8) << r.threads << std::fixed
+						<< std::setprecision(0) << std::setw(16) << r.ops / r.seconds << std::setprecision(2) << std::setw(12)
+						<< (r.ops / r.seconds) / (single.ops / single.seconds) << std::setprecision(0) << std::setw(12) << r.p50
+						<< std::setw(12) << r.p99 << std::setw(12) << r.p999 << std::setw(12) << r.max << "\n";
+					out.unsetf(std::ios::fixed);
+				}
+				break;
+			}
+			out.flush();
+		}
+
+		std::vector<unsigned> threadCounts(const Arguments &args)
+		{
+			std::vector<unsigned> counts;
+			if (args.has("threads"))
+			{
+				std::istringstream list(args.get("threads", ""));
+				string count;
+				while (std::getline(list, count, ','))
+					counts.push_back((unsigned)std::stoul(count));
+				return counts;
+			}
+			unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+			for (unsigned count = 1; count < hardware; count *= 2)
+				counts.push_back(count);
+			counts.push_back(hardware);
+			return counts;
+		}
+	}
+
+	int runThreads(const Arguments &args)
+	{
+		std::vector<unsigned> counts = threadCounts(args);
+		std::istringstream mix(args.get("mix", "60,30,10"));
+		string part;
+		std::vector<unsigned> percents;
+		while (std::getline(mix, part, ','))
+			percents.push_back((unsigned)std::stoul(part));
+		if (percents.size() != 3 || percents[0] + percents[1] + percents[2] != 100)
+			throw std::invalid_argument("--mix needs three percentages adding up to 100");
+
+		std::vector<ScalingResult> results;
+		forEachCorpus(args, [&](const string &label, const string &path, const string &tableName) {
+			LuaState state;
+			state.loadFile(path);
+			const Table root = state.getGlobalTable(tableName);
+			SnapshotSampler sampler(root, 4096, 7);
+			if (sampler.valuePaths.empty())
+				throw std::runtime_error("the snapshot of " + label + " has no values");
+
+			Workload work = { &root, &sampler, percents[0], percents[1], args.getSize("ops", 100000) };
+			for (unsigned count : counts)
+				results.push_back(runThreads(label, work, count));
+		}, "1M");
+		reportScaling(results, parseFormat(args), std::cout);
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,67 @@
+#ifndef ACCESSPROFILE_HPP
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+namespace luapath
+{
+	class Table;
+
+	/** @brief Starts counting the tables and values visited by Table::getValue and Table::getTable
+		@details The visits are counted per node of the snapshot in every thread until
+		luapath::stopAccessRecording. Use AccessProfile::capture to turn the counts into paths.
+		Lookups on a copy of a table (e.g. the result of Table::getTable) are counted for the nodes of the copy.
+		Counting allocates the first time a thread visits a node, also in lookups like Table::tryGetValue
+		and Table::contains which otherwise never allocate.
+	*/
+	void startAccessRecording();
+
+	void stopAccessRecording();
+
+	/** true iff visits are being counted*/
+	bool accessRecording();
+
+	/** @brief Drops all the counted visits. Needed before recording another snapshot
+		as a new snapshot can reuse the addresses of a destroyed one*/
+	void clearAccessRecording();
+
+	/** @brief How often every path of a table was visited by lookups
+		@details A path is relative to the profiled table in the syntax of Table::getValue e.g. ".servers#3.host",
+		the table itself has the empty path. A lookup counts a visit for every table on its way and for the value it returns.
+		Profiles can be saved, loaded and merged so they can be collected in one process and used by a later one.
+	*/
+	class  AccessProfile
+	{
+	public:
+		/** the counts recorded for the nodes of @p root and everything below it*/
+		static AccessProfile capture(const Table &root);
+
+		/** @brief Reads a profile written by AccessProfile::save
+			@throws std::runtime_error if @p in is not a profile */
+		static AccessProfile load(std::istream &in);
+
+		/** @brief Writes one "count path" line per visited path, most visited first*/
+		void save(std::ostream &out) const;
+
+		/** the number of visits of @p path, 0 if it wasn't visited*/
+		std::uint64_t count(const std::string &path) const;
+
+		/** the number of visited paths*/
+		std::size_t size() const;
+
+		/** adds the counts of @p other*/
+		void merge(const AccessProfile &other);
+
+	private:
+		typedef std::unordered_map<const void*, std::uint64_t> NodeCounts;
+
+		/** adds the counts of the nodes below @p table whose path is @p path*/
+		void resolve(const NodeCounts &nodes, const Table &table, std::string &path);
+
+		std::unordered_map<std::string, std::uint64_t> counts;
+	};
+}
+#endif // !ACCESSPROFILE_HPP
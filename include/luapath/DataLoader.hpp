@@ -0,0 +1,62 @@
+#ifndef DATALOADER_HPP
+#pragma once
+
+#include <string>
+
+#include "LuaState.hpp"
+#include "LuaTypes.hpp"
+
+namespace luapath
+{
+	/** @brief The instruction set used by the DataLoader to scan strings, whitespace, comments and numbers
+		@details The best level supported by the CPU is picked at runtime. SSE2 and AVX2 are only
+		available on x86 builds with GCC or Clang, elsewhere everything is scanned a byte at a time.
+	*/
+	enum class ScanLevel{ SCALAR, SSE2, AVX2 };
+
+	/** the best ScanLevel of the CPU the program runs on*/
+	ScanLevel supportedScanLevel();
+
+	/** the ScanLevel used by the DataLoader, supportedScanLevel unless set with setScanLevel*/
+	ScanLevel scanLevel();
+
+	/** @brief Makes the DataLoader use @p level, e.g. to compare the levels
+		@return the level actually used, at most supportedScanLevel
+	*/
+	ScanLevel setScanLevel(ScanLevel level);
+
+	/** @brief Loads lua files that only hold data straight into a Table
+		@details A data only chunk is a list of global assignments "name = value" where every value is
+		a string, number, boolean or nil literal or a table constructor of such values, e.g.
+		@code
+		config = { name = "app", ports = { 80, 443 }, ["log-level"] = 2, debug = false }
+		@endcode
+		Such a chunk is parsed in a single pass without the lua compiler, virtual machine or snapshot.
+		Anything else (function calls, expressions, local variables, ...) makes the loader run the chunk
+		in a LuaState instead and snapshot the globals it defined, so the result is the same either way.
+	*/
+	class  DataLoader
+	{
+	public:
+		/** @brief Parses @p source if it is data only
+			@return false, leaving @p globals unchanged, if @p source is anything else
+		*/
+		static bool parse(const std::string &source, Table &globals);
+
+		/** @brief The globals defined by @p source as the fields of a Table with an empty key
+			@throws lua_state_exception if @p source had to be run and failed
+		*/
+		static Table loadString(const std::string &source, const LoadOptions &options = LoadOptions());
+
+		/** @brief The globals defined by the file @p filepath as the fields of a Table with an empty key
+			@throws lua_state_exception if the file can't be read or had to be run and failed
+		*/
+		static Table loadFile(const std::string &filepath, const LoadOptions &options = LoadOptions());
+
+	private:
+		class Parser;
+
+		static bool parse(const char *begin, const char *end, Table &globals);
+	};
+}
+#endif // !DATALOADER_HPP
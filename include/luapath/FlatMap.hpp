@@ -0,0 +1,158 @@
+#ifndef FLATMAP_HPP
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace luapath
+{
+	/** @brief An ordered map stored as a sorted vector
+		@details Used for the contents of a Table. The snapshot knows the number of fields of a lua table
+		before it is read, so the storage is allocated once and filled with FlatMap::append.
+		After appending FlatMap::sort must be called before looking anything up.
+		Lookups are binary searches over contiguous memory.
+	*/
+	template<class K, class V>
+	class FlatMap
+	{
+	public:
+		typedef K key_type;
+		typedef V mapped_type;
+		typedef std::pair<K, V> value_type;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+		typedef const_iterator iterator;
+		typedef typename std::vector<value_type>::size_type size_type;
+
+		const_iterator begin() const { return items.begin(); }
+		const_iterator end() const { return items.end(); }
+		size_type size() const { return items.size(); }
+		bool empty() const { return items.empty(); }
+		size_type capacity() const { return items.capacity(); }
+
+		void reserve(size_type count) { items.reserve(count); }
+
+		/** Adds an element at the end without keeping the order. Call FlatMap::sort when done
+			@return the added element. It stays valid as long as no more than the reserved number of elements is appended*/
+		template<class KeyArg, class ValueArg>
+		value_type &append(KeyArg &&key, ValueArg &&value)
+		{
+			items.emplace_back(std::forward<KeyArg>(key), std::forward<ValueArg>(value));
+			return items.back();
+		}
+
+		/** Orders the appended elements. If a key was appended more than once the last one is kept*/
+		void sort()
+		{
+			if (isStrictlyOrdered())
+				return;
+			// most tables are small. Insertion sort is stable and unlike std::stable_sort needs no buffer
+			if (items.size() <= INSERTION_SORT_LIMIT)
+				insertionSort();
+			else
+				std::stable_sort(items.begin(), items.end(), KeyCompare());
+			typename std::vector<value_type>::iterator out = items.begin();
+			for (typename std::vector<value_type>::iterator it = items.begin(); it != items.end(); ++it)
+			{
+				typename std::vector<value_type>::iterator next = it + 1;
+				if (next != items.end() && !(it->first < next->first))
+					continue;
+				if (out != it)
+					*out = std::move(*it);
+				++out;
+			}
+			items.erase(out, items.end());
+		}
+
+		/** Removes the elements for which @p remove returns true and keeps the order of the others*/
+		template<class Predicate>
+		void erase_if(Predicate remove)
+		{
+			items.erase(std::remove_if(items.begin(), items.end(), remove), items.end());
+		}
+
+		const_iterator lower_bound(const K &key) const
+		{
+			return std::lower_bound(items.begin(), items.end(), key, KeyCompare());
+		}
+
+		const_iterator upper_bound(const K &key) const
+		{
+			return std::upper_bound(items.begin(), items.end(), key, KeyCompare());
+		}
+
+		std::pair<const_iterator, const_iterator> equal_range(const K &key) const
+		{
+			const_iterator first = lower_bound(key);
+			if (first != items.end() && !(key < first->first))
+				return std::make_pair(first, first + 1);
+			return std::make_pair(first, first);
+		}
+
+		const_iterator find(const K &key) const
+		{
+			const_iterator it = lower_bound(key);
+			if (it != items.end() && !(key < it->first))
+				return it;
+			return items.end();
+		}
+
+		/** Like FlatMap::find for a @p probe that is not a K, e.g. to look up a key without constructing it.
+			@p less compares a K with a Probe both ways and must order them like K::operator< orders keys*/
+		template<class Probe, class Less>
+		const_iterator find(const Probe &probe, Less less) const
+		{
+			const_iterator it = std::lower_bound(items.begin(), items.end(), probe,
+				[&less](const value_type &item, const Probe &other) { return less(item.first, other); });
+			if (it != items.end() && !less(probe, it->first))
+				return it;
+			return items.end();
+		}
+
+		size_type count(const K &key) const
+		{
+			return find(key) != items.end() ? 1 : 0;
+		}
+
+	private:
+		static const size_type INSERTION_SORT_LIMIT = 32;
+
+		/** true iff the elements are sorted and there are no duplicate keys*/
+		bool isStrictlyOrdered() const
+		{
+			for (const_iterator it = items.begin(); it != items.end() && it + 1 != items.end(); ++it)
+			{
+				if (!(it->first < (it + 1)->first))
+					return false;
+			}
+			return true;
+		}
+
+		void insertionSort()
+		{
+			for (typename std::vector<value_type>::iterator it = items.begin() + 1; it < items.end(); ++it)
+			{
+				if (!(it->first < (it - 1)->first))
+					continue;
+				value_type moved(std::move(*it));
+				typename std::vector<value_type>::iterator hole = it;
+				do
+				{
+					*hole = std::move(*(hole - 1));
+					--hole;
+				} while (hole != items.begin() && moved.first < (hole - 1)->first);
+				*hole = std::move(moved);
+			}
+		}
+
+		struct KeyCompare
+		{
+			bool operator()(const value_type &lhs, const value_type &rhs) const { return lhs.first < rhs.first; }
+			bool operator()(const value_type &lhs, const K &rhs) const { return lhs.first < rhs; }
+			bool operator()(const K &lhs, const value_type &rhs) const { return lhs < rhs.first; }
+		};
+
+		std::vector<value_type> items;
+	};
+}
+#endif // !FLATMAP_HPP
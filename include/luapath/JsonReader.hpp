@@ -0,0 +1,40 @@
+#ifndef JSONREADER_HPP
+#pragma once
+
+#include <string>
+
+#include "LuaTypes.hpp"
+
+namespace luapath
+{
+	/** @brief Builds a Table straight from JSON text without a lua state
+		@details The document has to be an object or an array, which becomes the returned Table.
+		Objects become tables with STRING keys, arrays tables with NUMBER keys 1, 2, 3, ...,
+		so the result can be looked up exactly like a snapshot of the same data loaded into lua.
+		A null is left out like a nil in a lua table constructor, in an array it leaves a hole.
+		Repeated names in an object keep the last value, so a null after a value removes the name.
+		Numbers are stored like the snapshots store them. Strings are copied byte for byte with the
+		escapes decoded to UTF-8. The text is parsed in a single pass that appends straight to the Table.
+	*/
+	class  JsonReader
+	{
+	public:
+		/** @brief The Table of the JSON document @p json with the key @p tableKey
+			@throws json_parse_exception if @p json is not valid JSON, its root is not an object or array,
+			or an object has the same key for a value and an object or array
+		*/
+		static Table parse(const std::string &json, const Key &tableKey = Key(std::string()));
+
+		/** @brief Same as JsonReader::parse for [begin, end)*/
+		static Table parse(const char *begin, const char *end, const Key &tableKey = Key(std::string()));
+
+		/** @brief The Table of the JSON file @p filepath with the key @p tableKey
+			@throws json_parse_exception if the file can't be read or is not valid JSON
+		*/
+		static Table loadFile(const std::string &filepath, const Key &tableKey = Key(std::string()));
+
+	private:
+		class Parser;
+	};
+}
+#endif // !JSONREADER_HPP
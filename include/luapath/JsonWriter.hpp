@@ -0,0 +1,39 @@
+#ifndef JSONWRITER_HPP
+#pragma once
+
+#include <string>
+
+#include "LuaState.hpp"
+#include "LuaTypes.hpp"
+#include "OutputSink.hpp"
+
+namespace luapath
+{
+	/** @brief Writes tables as JSON
+		@details A table whose keys are exactly the numbers 1 to n becomes an array, any other table an
+		object whose number keys are written as strings. An empty table becomes {}. Only the contents of
+		the table are written, not its key. Numbers keep their shortest round trip form, inf and nan become
+		null. Strings are copied byte for byte apart from the escapes JSON requires, so the output is
+		valid UTF-8 as long as the lua strings are.
+		The output is formatted into a buffer of the writer and handed to the OutputSink in chunks.
+	*/
+	class  JsonWriter
+	{
+	public:
+		/** @brief Writes @p table to @p sink*/
+		static void write(const Table &table, OutputSink &sink, WriteStyle style = WriteStyle::COMPACT);
+
+		/** @brief Writes the global table @p tableName of @p state to @p sink straight from the lua state
+			@details Nothing is copied into a Table. The fields of an object come in the order of lua_next.
+			Fields that can't be represented (e.g. functions) are skipped like LuaState::getGlobalTable does.
+			@throws path_lookup_exception if there is no such global, type_mismatch_exception if it is not
+			a table, lua_state_exception if the tables are nested too deeply e.g. because a table contains itself.
+			The sink may have been written to already when it throws
+		*/
+		static void write(LuaState &state, const std::string &tableName, OutputSink &sink, WriteStyle style = WriteStyle::COMPACT);
+
+		/** @brief The JSON text of @p table as a string*/
+		static std::string toString(const Table &table, WriteStyle style = WriteStyle::COMPACT);
+	};
+}
+#endif // !JSONWRITER_HPP
@@ -0,0 +1,94 @@
+#ifndef LATENCYHISTOGRAM_HPP
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace luapath
+{
+	/** @brief A log-linear histogram of nanosecond latencies in the style of HdrHistogram
+		@details Values below 128ns are kept exactly. Above that every power of two is split into
+		64 buckets so a reported percentile is at most 1.6% above the recorded value.
+		Values are capped at 2^36ns (about 68 seconds). The buckets are allocated on the first record.
+	*/
+	class  LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		void record(std::uint64_t ns);
+
+		/** Adds all the values recorded by @p other*/
+		void merge(const LatencyHistogram &other);
+
+		std::uint64_t count() const;
+
+		/** the exact smallest and largest recorded values, 0 if nothing was recorded*/
+		std::uint64_t min() const;
+		std::uint64_t max() const;
+
+		double mean() const;
+
+		/** @brief The value below which @p percentile percent of the recorded values fall
+			@param percentile between 0 and 100 e.g. 99.9
+		*/
+		std::uint64_t percentile(double percentile) const;
+
+		void clear();
+
+	private:
+		static std::size_t bucketIndex(std::uint64_t ns);
+
+		/** the largest value that falls into the bucket with index @p index*/
+		static std::uint64_t bucketLimit(std::size_t index);
+
+		std::vector<std::uint64_t> buckets;
+		std::uint64_t total;
+		std::uint64_t sum;
+		std::uint64_t minValue;
+		std::uint64_t maxValue;
+	};
+
+	/** @brief Labels the lookups of the current thread while it is in scope
+		@details While latency histograms are enabled the lookups made by Table::getValue,
+		Table::getTable and LuaState::getGlobalValue are recorded under @p label instead of
+		their path prefix. @p label has to outlive the LookupSite, normally it is a string literal.
+		Sites nest: the innermost one is used.
+	*/
+	class  LookupSite
+	{
+	public:
+		explicit LookupSite(const char *label);
+		~LookupSite();
+	private:
+		LookupSite(const LookupSite &);
+		LookupSite& operator=(const LookupSite &);
+
+		const char *previous;
+	};
+
+	/** @brief Turns the recording of lookup latencies on or off for all threads. Off by default*/
+	void enableLatencyHistograms(bool enabled);
+
+	/** true iff lookup latencies are being recorded*/
+	bool latencyHistogramsEnabled();
+
+	/** @brief How many fields of a search path name its histogram when there is no LookupSite
+		@details With the default of 2 a lookup of ".bmw.price.base" on the table "cars" is recorded
+		under "getValue cars.bmw.price".
+	*/
+	void setLatencyPrefixDepth(unsigned fields);
+
+	/** @brief The histograms of all threads merged by call site or path prefix*/
+	std::map<std::string, LatencyHistogram> latencyHistograms();
+
+	/** @brief Writes count, p50, p99, p99.9 and max in nanoseconds for every call site*/
+	void writeLatencyReport(std::ostream &out);
+
+	/** @brief Drops all recorded latencies*/
+	void resetLatencyHistograms();
+}
+#endif // !LATENCYHISTOGRAM_HPP
@@ -1,17 +1,69 @@
 #ifndef LUASTATE_HPP
 #pragma once
 
+#include <cstdint>
 #include <string>
 
-#include "luapath.hpp"
+#include "LuaTypes.hpp"
+#include "TableEdit.hpp"
+#include "exceptions.hpp"
 
 struct lua_State;
+struct lua_Debug;
 
 namespace luapath
 {
 	class  Table;
 	struct  Key;
 	struct  Value;
+	struct  KeyRef;
+	class  TableVisitor;
+	class  ScriptProfiler;
+	class  Encoder;
+
+	/** @brief What the lua garbage collector does while a script is compiled and run
+		@details A config is mostly live data, so collecting while it loads traverses a growing heap
+		without finding much garbage. The collector is set back to incremental after the load.
+	*/
+	enum class GcPolicy
+	{
+		/** lua's default incremental collector*/
+		INCREMENTAL,
+		/** no collection at all during the load. The heap keeps all the garbage of the compiler*/
+		STOPPED,
+		/** the generational mode of lua 5.2, which frees the short lived garbage of the compiler early*/
+		GENERATIONAL
+	};
+
+	/** @brief Optional behaviour of LuaState::loadString and LuaState::loadFile*/
+	struct  LoadOptions
+	{
+		LoadOptions();
+
+		/** if not null samples the call stack of the script while it runs. See ScriptProfiler*/
+		ScriptProfiler *profiler;
+
+		/** abort the script once it ran this many lua instructions, 0 for no limit.
+			Checked every 1000 instructions so the script may run up to 999 more*/
+		std::uint64_t instructionBudget;
+
+		/** abort the load once compiling and running took longer than this many milliseconds, 0 for no limit*/
+		std::uint64_t timeBudgetMs;
+
+		/** the collector during the load, see GcPolicy. Counted in Stats::gcTunedLoads*/
+		GcPolicy gcPolicy;
+
+		/** @brief the pause of the collector in percent during the load (LUA_GCSETPAUSE), 0 keeps lua's 200
+			@details A collection starts once the heap grew by this much since the last one. Ignored if STOPPED*/
+		int gcPause;
+
+		/** @brief the expected size of the source in bytes, 0 if unknown
+			@details Sizes the string table of the state for the strings of that much source up front
+			instead of growing it by doubling. Only with the bundled lua, whose internals the library can
+			reach, and most useful with GcPolicy::STOPPED as a collection shrinks a mostly empty table.
+			Counted in Stats::stringTableSlots*/
+		std::size_t expectedSourceBytes;
+	};
 
 	/** @brief Encapsulates the raw Lua state
 		@details Provides wrapper function for some commonly used lua functions.
@@ -34,12 +86,32 @@ namespace luapath
 		/** @brief Load a file as a string onto the lua state*/
 		void loadFile(const std::string &filepath);
 
+		/** @brief Same as LuaState::loadString with the extras of @p options
+			@throws budget_exceeded_exception if a budget of @p options ran out. The state is closed*/
+		void loadString(const std::string &str, const LoadOptions &options);
+
+		/** @brief Same as LuaState::loadFile with the extras of @p options
+			@throws budget_exceeded_exception if a budget of @p options ran out. The state is closed*/
+		void loadFile(const std::string &filepath, const LoadOptions &options);
+
 		/** @brief Checks whether the state is loaded
 			@return true if a successful call to LuaState::loadString or LuaState::loadFile has been made */
 		bool isLoaded() const;
+
+		/** @brief The number of bytes currently allocated by the lua state as reported by lua_gc*/
+		std::size_t heapSize() const;
+
+		/** @brief Runs a full garbage collection cycle of the lua state*/
+		void collectGarbage();
 		
 		/** @brief Get a Value object with name @p fieldName from the global scope in the loaded lua state*/
 		Value getGlobalValue(const std::string &fieldName);
+
+		/** @brief Same as LuaState::getGlobalValue but returns the reason instead of throwing
+			@details The Value is only stored in @p value if the result is FOUND. A miss doesn't allocate.
+			@return FOUND, NOT_FOUND or NOT_A_VALUE if the global is a table or function
+		*/
+		LookupStatus tryGetGlobalValue(const std::string &fieldName, Value &value);
 		
 		/** @brief Get a Table object with name @p tableName from the global scope in the loaded lua state
 			Recursively traverse the lua table and constructs a full representation of the lua object by
@@ -47,9 +119,86 @@ namespace luapath
 		*/
 		Table getGlobalTable(const std::string &tableName) ;
 
+		/** @brief A Table holding every global variable of the loaded lua state
+			@details The globals are the fields of the returned table, which has an empty key.
+			Globals that can't be represented (e.g. functions) are skipped.
+		*/
+		Table getGlobals();
+
+		/** @brief Walk the global table @p tableName without building a Table
+			@details Calls the callbacks of @p visitor for every nested table and every
+			string, number or boolean value in the order given by lua_next.
+			String keys and values are passed as pointers into the lua state so nothing is allocated.
+			Fields whose key or value can't be represented (e.g. functions) are skipped.
+			@throws lua_state_exception if tables are nested more than 1000 deep, e.g. a table that contains itself
+		*/
+		void visitGlobalTable(const std::string &tableName, TableVisitor &visitor);
+
+		/** @brief A TableEdit of the global table @p tableName, which doesn't need to exist yet
+			@details An empty @p tableName edits the globals themselves, e.g. the path ".N1" is the global N1.
+		*/
+		TableEdit editGlobalTable(const std::string &tableName);
+
 	private:
-		/** @brief helper function to LuaState::getGlobalTable */
-		void getTableContents(Table &currTable, int tableIndex);
+		friend class TableEdit;
+		friend class JsonWriter;
+		friend class MessagePackWriter;
+
+		/** @brief Writes the changes of @p edit into the lua state. Helper function to TableEdit::apply
+			@return the number of changes written. Less than all of them if a set found a value where it needed a table
+		*/
+		std::size_t applyEdit(const TableEdit &edit);
+
+		/** @brief The progress of a script run with LoadOptions that need the hook*/
+		struct RunningLoad;
+
+		/** @brief runs the chunk compiled by LuaState::loadString or LuaState::loadFile
+			@details Throws lua_state_exception and closes the state if @p loadError or the run failed.
+			@p startNs is when the load started on the clock of the time budget, @p previousPause
+			what LuaState::prepareCollector returned*/
+		void execute(int loadError, const LoadOptions &options, std::uint64_t startNs, int previousPause);
+
+		/** @brief Sets up the collector of the state as @p options ask for before a load
+			@return the pause to restore after the load or 0 if it wasn't changed*/
+		int prepareCollector(const LoadOptions &options);
+
+		/** @brief Sets the collector back after a successful load. Helper function to LuaState::execute*/
+		void restoreCollector(const LoadOptions &options, int previousPause);
+
+		/** @brief The lua hook of every LuaState. Finds the LuaState running the script and
+			hands the event to what its LoadOptions asked for*/
+		static void dispatchHook(lua_State *L, lua_Debug *ar);
+
+		/** @brief helper function to LuaState::getGlobalTable
+			@details Reads the table at @p tableIndex, nested @p depth tables deep, into @p currTable. The fields are
+			counted before they are read so each set of the Table is allocated once. Fields that can't be represented are skipped.
+		*/
+		void getTableContents(Table &currTable, int tableIndex, int depth);
+
+		/** true iff a lua value of type @p luaType can be converted to a Key*/
+		static bool isKeyType(int luaType);
+
+		/** true iff a lua value of type @p luaType can be stored in a Value which is not a TABLE*/
+		static bool isLeafType(int luaType);
+
+		/** @brief Feeds the global table @p tableName to @p encoder without building a Table.
+			Helper function to JsonWriter and MessagePackWriter*/
+		void encodeGlobalTable(const std::string &tableName, Encoder &encoder);
+
+		/** @brief helper function to LuaState::encodeGlobalTable. Encodes the table on top of the stack
+			which is nested @p depth tables deep*/
+		void encodeTableContents(Encoder &encoder, int depth);
+
+		/** @brief helper function to LuaState::encodeTableContents. Encodes the value on top of the stack*/
+		void encodeValue(Encoder &encoder, int depth);
+
+		/** @brief helper function to LuaState::visitGlobalTable. Visits the table on top of the stack
+			which is nested @p depth tables deep*/
+		void visitTableContents(TableVisitor &visitor, int depth);
+
+		/** @brief fills @p key from the value on the given @p index on the lua stack
+			@return false if the value can not be used as a Key */
+		bool getKeyRef(int index, KeyRef &key);
 
 		/** @brief constructs a Key object from the value on the given @p index on the lua stack*/
 		Key getKey(int index);
@@ -59,6 +208,8 @@ namespace luapath
 	private:
 		lua_State *m_L;
 		bool loaded;
+		/** the load in progress if it uses the hook or null*/
+		RunningLoad *running;
 
 	};
 }
@@ -1,16 +1,22 @@
 #ifndef LUATYPES_HPP
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <map>
-#include <queue>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
-#include "luapath.hpp"
+#include "exceptions.hpp"
+#include "FlatMap.hpp"
 
 namespace luapath
 {
 	class Table;
+	class TableQuery;
+	class AccessProfile;
+	class DataLoader;
+	class PersistentTable;
 
 	static const char NUMBER_TOKEN = '#';
 	static const char STRING_TOKEN = '.';
@@ -35,6 +41,9 @@ namespace luapath
 		explicit Key(const std::string &key);
 		
 		Key(Key::Type type, const std::string &key);
+
+		/**Takes over the storage of @p key. Used when building a Table*/
+		Key(Key::Type type, std::string &&key);
 		
 		operator std::string() const;
 		operator int() const;
@@ -64,7 +73,13 @@ namespace luapath
 		/**A Value with Type TABLE will be recursively traversed*/
 		enum class Type{ BOOL, STRING, NUMBER, TABLE };
 
+		/**An empty STRING value. Used as the output parameter of the non-throwing lookups*/
+		Value();
+
 		Value(Value::Type type, const std::string &val);
+
+		/**Takes over the storage of @p val. Used when building a Table*/
+		Value(Value::Type type, std::string &&val);
 		
 		/**Needed because under vc12 compiler(at the very least) char* is promoted to bool 
 		   and not string when a ctor with bool overload is present
@@ -73,14 +88,22 @@ namespace luapath
 
 		Value(Value::Type type, bool val);
 
+		/**Stored as the shortest text that reads back as the same float*/
 		Value(Value::Type type, float val);
 
+		/**Stored as the shortest text that reads back as the same double, with '.' as the decimal point in any locale*/
+		Value(Value::Type type, double val);
+
 		operator std::string() const;
 
+		/**The number truncated towards zero*/
 		operator int() const;
 
 		operator float() const;
 
+		/**The full precision of a lua number*/
+		operator double() const;
+
 		operator bool() const;
 
 		/** true iff type and value are the same*/
@@ -89,7 +112,7 @@ namespace luapath
 		/** true iff type or value differ*/
 		bool operator!=(const Value &other) const;
 
-		/** If both values are of the Type NUMBER then compares as floats
+		/** If both values are of the Type NUMBER then compares as doubles
 			If both values are of Type BOOL then compares as bool
 			Otherwise performs lexicographical_compare as strings
 		*/
@@ -101,6 +124,41 @@ namespace luapath
 	};
 
 
+	/** @brief Why a search path could not be resolved*/
+	enum class LookupStatus
+	{
+		FOUND,
+		/** a value was looked up with an empty path*/
+		EMPTY_PATH,
+		/** the segment doesn't start with '.' or '#' or its number field is not an int*/
+		INVALID_PATH,
+		/** the table has no field with the key of the segment*/
+		NOT_FOUND,
+		/** the segment names a value but a table is needed, it isn't the last one or a table was looked up*/
+		NOT_A_TABLE,
+		/** the path ends at a table but a value was looked up*/
+		NOT_A_VALUE
+	};
+
+	/** the name of @p status e.g. "NOT_FOUND"*/
+	const char *toString(LookupStatus status);
+
+	/** @brief The outcome of a non-throwing lookup like Table::tryGetValue
+		@details If the lookup failed @p segment is the index of the segment of the path where it failed,
+		counting from 0, and [offset, offset + length) are its characters including the token.
+		For a successful lookup @p segment is the number of segments.
+	*/
+	struct  LookupResult
+	{
+		LookupStatus status;
+		std::uint32_t segment;
+		std::uint32_t offset;
+		std::uint32_t length;
+
+		/** true iff status is FOUND*/
+		bool found() const { return status == LookupStatus::FOUND; }
+	};
+
 	/** @brief Represents the lua table as a C++ object.
 		@todo escape token characters 
 	*/
@@ -108,14 +166,92 @@ namespace luapath
 	{
 	public:
 		/** a Value which doesn't have nested tables */
-		typedef std::map<Key, Value> LeafSet;
+		typedef FlatMap<Key, Value> LeafSet;
 		
 		/**a Table which may or may not have nested tables*/
-		typedef std::map<Key, Table> NestedSet;
-
-		/**queue of Key objects constructed from a string searchPath 
-			which is the input parameter to Table::getValue and Table::getTable*/
-		typedef std::queue<Key> KeyPath;
+		typedef FlatMap<Key, Table> NestedSet;
+
+		/** @brief A pair of iterators usable in a range based for loop*/
+		template<class Iterator>
+		class Range
+		{
+		public:
+			Range(Iterator first, Iterator last)
+				: first(first), last(last)
+			{
+			}
+			Iterator begin() const { return first; }
+			Iterator end() const { return last; }
+			bool empty() const { return first == last; }
+		private:
+			Iterator first, last;
+		};
+
+		typedef Range<LeafSet::const_iterator> LeafRange;
+		typedef Range<NestedSet::const_iterator> NestedRange;
+
+		/** @brief A reference to a single field of the table
+			@details Exactly one of @p value and @p table is not null */
+		struct Entry
+		{
+			const Key &key;
+			const Value *value;
+			const Table *table;
+
+			bool isTable() const { return table != nullptr; }
+		};
+
+		/** @brief Iterates the leaves and nested tables together in key order*/
+		class EntryIterator
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef Entry value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const Entry *pointer;
+			typedef Entry reference;
+
+			EntryIterator(LeafSet::const_iterator leafIt, LeafSet::const_iterator leafEnd,
+				NestedSet::const_iterator nestedIt, NestedSet::const_iterator nestedEnd);
+
+			Entry operator*() const;
+			EntryIterator& operator++();
+			EntryIterator operator++(int);
+			bool operator==(const EntryIterator &other) const;
+			bool operator!=(const EntryIterator &other) const;
+		private:
+			/** decides which of the two sets holds the next entry*/
+			void select();
+
+			LeafSet::const_iterator leafIt, leafEnd;
+			NestedSet::const_iterator nestedIt, nestedEnd;
+			bool atLeaf;
+		};
+
+		typedef Range<EntryIterator> EntryRange;
+
+		/** @brief Bytes held by a Table and everything below it. See Table::footprint
+			@details Only the memory requested from the allocator is counted, not the allocator's own overhead.
+		*/
+		struct Footprint
+		{
+			/** the slots of every LeafSet including reserved but unused ones*/
+			std::size_t leafNodeBytes;
+			/** the slots of every NestedSet, which hold the nested Table objects themselves*/
+			std::size_t nestedTableBytes;
+			/** heap storage of the keys of all fields and tables*/
+			std::size_t keyStringBytes;
+			/** heap storage of the values*/
+			std::size_t valueStringBytes;
+			std::size_t leaves;
+			std::size_t tables;
+
+			/** the sum of all the byte counts plus the root Table object*/
+			std::size_t totalBytes() const;
+		};
+
+		/**An empty table with an empty STRING key*/
+		Table();
 
 		/**@p tableKey the name of the table*/
 		explicit Table(const Key &tableKey);
@@ -126,25 +262,126 @@ namespace luapath
 			e.g if searchKey == "vehicles.cheap#5" then the Value object will be returned representing
 			the 5th value of the "cheap" table of the "vehicles" table 
 		*/
-		Value getValue(const std::string &searchPath);
+		Value getValue(const std::string &searchPath) const;
+
+		/** Same as Table::getValue but stores the result in @p value
+			@return false instead of throwing if the @p searchPath could not be resolved */
+		bool getValue(const std::string &searchPath, Value &value) const;
+
+		/** @brief The Value at @p searchPath without copying it or throwing
+			@details Neither a hit nor a miss allocates memory, unless luapath::startAccessRecording is on
+			and counts the visit. The pointer is valid as long as the table is.
+			@return null if @p searchPath could not be resolved, the reason is stored in @p result if given
+		*/
+		const Value *tryGetValue(const std::string &searchPath, LookupResult *result = nullptr) const;
+
+		/** @brief The value at @p searchPath converted to the type of @p fallback
+			@return @p fallback if the path can't be resolved or the value has another type. Never throws
+		*/
+		int getOr(const std::string &searchPath, int fallback) const;
+		float getOr(const std::string &searchPath, float fallback) const;
+		double getOr(const std::string &searchPath, double fallback) const;
+		bool getOr(const std::string &searchPath, bool fallback) const;
+		/** any value is returned as its text. The result refers into the table or is @p fallback itself,
+			so with a temporary fallback it must be used before the end of the statement*/
+		const std::string &getOr(const std::string &searchPath, const std::string &fallback) const;
+		/** any value is returned as its text, as a pointer into the table or @p fallback itself*/
+		const char *getOr(const std::string &searchPath, const char *fallback) const;
 
 		/** Get a Value object of the Key that is the last field of the @p searchPath */
-		Table getTable(const std::string &searchPath);
+		Table getTable(const std::string &searchPath) const;
+
+		/** Same as Table::getTable but stores the result in @p table
+			@return false instead of throwing if the @p searchPath could not be resolved */
+		bool getTable(const std::string &searchPath, Table &table) const;
+
+		/** @brief The nested Table at @p searchPath without copying it or throwing
+			@details Works like Table::tryGetValue. An empty path is this table
+		*/
+		const Table *tryGetTable(const std::string &searchPath, LookupResult *result = nullptr) const;
+
+		/** Lazily search the table for all values matching @p pattern
+			@details The pattern uses the same syntax as the search path of Table::getValue with the additions:
+			"#*" matches any number key, ".*" matches any string key and a field preceded by ".."
+			(e.g. "..modelDir" or "..#2") is matched at any depth below the current table.
+			No results are computed until the returned TableQuery is iterated.
+			The query and its iterators point into this table, so it must outlive both of them.
+			@throws path_lookup_exception if @p pattern is malformed
+		*/
+		TableQuery query(const std::string &pattern) const &;
+
+		/** A temporary table would be destroyed before its query is iterated,
+			e.g. in for (auto m : state.getGlobalTable("x").query(...))*/
+		TableQuery query(const std::string &pattern) const && = delete;
+
+		/** The key this table is stored under in its parent*/
+		const Key &getKey() const;
+
+		/** All the non table values of this table in key order*/
+		LeafRange leaves() const;
+
+		/** All the nested tables of this table in key order*/
+		NestedRange tables() const;
+
+		/** All the fields of this table in key order. Number keys come before string keys*/
+		EntryRange entries() const;
+
+		/** Same as Table::entries so that a table can be used in a range based for loop*/
+		EntryIterator begin() const;
+		EntryIterator end() const;
+
+		/** The number of values and nested tables directly in this table*/
+		std::size_t size() const;
+
+		/** true iff the table has neither values nor nested tables*/
+		bool empty() const;
+
+		/** true iff @p key is a field of this table. Does not look into nested tables*/
+		bool contains(const Key &key) const;
+
+		/** true iff @p searchPath leads to a value or a table. Never throws and only allocates
+			while luapath::startAccessRecording counts the visits*/
+		bool contains(const std::string &searchPath) const;
+
+		/** The memory used by this table and all its nested tables, broken down by kind*/
+		Footprint footprint() const;
+
+		/** @brief A copy of this table laid out in memory for the lookups counted in @p profile
+			@details The tables are copied most visited first so that the storage of the hot part of the
+			tree is allocated together instead of being spread over the whole snapshot.
+			The keys stay in sorted order so lookups work and iterate exactly as on the original.
+			@p profile has to be captured from a table with the same paths e.g. an earlier snapshot of the same config.
+		*/
+		Table relayout(const AccessProfile &profile) const;
 
 		/** Get a an array of type T of the leafSet of the current table*/
 		template<class T>
-		std::vector<T> toArray();
+		std::vector<T> toArray() const;
 
 		friend class LuaState;
+		friend class TableQuery;
+		friend class DataLoader;
+		friend class JsonReader;
+		friend class PersistentTable;
 	private:
-		/**Converts a string @p searchPath to a queue of Key which is used to search the Table*/
-		KeyPath tokenizePath(const std::string &searchPath) const;
+		/** @brief Walks @p searchPath without allocating
+			@details Looks for a value if @p value is not null and stores it there, otherwise for a table
+			which is stored in @p table. Every lookup goes through here.
+		*/
+		LookupResult resolve(const std::string &searchPath, const Value **value, const Table **table) const;
+
+		/** The path_lookup_exception for the failed lookup @p result of @p searchPath*/
+		static path_lookup_exception lookupError(const LookupResult &result, const std::string &searchPath, bool value);
 
-		bool isToken(std::string::const_iterator &it) const;
+		/**true iff @p field can be the value of a Key with Type NUMBER*/
+		static bool isNumberField(const std::string &field);
 
 		friend std::ostream& operator<< (std::ostream& out, const Table &table);
 
 		void print(std::ostream &out, const Table& table, int level) const;
+
+		/** helper function to Table::footprint*/
+		void addFootprint(Footprint &footprint) const;
 	private:
 		Key tableKey;
 		LeafSet leafSet;
@@ -154,7 +391,7 @@ namespace luapath
 }
 
 template<class T>
-std::vector<T> luapath::Table::toArray()
+std::vector<T> luapath::Table::toArray() const
 {
 	std::vector<T> result;
 	for (LeafSet::const_iterator leafIt = leafSet.begin();
@@ -166,5 +403,8 @@ std::vector<T> luapath::Table::toArray()
 	}
 	return result;
 }
+
+// depends on the complete definition of Table
+#include "TableQuery.hpp"
 #endif // !LUATYPES_HPP
 
@@ -0,0 +1,32 @@
+#ifndef LUAWRITER_HPP
+#pragma once
+
+#include <string>
+
+#include "LuaTypes.hpp"
+#include "OutputSink.hpp"
+
+namespace luapath
+{
+	/** @brief Writes a Table as lua source that recreates it when loaded
+		@details A table with a key becomes the global assignment "key = { ... }", the table with an empty
+		key returned by LuaState::getGlobals and DataLoader becomes one assignment per global. Keys that
+		are not names are written as ["key"] and globals that are not names are assigned through _ENV.
+		Number keys that continue the sequence 1, 2, 3, ... are left out. The output of WriteStyle::COMPACT
+		and WriteStyle::PRETTY loads into the same tables, the numbers into the same doubles.
+		Unlike operator<<(std::ostream&, const Table&) the text is formatted by hand into a buffer of the
+		writer, so a large Table is written at close to the speed of copying its strings.
+	*/
+	class  LuaWriter
+	{
+	public:
+		/** @brief Writes @p table to @p sink
+			@details Everything is handed to @p sink before this returns.
+		*/
+		static void write(const Table &table, OutputSink &sink, WriteStyle style = WriteStyle::PRETTY);
+
+		/** @brief The lua source of @p table as a string*/
+		static std::string toString(const Table &table, WriteStyle style = WriteStyle::PRETTY);
+	};
+}
+#endif // !LUAWRITER_HPP
@@ -0,0 +1,33 @@
+#ifndef MESSAGEPACKWRITER_HPP
+#pragma once
+
+#include <string>
+
+#include "LuaState.hpp"
+#include "LuaTypes.hpp"
+#include "OutputSink.hpp"
+
+namespace luapath
+{
+	/** @brief Writes tables as MessagePack
+		@details Tables become arrays or maps like in JsonWriter but number keys stay integers.
+		Numbers that are integers in the range of int64 are written as the smallest MessagePack int
+		that holds them, all others as float 64. Strings are written as str whatever bytes they hold.
+		The output is formatted into a buffer of the writer and handed to the OutputSink in chunks.
+	*/
+	class  MessagePackWriter
+	{
+	public:
+		/** @brief Writes @p table to @p sink*/
+		static void write(const Table &table, OutputSink &sink);
+
+		/** @brief Writes the global table @p tableName of @p state to @p sink straight from the lua state
+			@details Same as JsonWriter::write(LuaState&, const std::string&, OutputSink&, WriteStyle)
+		*/
+		static void write(LuaState &state, const std::string &tableName, OutputSink &sink);
+
+		/** @brief The MessagePack encoding of @p table as a string of bytes*/
+		static std::string toString(const Table &table);
+	};
+}
+#endif // !MESSAGEPACKWRITER_HPP
@@ -0,0 +1,92 @@
+#ifndef OUTPUTSINK_HPP
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace luapath
+{
+	/** @brief Layout of the text written by the serializers*/
+	enum class WriteStyle
+	{
+		/** no whitespace that isn't needed*/
+		COMPACT,
+		/** one field per line, indented with tabs*/
+		PRETTY
+	};
+
+	/** @brief Where the serializers write to
+		@details The serializers format into a buffer of their own and hand it over in chunks
+		of up to 32KiB, so a sink sees few large writes.
+	*/
+	class  OutputSink
+	{
+	public:
+		virtual ~OutputSink() {}
+
+		/** Called with the next @p length bytes of the output*/
+		virtual void write(const char *data, std::size_t length) = 0;
+	};
+
+	/** @brief Appends the output to a std::string*/
+	class  StringSink
+		: public OutputSink
+	{
+	public:
+		explicit StringSink(std::string &out)
+			: out(out)
+		{
+		}
+
+		virtual void write(const char *data, std::size_t length)
+		{
+			out.append(data, length);
+		}
+
+	private:
+		std::string &out;
+	};
+
+	/** @brief Writes the output to a std::ostream with unformatted writes*/
+	class  StreamSink
+		: public OutputSink
+	{
+	public:
+		explicit StreamSink(std::ostream &out)
+			: out(out)
+		{
+		}
+
+		virtual void write(const char *data, std::size_t length)
+		{
+			out.write(data, (std::streamsize)length);
+		}
+
+	private:
+		std::ostream &out;
+	};
+
+	/** @brief Passes every chunk of the output to a callback, e.g. to send it as it is produced*/
+	class  CallbackSink
+		: public OutputSink
+	{
+	public:
+		typedef std::function<void(const char *data, std::size_t length)> Callback;
+
+		explicit CallbackSink(Callback callback)
+			: callback(std::move(callback))
+		{
+		}
+
+		virtual void write(const char *data, std::size_t length)
+		{
+			callback(data, length);
+		}
+
+	private:
+		Callback callback;
+	};
+}
+#endif // !OUTPUTSINK_HPP
@@ -0,0 +1,109 @@
+#ifndef PERSISTENTTABLE_HPP
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LuaTypes.hpp"
+
+namespace luapath
+{
+	/** @brief An immutable table whose edits return new versions sharing everything they didn't touch
+		@details The fields are kept in a hash array mapped trie: every node holds up to 32 fields or child
+		nodes selected by 5 bits of the hash of the key. PersistentTable::with and PersistentTable::without
+		copy the nodes on the way to the edited field and the nested tables on the way down the path and
+		share all the others with the original, so a version costs memory in proportion to its edits and
+		copying a PersistentTable is O(1). Versions can be used from several threads at once.
+		Paths have the syntax of Table::getValue. Unlike a Table the fields are not kept in key order,
+		PersistentTable::toTable gives the ordered view.
+	*/
+	class  PersistentTable
+	{
+	public:
+		/** @brief Called by PersistentTable::forEach for every field
+			@details Exactly one of @p value and @p table is not null*/
+		typedef std::function<void(const Key &key, const Value *value, const PersistentTable *table)> FieldCallback;
+
+		/** An empty table*/
+		PersistentTable();
+
+		/** A copy of @p table and all its nested tables*/
+		explicit PersistentTable(const Table &table);
+
+		/** @brief A version with the field at @p searchPath set to @p value
+			@details Missing tables on the way are created. A value or table already at the last
+			segment is replaced.
+			@throws path_lookup_exception if @p searchPath is malformed or a segment before the last names a value
+		*/
+		PersistentTable with(const std::string &searchPath, const Value &value) const;
+
+		/** @brief A version with the field at @p searchPath set to the table @p table, which is shared not copied*/
+		PersistentTable with(const std::string &searchPath, const PersistentTable &table) const;
+
+		/** @brief A version without the field at @p searchPath
+			@return a copy of this table if there is no such field
+			@throws path_lookup_exception if @p searchPath is malformed
+		*/
+		PersistentTable without(const std::string &searchPath) const;
+
+		/** @brief Same as Table::getValue
+			@throws path_lookup_exception if @p searchPath can't be resolved to a value */
+		Value getValue(const std::string &searchPath) const;
+
+		/** @brief Same as Table::getTable. The result shares the nodes of this table
+			@throws path_lookup_exception if @p searchPath can't be resolved to a table */
+		PersistentTable getTable(const std::string &searchPath) const;
+
+		/** @brief Same as Table::tryGetValue. Does not allocate*/
+		const Value *tryGetValue(const std::string &searchPath, LookupResult *result = nullptr) const;
+
+		/** @brief Same as Table::tryGetTable. Does not allocate*/
+		const PersistentTable *tryGetTable(const std::string &searchPath, LookupResult *result = nullptr) const;
+
+		/** true iff @p searchPath leads to a value or a table*/
+		bool contains(const std::string &searchPath) const;
+
+		/** The number of values and nested tables directly in this table*/
+		std::size_t size() const;
+
+		bool empty() const;
+
+		/** Calls @p callback for every field of this table in no particular order*/
+		void forEach(const FieldCallback &callback) const;
+
+		/** A Table with the contents of this one and the key @p tableKey*/
+		Table toTable(const Key &tableKey = Key(std::string())) const;
+
+		/** @brief true iff both tables are the same version, i.e. one is a copy of the other
+			@details O(1). Tables with the same contents built separately are not the same version*/
+		bool sameVersion(const PersistentTable &other) const;
+
+		/** a node of the trie. Internal to the library*/
+		struct Node;
+		/** a key with its value or nested table. Internal to the library*/
+		struct Field;
+	private:
+		PersistentTable(std::shared_ptr<const Node> root, std::size_t count);
+
+		/** the field of this table with the key [data, data + length) of Type @p type or null*/
+		const Field *findField(Key::Type type, const char *data, std::size_t length, int number) const;
+
+		/** Walks @p searchPath like Table::resolve does*/
+		LookupResult resolve(const std::string &searchPath, const Value **value, const PersistentTable **table) const;
+
+		/** this table with @p field set*/
+		PersistentTable assoc(const std::shared_ptr<const Field> &field) const;
+
+		/** sets the field at @p path from @p index on to @p value or if it is null to @p table*/
+		PersistentTable withPath(const std::vector<Key> &path, std::size_t index, const Value *value, const PersistentTable *table) const;
+
+		PersistentTable withoutPath(const std::vector<Key> &path, std::size_t index) const;
+
+		std::shared_ptr<const Node> root;
+		std::size_t count;
+	};
+}
+#endif // !PERSISTENTTABLE_HPP
@@ -0,0 +1,51 @@
+#ifndef SCRIPTPROFILER_HPP
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+struct lua_State;
+
+namespace luapath
+{
+	/** @brief Samples the lua call stack while a script is run by LuaState::loadString or LuaState::loadFile
+		@details Pass it in LoadOptions::profiler. A count hook interrupts the script every
+		@p instructionInterval virtual machine instructions and records the current call stack.
+		Time spent inside a single C function (e.g. string.rep) is not sampled until it returns
+		as the count hook only fires between lua instructions.
+		The samples of several loads add up until ScriptProfiler::clear is called.
+	*/
+	class  ScriptProfiler
+	{
+	public:
+		explicit ScriptProfiler(int instructionInterval = 1000);
+
+		/** @brief Writes the samples in the folded stack format of flamegraph.pl and speedscope
+			@details One line per distinct stack: the frames from the outermost to the innermost
+			separated by ';' followed by a space and the number of samples. A frame of a lua function
+			is "name (source:line)" where line is the line being executed in that frame.
+		*/
+		void writeFolded(std::ostream &out) const;
+
+		/** The number of samples taken so far*/
+		std::uint64_t sampleCount() const;
+
+		int instructionInterval() const;
+
+		/** Drops all the samples*/
+		void clear();
+
+		friend class LuaState;
+	private:
+		/** records the stack of @p L. Called from the count hook*/
+		void sample(lua_State *L);
+
+		int interval;
+		std::uint64_t samples;
+		/** folded stack to number of samples*/
+		std::map<std::string, std::uint64_t> stacks;
+	};
+}
+#endif // !SCRIPTPROFILER_HPP
@@ -0,0 +1,103 @@
+#ifndef SHAPEANALYZER_HPP
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LuaTypes.hpp"
+#include "TableVisitor.hpp"
+
+namespace luapath
+{
+	/** @brief Size and shape of a table together with everything nested in it*/
+	struct  SubtreeShape
+	{
+		/** path of the table starting with the name of the analyzed table e.g. "config.servers#3"*/
+		std::string path;
+		/** levels of tables, 1 for a table without nested tables*/
+		std::size_t depth;
+		/** nested tables, not counting this one*/
+		std::size_t tables;
+		std::size_t leaves;
+		/** keys of the leaves and nested tables by type. Number keys are the array part of a lua table*/
+		std::size_t numberKeys;
+		std::size_t stringKeys;
+		/** length of all the string keys and string values*/
+		std::size_t stringBytes;
+		/** what a snapshot of the subtree takes: the slots of the sets plus the heap storage of the strings*/
+		std::size_t estimatedBytes;
+	};
+
+	/** @brief The result of a ShapeAnalyzer*/
+	struct  ShapeReport
+	{
+		/** the analyzed table*/
+		SubtreeShape root;
+		/** the nested tables with the highest ShapeAnalyzer::estimatedBytes, largest first*/
+		std::vector<SubtreeShape> largest;
+		/** string keys and string values seen*/
+		std::size_t strings;
+		/** strings that were seen more than once with the same content*/
+		std::size_t duplicatedStrings;
+		/** the bytes of the repeated occurrences of the duplicated strings*/
+		std::size_t duplicatedStringBytes;
+
+		/** the share of the strings that are repeats of an earlier one*/
+		double duplicateRatio() const;
+
+		/** A summary line followed by a table of the largest subtrees*/
+		void write(std::ostream &out) const;
+
+		std::string toJson() const;
+	};
+
+	/** @brief Reports where the entries and bytes of a table are
+		@details Either analyze a snapshot with ShapeAnalyzer::analyze or a live lua table without copying it:
+		@code
+		ShapeAnalyzer analyzer;
+		state.visitGlobalTable("config", analyzer);
+		analyzer.report().write(std::cout);
+		@endcode
+		Use one analyzer per table.
+	*/
+	class  ShapeAnalyzer
+		: public TableVisitor
+	{
+	public:
+		/** @p largestCount the number of subtrees kept in ShapeReport::largest*/
+		explicit ShapeAnalyzer(std::size_t largestCount = 20);
+
+		/** Walks a snapshot*/
+		void analyze(const Table &table);
+
+		ShapeReport report() const;
+
+		virtual void onEnterTable(const KeyRef &key);
+		virtual void onLeaf(const KeyRef &key, const ValueRef &value);
+		virtual void onExitTable();
+
+	private:
+		/** counts @p key as a field of the current table and returns the bytes it adds to a snapshot*/
+		std::size_t addKey(Key::Type type, const char *data, std::size_t length);
+
+		/** counts a STRING value or key for the duplicate statistics*/
+		void addString(const char *data, std::size_t length);
+
+		/** the heap storage std::string needs for @p length characters*/
+		static std::size_t stringHeapBytes(std::size_t length);
+
+		/** continues ShapeAnalyzer::analyze below @p table*/
+		void analyzeContents(const Table &table);
+
+		std::size_t largestCount;
+		/** the tables from the root to the current one*/
+		std::vector<SubtreeShape> stack;
+		ShapeReport result;
+		/** hash of every string seen to the number of times it was seen*/
+		std::unordered_map<std::uint64_t, std::size_t> seenStrings;
+	};
+}
+#endif // !SHAPEANALYZER_HPP
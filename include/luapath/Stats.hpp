@@ -0,0 +1,66 @@
+#ifndef STATS_HPP
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace luapath
+{
+	/** @brief A copy of the library counters taken by luapath::stats
+		@details The counters are only updated while stats are enabled with luapath::enableStats.
+		Every thread counts into its own counters which are added up when luapath::stats is called,
+		so counting never contends between threads.
+	*/
+	struct  Stats
+	{
+		/** calls to LuaState::loadString and LuaState::loadFile*/
+		std::uint64_t loads;
+		/** loads that threw lua_state_exception*/
+		std::uint64_t loadFailures;
+		/** time spent compiling the chunks*/
+		std::uint64_t parseNs;
+		/** time spent running the compiled chunks*/
+		std::uint64_t executeNs;
+		/** loads that ran with LoadOptions::gcPolicy or LoadOptions::gcPause changing the collector*/
+		std::uint64_t gcTunedLoads;
+		/** lua heap in bytes right after the successful loads, i.e. what the collector left behind*/
+		std::uint64_t loadHeapBytes;
+		/** string table slots allocated up front for LoadOptions::expectedSourceBytes*/
+		std::uint64_t stringTableSlots;
+		/** calls to LuaState::getGlobalTable that returned a Table*/
+		std::uint64_t snapshots;
+		/** values and nested tables copied by the snapshots*/
+		std::uint64_t snapshotNodes;
+		std::uint64_t snapshotNs;
+		/** Table::Footprint::totalBytes of the snapshots*/
+		std::uint64_t snapshotBytes;
+		/** calls to Table::getValue, Table::getTable and LuaState::getGlobalValue*/
+		std::uint64_t lookups;
+		/** lookups that did not resolve i.e. threw or would have thrown path_lookup_exception*/
+		std::uint64_t lookupMisses;
+		/** values that could not be converted to the requested type i.e. type_mismatch_exception*/
+		std::uint64_t conversionFailures;
+
+		/** One "name value" line per counter*/
+		std::string toText() const;
+
+		/** A single JSON object with one member per counter*/
+		std::string toJson() const;
+
+		friend std::ostream& operator<< (std::ostream& out, const Stats &stats);
+	};
+
+	/** @brief Turns counting on or off for all threads. Stats are off by default*/
+	void enableStats(bool enabled);
+
+	/** true iff the counters are being updated*/
+	bool statsEnabled();
+
+	/** @brief The sum of the counters of all threads, including threads that have exited*/
+	Stats stats();
+
+	/** @brief Sets all the counters to zero*/
+	void resetStats();
+}
+#endif // !STATS_HPP
@@ -0,0 +1,76 @@
+#ifndef TABLEEDIT_HPP
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "LuaTypes.hpp"
+
+namespace luapath
+{
+	class  LuaState;
+
+	/** @brief Changes to a global table of a LuaState collected to be written back in one pass
+		@details Made by LuaState::editGlobalTable. TableEdit::set and TableEdit::erase only record a change,
+		TableEdit::apply writes all recorded changes into the lua state in the order they were made.
+		The lua tables are written with raw accesses so no metamethods run, and an edit whose path shares
+		a prefix with the previous one reuses the tables already on the lua stack, so sorting a large batch
+		by path makes it cheaper. Fields that are not edited are left as they are.
+		Paths have the syntax of Table::getValue and are relative to the edited table.
+		The LuaState must outlive the TableEdit.
+	*/
+	class  TableEdit
+	{
+	public:
+		/** @brief Records setting the field at @p searchPath to @p value
+			@details Tables missing on the way are created when the edit is applied.
+			@throws path_lookup_exception if @p searchPath is malformed
+			@throws type_mismatch_exception if @p value is a TABLE
+		*/
+		TableEdit& set(const std::string &searchPath, const Value &value);
+
+		/** @brief Records removing the field at @p searchPath. Removing a missing field does nothing
+			@throws path_lookup_exception if @p searchPath is malformed
+		*/
+		TableEdit& erase(const std::string &searchPath);
+
+		/** @brief Writes the recorded changes into the lua state and clears them
+			@details Creates the edited global table if it doesn't exist and a change sets something.
+			@throws path_lookup_exception if a field on the way of a set is not a table. The changes
+			before it are in the lua state, it and the ones after it are kept
+			@throws type_mismatch_exception if the global is not a table, nothing is changed
+			@throws lua_state_exception if the state is not loaded
+		*/
+		void apply();
+
+		/** The number of recorded changes*/
+		std::size_t size() const;
+
+		bool empty() const;
+
+		/** Forgets the recorded changes*/
+		void clear();
+
+		/** The name of the edited global table*/
+		const std::string &getTableName() const;
+
+	private:
+		friend class LuaState;
+
+		TableEdit(LuaState &state, const std::string &tableName);
+
+		/** one recorded change, an erase if @p erase is true*/
+		struct Change
+		{
+			std::vector<Key> path;
+			bool erase;
+			Value value;
+		};
+
+		LuaState *state;
+		std::string tableName;
+		std::vector<Change> changes;
+	};
+}
+#endif // !TABLEEDIT_HPP
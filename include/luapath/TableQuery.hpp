@@ -0,0 +1,116 @@
+#ifndef TABLEQUERY_HPP
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LuaTypes.hpp"
+
+namespace luapath
+{
+	/** @brief A lazily evaluated wildcard search over a Table
+		@details Created by Table::query. Iterating the query walks the Table in key order and
+		yields every leaf Value whose path matches the pattern together with its full path
+		relative to the searched table e.g. ".buildings#1.city".
+		Nothing is copied: the yielded Value is a reference into the searched Table, which has to
+		outlive the query and its iterators. The iterators share the parsed pattern and stay valid
+		after the TableQuery that created them is destroyed.
+	*/
+	class TableQuery
+	{
+		struct Segment;
+		typedef std::vector<Segment> Segments;
+	public:
+		/** @brief A single result of the query.
+			@details Both references are only valid until the iterator that produced them is advanced
+		*/
+		struct Match
+		{
+			const std::string &path;
+			const Value &value;
+		};
+
+		/** @brief Input iterator producing the matches of the query one at a time */
+		class iterator
+		{
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef Match value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const Match *pointer;
+			typedef Match reference;
+
+			/** The past-the-end iterator*/
+			iterator();
+
+			Match operator*() const;
+
+			iterator& operator++();
+
+			/** true iff both iterators are exhausted or both point to the same value*/
+			bool operator==(const iterator &other) const;
+			bool operator!=(const iterator &other) const;
+
+		private:
+			/** @brief A table which is being matched against a single segment of the pattern */
+			struct Frame
+			{
+				const Table *table;
+				/** index of the segment the keys of this table are matched against*/
+				std::size_t segment;
+				/** length of the path leading to this table*/
+				std::size_t pathLength;
+				Table::LeafSet::const_iterator leafIt, leafEnd;
+				Table::NestedSet::const_iterator nestedIt, nestedEnd;
+				/** the nested table at nestedIt was already matched against the segment*/
+				bool nestedMatched;
+			};
+
+			iterator(const Table &table, const std::shared_ptr<const Segments> &segments);
+
+			/** pushes a frame for @p table matching the segment with index @p segment */
+			void push(const Table &table, std::size_t segment);
+
+			/** moves to the next matching value or exhausts the iterator*/
+			void advance();
+
+			std::shared_ptr<const Segments> segments;
+			std::vector<Frame> stack;
+			std::string path;
+			const Value *current;
+
+			friend class TableQuery;
+		};
+
+		iterator begin() const;
+		iterator end() const;
+
+	private:
+		/** @brief A single field of the pattern*/
+		struct Segment
+		{
+			/** the key to match if the segment is not a wildcard*/
+			Key key;
+			/** matches any key of type key.type*/
+			bool wildcard;
+			/** the segment was preceded by ".." and is matched at any depth*/
+			bool recursive;
+
+			/** true iff @p other satisfies this segment*/
+			bool matches(const Key &other) const;
+		};
+
+		TableQuery(const Table &table, const std::string &pattern);
+
+		/** Converts @p pattern to a list of Segment. Throws path_lookup_exception if it is malformed*/
+		static std::shared_ptr<const Segments> compile(const std::string &pattern);
+
+		const Table *table;
+		std::shared_ptr<const Segments> segments;
+
+		friend class Table;
+	};
+}
+#endif // !TABLEQUERY_HPP
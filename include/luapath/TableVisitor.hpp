@@ -0,0 +1,55 @@
+#ifndef TABLEVISITOR_HPP
+#pragma once
+
+#include <cstddef>
+
+#include "LuaTypes.hpp"
+
+namespace luapath
+{
+	/** @brief A non owning view of a key on the lua stack
+		@details For Type STRING @p data and @p length point into memory owned by the lua state.
+		For Type NUMBER the key is stored in @p index and @p data is null.
+	*/
+	struct  KeyRef
+	{
+		Key::Type type;
+		const char *data;
+		std::size_t length;
+		int index;
+	};
+
+	/** @brief A non owning view of a value on the lua stack
+		@details For Type STRING @p data and @p length point into memory owned by the lua state,
+		for Type NUMBER the value is held in @p number and for Type BOOL in @p boolean.
+	*/
+	struct  ValueRef
+	{
+		Value::Type type;
+		const char *data;
+		std::size_t length;
+		double number;
+		bool boolean;
+	};
+
+	/** @brief Callbacks for LuaState::visitGlobalTable
+		@details The visitor is driven directly from lua_next so no Key, Value or Table is constructed.
+		The KeyRef and ValueRef passed to the callbacks are only valid for the duration of the call.
+		Every call to onEnterTable is matched by a call to onExitTable.
+	*/
+	class  TableVisitor
+	{
+	public:
+		virtual ~TableVisitor() {}
+
+		/** Called before the contents of the table with @p key are visited*/
+		virtual void onEnterTable(const KeyRef &key) { (void)key; }
+
+		/** Called for every string, number or boolean field of the current table*/
+		virtual void onLeaf(const KeyRef &key, const ValueRef &value) { (void)key; (void)value; }
+
+		/** Called after all the contents of the current table were visited*/
+		virtual void onExitTable() {}
+	};
+}
+#endif // !TABLEVISITOR_HPP
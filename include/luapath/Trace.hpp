@@ -0,0 +1,69 @@
+#ifndef TRACE_HPP
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace luapath
+{
+	/** @brief Starts recording the trace zones of all threads
+		@details Zones are only compiled in when LUAPATH_ENABLE_TRACING is defined
+		(cmake -DLUAPATH_ENABLE_TRACING=ON). Without it nothing is ever recorded.
+	*/
+	void startTracing();
+
+	/** @brief Stops recording. The recorded events are kept until luapath::clearTrace*/
+	void stopTracing();
+
+	/** true iff zones are being recorded*/
+	bool tracing();
+
+	/** @brief Drops all recorded events*/
+	void clearTrace();
+
+	/** @brief Writes the recorded events of all threads as Chrome trace_event JSON
+		@details The output can be opened in Perfetto or about:tracing.
+		Every zone is a complete ("X") event. Zones of the same thread nest by time.
+	*/
+	void writeChromeTrace(std::ostream &out);
+
+	/** @brief Records the time between its construction and destruction. Use the LUAPATH_TRACE_ZONE macros
+		@details Nothing is recorded, and the clock is not read, unless tracing was started.
+	*/
+	class  TraceZone
+	{
+	public:
+		/** @p name has to be a string literal*/
+		explicit TraceZone(const char *name);
+
+		/** @p detail is shown as an argument of the event e.g. the file or the path of a lookup*/
+		TraceZone(const char *name, const std::string &detail);
+
+		~TraceZone();
+
+	private:
+		TraceZone(const TraceZone &);
+		TraceZone& operator=(const TraceZone &);
+
+		const char *name;
+		std::string detail;
+		std::uint64_t startNs;
+		bool recording;
+	};
+}
+
+#define LUAPATH_TRACE_CONCAT_(a, b) a##b
+#define LUAPATH_TRACE_CONCAT(a, b) LUAPATH_TRACE_CONCAT_(a, b)
+
+#ifdef LUAPATH_ENABLE_TRACING
+/** Traces the rest of the enclosing scope as @p name*/
+#define LUAPATH_TRACE_ZONE(name) ::luapath::TraceZone LUAPATH_TRACE_CONCAT(luapathTraceZone, __LINE__)(name)
+/** Traces the rest of the enclosing scope as @p name with the string @p detail attached*/
+#define LUAPATH_TRACE_ZONE_DETAIL(name, detail) ::luapath::TraceZone LUAPATH_TRACE_CONCAT(luapathTraceZone, __LINE__)(name, detail)
+#else
+#define LUAPATH_TRACE_ZONE(name) ((void)0)
+#define LUAPATH_TRACE_ZONE_DETAIL(name, detail) ((void)0)
+#endif
+
+#endif // !TRACE_HPP
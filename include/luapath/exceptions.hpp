@@ -1,7 +1,9 @@
 #ifndef EXCEPTIONS_HPP
 #pragma once
 
+#include <cstddef>
 #include <stdexcept>
+#include <string>
 
 namespace luapath{
 
@@ -79,5 +81,53 @@ protected:
 
 };
 
+/** @brief Thrown by LuaState::loadString and LuaState::loadFile when the script ran out of
+	the instruction or time budget of its LoadOptions. The state is closed like for any failed load*/
+struct  budget_exceeded_exception
+	: public lua_state_exception
+{
+public:
+	explicit budget_exceeded_exception(const char *message)
+		: lua_state_exception(message)
+	{
+	}
+	explicit budget_exceeded_exception(const std::string &message)
+		: lua_state_exception(message)
+	{
+	}
+	virtual ~budget_exceeded_exception() throw()
+	{
+	}
+};
+
+/** @brief Thrown by JsonReader for text that is not valid JSON or can't become a Table*/
+struct  json_parse_exception
+	: public std::exception
+{
+public:
+	json_parse_exception(const std::string &message, std::size_t offset)
+		: m_Msg(message), m_Offset(offset)
+	{
+	}
+	virtual ~json_parse_exception() throw()
+	{
+	}
+
+	virtual const char* what() const throw()
+	{
+		return m_Msg.c_str();
+	}
+
+	/** the offset in bytes of the error from the start of the text*/
+	std::size_t offset() const
+	{
+		return m_Offset;
+	}
+protected:
+	std::string m_Msg;
+	std::size_t m_Offset;
+
+};
+
 }
 #endif // !EXCEPTIONS_HPP
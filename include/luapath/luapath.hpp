@@ -1,8 +1,23 @@
 #ifndef LUAPATH_HPP
 #pragma once
 
+#include "AccessProfile.hpp"
+#include "DataLoader.hpp"
+#include "JsonReader.hpp"
+#include "JsonWriter.hpp"
+#include "LatencyHistogram.hpp"
 #include "LuaState.hpp"
 #include "LuaTypes.hpp"
+#include "LuaWriter.hpp"
+#include "MessagePackWriter.hpp"
+#include "OutputSink.hpp"
+#include "PersistentTable.hpp"
+#include "ScriptProfiler.hpp"
+#include "ShapeAnalyzer.hpp"
+#include "Stats.hpp"
+#include "TableEdit.hpp"
+#include "TableVisitor.hpp"
+#include "Trace.hpp"
 #include "exceptions.hpp"
 
 #endif
\ No newline at end of file
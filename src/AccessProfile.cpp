@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "luapath/AccessProfile.hpp"
+#include "luapath/LuaTypes.hpp"
+#include "AccessRecorder.hpp"
+#include "ThreadRegistry.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::uint64_t;
+
+	std::atomic<bool> accessSwitch(false);
+
+	namespace
+	{
+		const char PROFILE_HEADER[] = "# luapath access profile";
+
+		typedef std::unordered_map<const void*, uint64_t> NodeCounts;
+
+		void mergeInto(NodeCounts &into, const NodeCounts &from)
+		{
+			for (NodeCounts::const_iterator it = from.begin(); it != from.end(); ++it)
+				into[it->first] += it->second;
+		}
+
+		/** @brief The counts of one thread
+			@details The mutex is only contended while the counts are captured or cleared*/
+		struct ThreadAccesses
+		{
+			std::mutex mutex;
+			NodeCounts nodes;
+		};
+
+		void retireAccesses(NodeCounts &retired, const ThreadAccesses &thread)
+		{
+			mergeInto(retired, thread.nodes);
+		}
+
+		/** @brief The counts of the running threads plus those of the threads that exited*/
+		typedef ThreadRegistry<ThreadAccesses, NodeCounts, retireAccesses> Registry;
+
+		Registry &registry()
+		{
+			return Registry::instance();
+		}
+
+		thread_local Registry::Slot threadAccesses;
+
+		void appendKey(string &path, const Key &key)
+		{
+			path += key.type == Key::Type::NUMBER ? NUMBER_TOKEN : STRING_TOKEN;
+			path += key.key;
+		}
+	}
+
+	void recordAccess(const void *node)
+	{
+		ThreadAccesses &accesses = threadAccesses.local;
+		std::lock_guard<std::mutex> lock(accesses.mutex);
+		++accesses.nodes[node];
+	}
+
+	void startAccessRecording()
+	{
+		accessSwitch.store(true, std::memory_order_relaxed);
+	}
+
+	void stopAccessRecording()
+	{
+		accessSwitch.store(false, std::memory_order_relaxed);
+	}
+
+	bool accessRecording()
+	{
+		return accessSwitch.load(std::memory_order_relaxed);
+	}
+
+	void clearAccessRecording()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.retired.clear();
+		for (ThreadAccesses *thread : reg.threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mutex);
+			thread->nodes.clear();
+		}
+	}
+
+	AccessProfile AccessProfile::capture(const Table &root)
+	{
+		NodeCounts nodes;
+		{
+			Registry &reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			nodes = reg.retired;
+			for (ThreadAccesses *thread : reg.threads)
+			{
+				std::lock_guard<std::mutex> threadLock(thread->mutex);
+				mergeInto(nodes, thread->nodes);
+			}
+		}
+
+		// the nodes are counted by address. Walking the table turns the addresses into paths
+		AccessProfile profile;
+		string path;
+		NodeCounts::const_iterator rootCount = nodes.find(&root);
+		if (rootCount != nodes.end())
+			profile.counts[path] = rootCount->second;
+		profile.resolve(nodes, root, path);
+		return profile;
+	}
+
+	void AccessProfile::resolve(const NodeCounts &nodes, const Table &table, string &path)
+	{
+		std::size_t length = path.size();
+		for (const Table::Entry &entry : table)
+		{
+			const void *node = entry.isTable() ? (const void*)entry.table : (const void*)entry.value;
+			NodeCounts::const_iterator found = nodes.find(node);
+			// a table that was never visited has no visited nodes below it
+			if (found == nodes.end())
+				continue;
+			appendKey(path, entry.key);
+			counts[path] += found->second;
+			if (entry.isTable())
+				resolve(nodes, *entry.table, path);
+			path.resize(length);
+		}
+	}
+
+	AccessProfile AccessProfile::load(std::istream &in)
+	{
+		AccessProfile profile;
+		string line;
+		if (!std::getline(in, line) || line != PROFILE_HEADER)
+			throw std::runtime_error("not a luapath access profile");
+		while (std::getline(in, line))
+		{
+			if (line.empty() || line[0] == '#')
+				continue;
+			std::size_t space = line.find(' ');
+			if (space == string::npos || space == 0 || line.find_first_not_of("0123456789") != space)
+				throw std::runtime_error("malformed line in the access profile: " + line);
+			profile.counts[line.substr(space + 1)] += std::stoull(line.substr(0, space));
+		}
+		return profile;
+	}
+
+	void AccessProfile::save(std::ostream &out) const
+	{
+		std::vector<std::pair<uint64_t, const string*> > sorted;
+		sorted.reserve(counts.size());
+		for (std::unordered_map<string, uint64_t>::const_iterator it = counts.begin(); it != counts.end(); ++it)
+			sorted.push_back(std::make_pair(it->second, &it->first));
+		// most visited first, then by path so the output is stable
+		std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint64_t, const string*> &lhs, const std::pair<uint64_t, const string*> &rhs) {
+			return lhs.first != rhs.first ? lhs.first > rhs.first : *lhs.second < *rhs.second;
+		});
+		out << PROFILE_HEADER << '\n';
+		for (const std::pair<uint64_t, const string*> &entry : sorted)
+			out << entry.first << ' ' << *entry.second << '\n';
+	}
+
+	uint64_t AccessProfile::count(const string &path) const
+	{
+		std::unordered_map<string, uint64_t>::const_iterator it = counts.find(path);
+		return it != counts.end() ? it->second : 0;
+	}
+
+	std::size_t AccessProfile::size() const
+	{
+		return counts.size();
+	}
+
+	void AccessProfile::merge(const AccessProfile &other)
+	{
+		for (std::unordered_map<string, uint64_t>::const_iterator it = other.counts.begin(); it != other.counts.end(); ++it)
+			counts[it->first] += it->second;
+	}
+
+}
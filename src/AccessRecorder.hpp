@@ -0,0 +1,21 @@
+#ifndef ACCESSRECORDER_HPP
+#pragma once
+
+#include <atomic>
+
+namespace luapath
+{
+	/** set by luapath::startAccessRecording. Read on every lookup*/
+	extern std::atomic<bool> accessSwitch;
+
+	/** counts a visit of @p node for the calling thread. Use noteAccess*/
+	void recordAccess(const void *node);
+
+	/** Counts a visit of the Table or Value @p node if access recording is on. Internal to the library*/
+	inline void noteAccess(const void *node)
+	{
+		if (accessSwitch.load(std::memory_order_relaxed))
+			recordAccess(node);
+	}
+}
+#endif // !ACCESSRECORDER_HPP
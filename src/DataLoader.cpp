@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "luapath/DataLoader.hpp"
+#include "luapath/Trace.hpp"
+#include "LuaSyntax.hpp"
+#include "NumberFormat.hpp"
+#include "Scan.hpp"
+#include "StatCounters.hpp"
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		/** thrown by the Parser when the chunk is not data only*/
+		struct NotData {};
+
+		/** same limit as the nesting of the lua parser (LUAI_MAXCCALLS)*/
+		const int MAX_DEPTH = 200;
+
+		bool isDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		bool isHexDigit(char c)
+		{
+			return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+		}
+
+		int hexValue(char c)
+		{
+			return isDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+		}
+
+		/** @brief What a table constructor did that can't be seen in the finished Table*/
+		struct Constructed
+		{
+			/** keys that were assigned nil*/
+			std::vector<Key> nils;
+			/** number of positional fields*/
+			int positional;
+			/** the smallest explicit number key of at least 1*/
+			int smallestExplicit;
+
+			Constructed()
+				: positional(0), smallestExplicit(INT_MAX)
+			{
+			}
+		};
+	}
+
+	/** @brief Recursive descent parser of data only lua chunks
+		@details Follows the lexical rules of the lua 5.2 lexer for the subset it accepts and throws
+		NotData for everything else, including syntax errors, so that lua reports those.
+	*/
+	class DataLoader::Parser
+	{
+	public:
+		Parser(const char *begin, const char *end)
+			: p(begin), end(end), depth(0), scan(scanner())
+		{
+		}
+
+		void chunk(Table &globals)
+		{
+			Constructed constructed;
+			skipSpace();
+			while (p != end)
+			{
+				if (*p == ';')
+				{
+					++p;
+					skipSpace();
+					continue;
+				}
+				const char *name = p;
+				if (!isNameStart(*p))
+					throw NotData();
+				while (++p != end && isNameChar(*p));
+				if (isKeyword(name, p - name))
+					throw NotData();
+				Key key(Key::Type::STRING, string(name, p));
+				skipSpace();
+				expectAssignment();
+				value(globals, std::move(key), constructed);
+				skipSpace();
+			}
+			finish(globals, constructed);
+		}
+
+	private:
+		char peek(std::size_t ahead = 0) const
+		{
+			return (std::size_t)(end - p) > ahead ? p[ahead] : '\0';
+		}
+
+		void expect(char c)
+		{
+			if (p == end || *p != c)
+				throw NotData();
+			++p;
+		}
+
+		/** "=" but not "=="*/
+		void expectAssignment()
+		{
+			if (peek() != '=' || peek(1) == '=')
+				throw NotData();
+			++p;
+			skipSpace();
+		}
+
+		void skipSpace()
+		{
+			while (true)
+			{
+				p = scan.skipSpace(p, end);
+				if (peek() != '-' || peek(1) != '-')
+					return;
+				p += 2;
+				int level = longBracketLevel();
+				if (level >= 0)
+					longBracket(level, nullptr);
+				else
+					p = scan.findAny(p, end, '\n', '\r', '\n', '\r');
+			}
+		}
+
+		/** the level of a long bracket "[==[" starting at p or -1 if there is none*/
+		int longBracketLevel() const
+		{
+			if (peek() != '[')
+				return -1;
+			std::size_t level = 1;
+			while (peek(level) == '=')
+				++level;
+			return peek(level) == '[' ? (int)level - 1 : -1;
+		}
+
+		/** reads the long string or comment at p. The content is stored in @p out if not null*/
+		void longBracket(int level, string *out)
+		{
+			p += level + 2;
+			// a newline right after the opening bracket is not part of the string
+			if (p != end && (*p == '\n' || *p == '\r'))
+				newline(nullptr);
+			while (true)
+			{
+				const char *run = p;
+				p = scan.findAny(p, end, ']', '\n', '\r', ']');
+				if (out)
+					out->append(run, p);
+				if (p == end)
+					break;
+				if (*p == ']')
+				{
+					const char *close = p + 1;
+					int equals = 0;
+					while (close != end && *close == '=')
+					{
+						++close;
+						++equals;
+					}
+					if (equals == level && close != end && *close == ']')
+					{
+						p = close + 1;
+						return;
+					}
+				}
+				if (*p == '\n' || *p == '\r')
+				{
+					newline(out);
+					continue;
+				}
+				if (out)
+					out->push_back(*p);
+				++p;
+			}
+			throw NotData();
+		}
+
+		/** any of "\n", "\r", "\r\n" and "\n\r" is a single newline in lua*/
+		void newline(string *out)
+		{
+			char first = *p++;
+			if (p != end && (*p == '\n' || *p == '\r') && *p != first)
+				++p;
+			if (out)
+				out->push_back('\n');
+		}
+
+		void quotedString(string &out)
+		{
+			char delimiter = *p++;
+			while (true)
+			{
+				// copy the characters up to the next one that needs a look in one go
+				const char *run = p;
+				p = scan.findAny(p, end, delimiter, '\\', '\n', '\r');
+				out.append(run, p);
+				if (p == end || *p == '\n' || *p == '\r')
+					throw NotData();
+				if (*p++ == delimiter)
+					return;
+				escape(out);
+			}
+		}
+
+		void escape(string &out)
+		{
+			if (p == end)
+				throw NotData();
+			char c = *p;
+			switch (c)
+			{
+			case 'a': out.push_back('\a'); ++p; return;
+			case 'b': out.push_back('\b'); ++p; return;
+			case 'f': out.push_back('\f'); ++p; return;
+			case 'n': out.push_back('\n'); ++p; return;
+			case 'r': out.push_back('\r'); ++p; return;
+			case 't': out.push_back('\t'); ++p; return;
+			case 'v': out.push_back('\v'); ++p; return;
+			case '\\': case '"': case '\'': out.push_back(c); ++p; return;
+			case '\n': case '\r': newline(&out); return;
+			case 'x':
+				if (!isHexDigit(peek(1)) || !isHexDigit(peek(2)))
+					throw NotData();
+				out.push_back((char)(hexValue(p[1]) * 16 + hexValue(p[2])));
+				p += 3;
+				return;
+			case 'z':
+				p = scan.skipSpace(p + 1, end);
+				return;
+			default:
+			{
+				if (!isDigit(c))
+					throw NotData();
+				int code = 0;
+				for (int digits = 0; digits < 3 && p != end && isDigit(*p); ++digits, ++p)
+					code = code * 10 + (*p - '0');
+				if (code > UCHAR_MAX)
+					throw NotData();
+				out.push_back((char)code);
+				return;
+			}
+			}
+		}
+
+		/** reads a numeral like the lua lexer does and converts it with strtod*/
+		double number()
+		{
+			const char *start = p;
+			const char *exponent = "Ee";
+			if (peek() == '0' && (peek(1) == 'x' || peek(1) == 'X'))
+			{
+				exponent = "Pp";
+				p += 2;
+			}
+			while (true)
+			{
+				// the decimal exponents 'e' and 'E' are hex digits, the run stops at 'p', 'P' and signs
+				p = scan.skipNumeral(p, end);
+				if (p == end)
+					break;
+				if (*p == exponent[0] || *p == exponent[1])
+					++p;
+				else if ((*p == '+' || *p == '-') && (p[-1] == exponent[0] || p[-1] == exponent[1]))
+					++p;
+				else
+					break;
+			}
+			double result;
+			// parseNumber doesn't depend on the locale. If it doesn't agree with lua let lua do it
+			if (parseNumber(start, p, result) != p)
+				throw NotData();
+			return result;
+		}
+
+		bool startsNumber() const
+		{
+			return isDigit(peek()) || (peek() == '.' && isDigit(peek(1)));
+		}
+
+		/** a number literal with an optional unary minus*/
+		double signedNumber()
+		{
+			bool negative = false;
+			if (peek() == '-')
+			{
+				++p;
+				skipSpace();
+				negative = true;
+			}
+			if (!startsNumber())
+				throw NotData();
+			double result = number();
+			return negative ? -result : result;
+		}
+
+		/** true iff the literal name @p word is at p and isn't the start of a longer name*/
+		bool word(const char *literal)
+		{
+			std::size_t length = std::strlen(literal);
+			if ((std::size_t)(end - p) < length || std::memcmp(p, literal, length) != 0)
+				return false;
+			if (p + length != end && isNameChar(p[length]))
+				return false;
+			p += length;
+			return true;
+		}
+
+		/** parses a value and stores it in @p table under @p key*/
+		void value(Table &table, Key &&key, Constructed &constructed)
+		{
+			char c = peek();
+			if (c == '{')
+			{
+				Table nested(key);
+				Table &child = table.nestedSet.append(std::move(key), std::move(nested)).second;
+				constructor(child);
+			}
+			else if (c == '"' || c == '\'')
+			{
+				string text;
+				quotedString(text);
+				table.leafSet.append(std::move(key), Value(Value::Type::STRING, std::move(text)));
+			}
+			else if (c == '[')
+			{
+				int level = longBracketLevel();
+				if (level < 0)
+					throw NotData();
+				string text;
+				longBracket(level, &text);
+				table.leafSet.append(std::move(key), Value(Value::Type::STRING, std::move(text)));
+			}
+			else if (c == '-' || startsNumber())
+				table.leafSet.append(std::move(key), Value(Value::Type::NUMBER, signedNumber()));
+			else if (word("true"))
+				table.leafSet.append(std::move(key), Value(Value::Type::BOOL, true));
+			else if (word("false"))
+				table.leafSet.append(std::move(key), Value(Value::Type::BOOL, false));
+			else if (word("nil"))
+			{
+				// a positional nil only leaves a hole
+				if (key.type == Key::Type::STRING || (int)key > constructed.positional)
+					constructed.nils.push_back(std::move(key));
+			}
+			else
+				throw NotData();
+		}
+
+		/** the key in "[key] = value"*/
+		Key bracketKey(Constructed &constructed)
+		{
+			++p;
+			skipSpace();
+			char c = peek();
+			Key key(0);
+			if (c == '"' || c == '\'')
+			{
+				string text;
+				quotedString(text);
+				key = Key(Key::Type::STRING, std::move(text));
+			}
+			else if (c == '[' && longBracketLevel() >= 0)
+			{
+				string text;
+				longBracket(longBracketLevel(), &text);
+				key = Key(Key::Type::STRING, std::move(text));
+			}
+			else
+			{
+				// only integer keys can be represented, a snapshot would truncate the others.
+				// The range is checked before the cast which is undefined outside of it, and it rejects nan
+				double number = signedNumber();
+				if (!(number >= INT_MIN && number <= INT_MAX) || number != (double)(int)number)
+					throw NotData();
+				key = Key((int)number);
+				if ((int)number >= 1 && (int)number < constructed.smallestExplicit)
+					constructed.smallestExplicit = (int)number;
+			}
+			skipSpace();
+			expect(']');
+			skipSpace();
+			expectAssignment();
+			return key;
+		}
+
+		void constructor(Table &table)
+		{
+			if (++depth > MAX_DEPTH)
+				throw NotData();
+			expect('{');
+			Constructed constructed;
+			while (true)
+			{
+				skipSpace();
+				if (peek() == '}')
+					break;
+				if (peek() == '[' && longBracketLevel() < 0)
+				{
+					Key key = bracketKey(constructed);
+					value(table, std::move(key), constructed);
+				}
+				else if (isNameStart(peek()))
+				{
+					const char *name = p;
+					while (++p != end && isNameChar(*p));
+					const char *nameEnd = p;
+					skipSpace();
+					if (peek() == '=' && peek(1) != '=')
+					{
+						if (isKeyword(name, nameEnd - name))
+							throw NotData();
+						expectAssignment();
+						value(table, Key(Key::Type::STRING, string(name, nameEnd)), constructed);
+					}
+					else
+					{
+						// a positional true, false or nil. Anything else is a variable
+						p = name;
+						value(table, Key(++constructed.positional), constructed);
+					}
+				}
+				else
+					value(table, Key(++constructed.positional), constructed);
+
+				skipSpace();
+				if (peek() == ',' || peek() == ';')
+					++p;
+				else if (peek() != '}')
+					throw NotData();
+			}
+			expect('}');
+			--depth;
+			finish(table, constructed);
+		}
+
+		/** @brief Orders the fields of @p table
+			@details Repeated keys keep their last value like in lua. The cases where the order of the
+			assignments can't be told from the sets any more are left to lua: a key that is both a value
+			and a table, a key assigned nil as well as a value and a positional field with an explicit key.
+		*/
+		void finish(Table &table, const Constructed &constructed)
+		{
+			if (constructed.smallestExplicit <= constructed.positional)
+				throw NotData();
+			table.leafSet.sort();
+			table.nestedSet.sort();
+			if (!table.leafSet.empty() && !table.nestedSet.empty())
+			{
+				Table::LeafSet::const_iterator leaf = table.leafSet.begin();
+				Table::NestedSet::const_iterator nested = table.nestedSet.begin();
+				while (leaf != table.leafSet.end() && nested != table.nestedSet.end())
+				{
+					if (leaf->first < nested->first)
+						++leaf;
+					else if (nested->first < leaf->first)
+						++nested;
+					else
+						throw NotData();
+				}
+			}
+			for (const Key &nil : constructed.nils)
+			{
+				if (table.contains(nil))
+					throw NotData();
+			}
+		}
+
+		const char *p;
+		const char *end;
+		int depth;
+		const Scanner &scan;
+	};
+
+	bool DataLoader::parse(const string &source, Table &globals)
+	{
+		return parse(source.data(), source.data() + source.size(), globals);
+	}
+
+	bool DataLoader::parse(const char *begin, const char *end, Table &globals)
+	{
+		LUAPATH_TRACE_ZONE("DataLoader::parse");
+		StatTimer timer(StatCounter::PARSE_NS);
+		Table parsed;
+		try
+		{
+			Parser(begin, end).chunk(parsed);
+		}
+		catch (NotData &)
+		{
+			return false;
+		}
+		timer.stop();
+		countStat(StatCounter::LOADS);
+		globals = std::move(parsed);
+		return true;
+	}
+
+	Table DataLoader::loadString(const string &source, const LoadOptions &options)
+	{
+		Table globals;
+		if (parse(source, globals))
+			return globals;
+		LuaState state;
+		state.loadString(source, options);
+		return state.getGlobals();
+	}
+
+	Table DataLoader::loadFile(const string &filepath, const LoadOptions &options)
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("DataLoader::loadFile", filepath);
+		std::ifstream file(filepath.c_str(), std::ios::binary);
+		if (file)
+		{
+			string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			// the UTF-8 byte order mark and a first line starting with '#' are skipped like luaL_loadfile does
+			const char *begin = source.data();
+			const char *end = begin + source.size();
+			if (source.compare(0, 3, "\xEF\xBB\xBF") == 0)
+				begin += 3;
+			if (begin != end && *begin == '#')
+				begin = std::find(begin, end, '\n');
+			Table globals;
+			if (!file.bad() && parse(begin, end, globals))
+				return globals;
+		}
+		// let lua report a file that can't be read
+		LuaState state;
+		state.loadFile(filepath, options);
+		return state.getGlobals();
+	}
+
+}
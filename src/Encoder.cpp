@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <climits>
+
+#include "Encoder.hpp"
+#include "NumberFormat.hpp"
+#include "SearchPath.hpp"
+
+namespace luapath{
+
+	namespace
+	{
+		/** true iff the keys of @p table are the numbers 1 to its size*/
+		bool isArray(const Table &table)
+		{
+			Table::LeafRange leaves = table.leaves();
+			Table::NestedRange tables = table.tables();
+			if (table.empty())
+				return false;
+			// number keys are ordered first so only the last key of each set needs to be a number
+			if ((!leaves.empty() && (leaves.end() - 1)->first.type != Key::Type::NUMBER) ||
+				(!tables.empty() && (tables.end() - 1)->first.type != Key::Type::NUMBER))
+				return false;
+			// the keys are distinct ints so they are 1 to n iff the smallest is 1 and the largest is n
+			int smallest = INT_MAX;
+			int largest = INT_MIN;
+			if (!leaves.empty())
+			{
+				smallest = keyNumber(leaves.begin()->first.key);
+				largest = keyNumber((leaves.end() - 1)->first.key);
+			}
+			if (!tables.empty())
+			{
+				smallest = std::min(smallest, keyNumber(tables.begin()->first.key));
+				largest = std::max(largest, keyNumber((tables.end() - 1)->first.key));
+			}
+			return smallest == 1 && (std::size_t)largest == table.size();
+		}
+
+		void encodeValue(const Value &value, Encoder &encoder)
+		{
+			switch (value.type)
+			{
+			case Value::Type::STRING:
+				encoder.str(value.value.data(), value.value.size());
+				break;
+			case Value::Type::NUMBER:{
+				double number = 0;
+				const char *text = value.value.data();
+				parseNumber(text, text + value.value.size(), number);
+				encoder.number(number, text, value.value.size());
+				break;
+			}
+			case Value::Type::BOOL:
+				encoder.boolean(value.value == "true");
+				break;
+			case Value::Type::TABLE:
+				encoder.beginObject(0);
+				encoder.endObject();
+				break;
+			}
+		}
+	}
+
+	void encodeTable(const Table &table, Encoder &encoder)
+	{
+		bool array = isArray(table);
+		if (array)
+			encoder.beginArray(table.size());
+		else
+			encoder.beginObject(table.size());
+
+		Table::LeafSet::const_iterator leafIt = table.leaves().begin(), leafEnd = table.leaves().end();
+		Table::NestedSet::const_iterator nestedIt = table.tables().begin(), nestedEnd = table.tables().end();
+		while (leafIt != leafEnd || nestedIt != nestedEnd)
+		{
+			bool atLeaf = leafIt != leafEnd && (nestedIt == nestedEnd || leafIt->first < nestedIt->first);
+			const Key &key = atLeaf ? leafIt->first : nestedIt->first;
+			if (!array && key.type == Key::Type::NUMBER)
+				encoder.key(keyNumber(key.key));
+			else if (!array)
+				encoder.key(key.key.data(), key.key.size());
+			if (atLeaf)
+				encodeValue((leafIt++)->second, encoder);
+			else
+				encodeTable((nestedIt++)->second, encoder);
+		}
+
+		if (array)
+			encoder.endArray();
+		else
+			encoder.endObject();
+	}
+
+}
@@ -0,0 +1,41 @@
+#ifndef ENCODER_HPP
+#pragma once
+
+#include <cstddef>
+
+#include "luapath/LuaTypes.hpp"
+
+namespace luapath
+{
+	/** @brief The events the JSON and MessagePack writers turn into output. Internal to the library
+		@details A container is announced with the number of its elements. The elements of an object
+		are each a call to Encoder::key followed by the value, those of an array just the values.
+	*/
+	class Encoder
+	{
+	public:
+		virtual ~Encoder() {}
+
+		virtual void beginArray(std::size_t size) = 0;
+		virtual void endArray() = 0;
+		virtual void beginObject(std::size_t size) = 0;
+		virtual void endObject() = 0;
+
+		virtual void key(const char *data, std::size_t length) = 0;
+		virtual void key(int number) = 0;
+
+		virtual void str(const char *data, std::size_t length) = 0;
+
+		/** @brief A number, @p text is its shortest round trip form if the caller has it or null*/
+		virtual void number(double value, const char *text, std::size_t length) = 0;
+
+		virtual void boolean(bool value) = 0;
+	};
+
+	/** @brief Feeds @p table to @p encoder
+		@details A table whose keys are exactly the numbers 1 to n becomes an array, any other table
+		an object with its keys in key order. An empty table is an empty object.
+	*/
+	void encodeTable(const Table &table, Encoder &encoder);
+}
+#endif // !ENCODER_HPP
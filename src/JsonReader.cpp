@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "luapath/JsonReader.hpp"
+#include "luapath/Trace.hpp"
+#include "luapath/exceptions.hpp"
+#include "NumberFormat.hpp"
+#include "Scan.hpp"
+#include "StatCounters.hpp"
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		/** nesting deeper than this is rejected before it can overflow the C stack*/
+		const int MAX_DEPTH = 1000;
+
+		bool isDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		int hexValue(char c)
+		{
+			if (isDigit(c))
+				return c - '0';
+			c |= 0x20;
+			return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+		}
+
+		void appendUtf8(string &text, unsigned code)
+		{
+			if (code < 0x80)
+				text += (char)code;
+			else if (code < 0x800)
+			{
+				text += (char)(0xc0 | (code >> 6));
+				text += (char)(0x80 | (code & 0x3f));
+			}
+			else if (code < 0x10000)
+			{
+				text += (char)(0xe0 | (code >> 12));
+				text += (char)(0x80 | ((code >> 6) & 0x3f));
+				text += (char)(0x80 | (code & 0x3f));
+			}
+			else
+			{
+				text += (char)(0xf0 | (code >> 18));
+				text += (char)(0x80 | ((code >> 12) & 0x3f));
+				text += (char)(0x80 | ((code >> 6) & 0x3f));
+				text += (char)(0x80 | (code & 0x3f));
+			}
+		}
+	}
+
+	/** @brief Recursive descent parser of RFC 8259 JSON appending straight to a Table*/
+	class JsonReader::Parser
+	{
+	public:
+		Parser(const char *begin, const char *end)
+			: begin(begin), p(begin), end(end), depth(0), scan(scanner())
+		{
+		}
+
+		void document(Table &root)
+		{
+			if (end - p >= 3 && std::memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+				p += 3;
+			skipSpace();
+			if (peek() == '{')
+				object(root);
+			else if (peek() == '[')
+				array(root);
+			else
+				fail("the document has to be an object or an array");
+			skipSpace();
+			if (p != end)
+				fail("unexpected text after the end of the document");
+		}
+
+	private:
+		char peek() const
+		{
+			return p != end ? *p : '\0';
+		}
+
+		void skipSpace()
+		{
+			while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+				++p;
+		}
+
+		/** throws json_parse_exception for the current position*/
+		void fail(const char *message) const
+		{
+			failAt(p, message);
+		}
+
+		void failAt(const char *at, const char *message) const
+		{
+			std::size_t line = 1 + (std::size_t)std::count(begin, at, '\n');
+			const char *lineStart = at;
+			while (lineStart != begin && lineStart[-1] != '\n')
+				--lineStart;
+			throw json_parse_exception(string("JSON parse error at line ").append(std::to_string(line))
+				.append(", column ").append(std::to_string(at - lineStart + 1)).append(": ").append(message),
+				(std::size_t)(at - begin));
+		}
+
+		void enter()
+		{
+			if (++depth > MAX_DEPTH)
+				fail("objects and arrays nested too deeply");
+			++p;
+			skipSpace();
+		}
+
+		void object(Table &table)
+		{
+			const char *start = p;
+			enter();
+			if (peek() == '}')
+			{
+				++p;
+				--depth;
+				return;
+			}
+			// the members that were null, held in leafSet until the repeated names are resolved
+			std::size_t nulls = 0;
+			while (true)
+			{
+				if (peek() != '"')
+					fail("expected a string as the name of an object member");
+				string name;
+				str(name);
+				skipSpace();
+				if (peek() != ':')
+					fail("expected ':' after the name of an object member");
+				++p;
+				skipSpace();
+				if (peek() == 'n')
+				{
+					literal("null");
+					table.leafSet.append(Key(Key::Type::STRING, std::move(name)), Value(Value::Type::TABLE, ""));
+					++nulls;
+				}
+				else
+					value(table, Key(Key::Type::STRING, std::move(name)));
+				skipSpace();
+				if (peek() == ',')
+				{
+					++p;
+					skipSpace();
+					continue;
+				}
+				if (peek() != '}')
+					fail("expected ',' or '}' after an object member");
+				++p;
+				break;
+			}
+			--depth;
+
+			// repeated names keep the last value like a lua table constructor does, so a null
+			// after a value removes the name and a value after a null keeps it
+			table.leafSet.sort();
+			table.nestedSet.sort();
+			if (!table.leafSet.empty() && !table.nestedSet.empty())
+			{
+				Table::LeafSet::const_iterator leaf = table.leafSet.begin();
+				Table::NestedSet::const_iterator nested = table.nestedSet.begin();
+				while (leaf != table.leafSet.end() && nested != table.nestedSet.end())
+				{
+					if (leaf->first < nested->first)
+						++leaf;
+					else if (nested->first < leaf->first)
+						++nested;
+					else
+						failAt(start, "an object has the same name for a value and an object or array");
+				}
+			}
+			if (nulls)
+				table.leafSet.erase_if([](const Table::LeafSet::value_type &leaf) { return leaf.second.type == Value::Type::TABLE; });
+		}
+
+		void array(Table &table)
+		{
+			enter();
+			if (peek() == ']')
+			{
+				++p;
+				--depth;
+				return;
+			}
+			// the keys are appended in order so the sets need no sorting
+			for (int index = 1; ; ++index)
+			{
+				value(table, Key(index));
+				skipSpace();
+				if (peek() == ',')
+				{
+					++p;
+					skipSpace();
+					continue;
+				}
+				if (peek() != ']')
+					fail("expected ',' or ']' after an array element");
+				++p;
+				break;
+			}
+			--depth;
+		}
+
+		void value(Table &table, Key &&key)
+		{
+			switch (peek())
+			{
+			case '{':{
+				Table nested(key);
+				Table &child = table.nestedSet.append(std::move(key), std::move(nested)).second;
+				object(child);
+				break;
+			}
+			case '[':{
+				Table nested(key);
+				Table &child = table.nestedSet.append(std::move(key), std::move(nested)).second;
+				array(child);
+				break;
+			}
+			case '"':{
+				string text;
+				str(text);
+				table.leafSet.append(std::move(key), Value(Value::Type::STRING, std::move(text)));
+				break;
+			}
+			case 't':
+				literal("true");
+				table.leafSet.append(std::move(key), Value(Value::Type::BOOL, true));
+				break;
+			case 'f':
+				literal("false");
+				table.leafSet.append(std::move(key), Value(Value::Type::BOOL, false));
+				break;
+			case 'n':
+				// a null leaves a hole in an array, object() handles the nulls of its members
+				literal("null");
+				break;
+			default:
+				if (peek() != '-' && !isDigit(peek()))
+					fail("expected a value");
+				table.leafSet.append(std::move(key), Value(Value::Type::NUMBER, number()));
+				break;
+			}
+		}
+
+		void literal(const char *word)
+		{
+			std::size_t length = std::strlen(word);
+			if ((std::size_t)(end - p) < length || std::memcmp(p, word, length) != 0)
+				fail("expected a value");
+			p += length;
+		}
+
+		double number()
+		{
+			const char *start = p;
+			if (*p == '-')
+				++p;
+			if (!isDigit(peek()))
+				fail("invalid number");
+			if (*p == '0')
+				++p;
+			else
+				while (p != end && isDigit(*p))
+					++p;
+			if (peek() == '.')
+			{
+				++p;
+				if (!isDigit(peek()))
+					fail("invalid number");
+				while (p != end && isDigit(*p))
+					++p;
+			}
+			if (peek() == 'e' || peek() == 'E')
+			{
+				++p;
+				if (peek() == '+' || peek() == '-')
+					++p;
+				if (!isDigit(peek()))
+					fail("invalid number");
+				while (p != end && isDigit(*p))
+					++p;
+			}
+			double result = 0;
+			if (parseNumber(start, p, result) != p)
+				failAt(start, "invalid number");
+			return result;
+		}
+
+		void str(string &text)
+		{
+			const char *start = p++;
+			while (true)
+			{
+				const char *stop = scan.findStringEnd(p, end, '"');
+				text.append(p, stop);
+				p = stop;
+				if (p == end)
+					failAt(start, "unterminated string");
+				if (*p == '"')
+				{
+					++p;
+					return;
+				}
+				if (*p != '\\')
+					fail("control character in a string");
+				if (++p == end)
+					failAt(start, "unterminated string");
+				switch (*p++)
+				{
+				case '"': text += '"'; break;
+				case '\\': text += '\\'; break;
+				case '/': text += '/'; break;
+				case 'b': text += '\b'; break;
+				case 'f': text += '\f'; break;
+				case 'n': text += '\n'; break;
+				case 'r': text += '\r'; break;
+				case 't': text += '\t'; break;
+				case 'u': unicodeEscape(text); break;
+				default:
+					--p;
+					fail("invalid escape sequence");
+				}
+			}
+		}
+
+		/** the 4 hex digits of a \\u escape*/
+		unsigned hex4()
+		{
+			if (end - p < 4)
+				fail("invalid unicode escape");
+			unsigned code = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				int digit = hexValue(p[i]);
+				if (digit < 0)
+					fail("invalid unicode escape");
+				code = code * 16 + (unsigned)digit;
+			}
+			p += 4;
+			return code;
+		}
+
+		void unicodeEscape(string &text)
+		{
+			unsigned code = hex4();
+			if (code >= 0xdc00 && code <= 0xdfff)
+				fail("unpaired surrogate in a unicode escape");
+			if (code >= 0xd800 && code <= 0xdbff)
+			{
+				if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+					fail("unpaired surrogate in a unicode escape");
+				p += 2;
+				unsigned low = hex4();
+				if (low < 0xdc00 || low > 0xdfff)
+					fail("unpaired surrogate in a unicode escape");
+				code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+			}
+			appendUtf8(text, code);
+		}
+
+		const char *begin;
+		const char *p;
+		const char *end;
+		int depth;
+		const Scanner &scan;
+	};
+
+	Table JsonReader::parse(const string &json, const Key &tableKey)
+	{
+		return parse(json.data(), json.data() + json.size(), tableKey);
+	}
+
+	Table JsonReader::parse(const char *begin, const char *end, const Key &tableKey)
+	{
+		LUAPATH_TRACE_ZONE("JsonReader::parse");
+		StatTimer timer(StatCounter::PARSE_NS);
+		Table root(tableKey);
+		Parser(begin, end).document(root);
+		timer.stop();
+		countStat(StatCounter::LOADS);
+		return root;
+	}
+
+	Table JsonReader::loadFile(const string &filepath, const Key &tableKey)
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("JsonReader::loadFile", filepath);
+		std::ifstream file(filepath.c_str(), std::ios::binary);
+		if (!file)
+			throw json_parse_exception(string("Could not open the JSON file - ").append(filepath), 0);
+		string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (file.bad())
+			throw json_parse_exception(string("Could not read the JSON file - ").append(filepath), 0);
+		return parse(json, tableKey);
+	}
+
+}
@@ -0,0 +1,205 @@
+#include <cmath>
+#include <vector>
+
+#include "luapath/JsonWriter.hpp"
+#include "luapath/Trace.hpp"
+#include "Encoder.hpp"
+#include "NumberFormat.hpp"
+#include "OutputBuffer.hpp"
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		const char HEX_DIGITS[] = "0123456789abcdef";
+
+		class JsonEncoder
+			: public Encoder
+		{
+		public:
+			JsonEncoder(OutputBuffer &out, WriteStyle style)
+				: out(out), pretty(style == WriteStyle::PRETTY), afterKey(false)
+			{
+			}
+
+			virtual void beginArray(std::size_t)
+			{
+				beforeValue();
+				out.put('[');
+				empty.push_back(true);
+			}
+
+			virtual void endArray()
+			{
+				endContainer();
+				out.put(']');
+			}
+
+			virtual void beginObject(std::size_t)
+			{
+				beforeValue();
+				out.put('{');
+				empty.push_back(true);
+			}
+
+			virtual void endObject()
+			{
+				endContainer();
+				out.put('}');
+			}
+
+			virtual void key(const char *data, std::size_t length)
+			{
+				beforeValue();
+				writeString(data, length);
+				writeColon();
+			}
+
+			virtual void key(int number)
+			{
+				beforeValue();
+				char buffer[NUMBER_BUFFER_SIZE];
+				out.put('"');
+				out.append(buffer, formatNumber((double)number, buffer));
+				out.put('"');
+				writeColon();
+			}
+
+			virtual void str(const char *data, std::size_t length)
+			{
+				beforeValue();
+				writeString(data, length);
+			}
+
+			virtual void number(double value, const char *text, std::size_t length)
+			{
+				beforeValue();
+				if (!std::isfinite(value))
+					out.append("null");
+				else if (text)
+					out.append(text, length);
+				else
+				{
+					char buffer[NUMBER_BUFFER_SIZE];
+					out.append(buffer, formatNumber(value, buffer));
+				}
+			}
+
+			virtual void boolean(bool value)
+			{
+				beforeValue();
+				if (value)
+					out.append("true");
+				else
+					out.append("false");
+			}
+
+		private:
+			/** the separator and indentation before an element of the current container*/
+			void beforeValue()
+			{
+				if (afterKey)
+				{
+					afterKey = false;
+					return;
+				}
+				if (empty.empty())
+					return;
+				if (!empty.back())
+					out.put(',');
+				empty.back() = false;
+				if (pretty)
+				{
+					out.put('\n');
+					out.fill('\t', empty.size());
+				}
+			}
+
+			void endContainer()
+			{
+				bool wasEmpty = empty.back();
+				empty.pop_back();
+				if (pretty && !wasEmpty)
+				{
+					out.put('\n');
+					out.fill('\t', empty.size());
+				}
+			}
+
+			void writeColon()
+			{
+				if (pretty)
+					out.append(": ");
+				else
+					out.put(':');
+				afterKey = true;
+			}
+
+			void writeString(const char *data, std::size_t length)
+			{
+				out.put('"');
+				const char *run = data;
+				const char *end = data + length;
+				for (const char *p = data; p != end; ++p)
+				{
+					unsigned char c = (unsigned char)*p;
+					if (c >= 0x20 && c != '"' && c != '\\')
+						continue;
+					out.append(run, p - run);
+					run = p + 1;
+					switch (c)
+					{
+					case '"': out.append("\\\""); break;
+					case '\\': out.append("\\\\"); break;
+					case '\n': out.append("\\n"); break;
+					case '\r': out.append("\\r"); break;
+					case '\t': out.append("\\t"); break;
+					case '\b': out.append("\\b"); break;
+					case '\f': out.append("\\f"); break;
+					default:{
+						char escape[6] = { '\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf] };
+						out.append(escape, 6);
+					}
+					}
+				}
+				out.append(run, end - run);
+				out.put('"');
+			}
+
+			OutputBuffer &out;
+			bool pretty;
+			/** for every open container whether nothing was written into it yet*/
+			std::vector<bool> empty;
+			/** true between a key and its value*/
+			bool afterKey;
+		};
+	}
+
+	void JsonWriter::write(const Table &table, OutputSink &sink, WriteStyle style)
+	{
+		LUAPATH_TRACE_ZONE("JsonWriter::write");
+		OutputBuffer buffer(sink);
+		JsonEncoder encoder(buffer, style);
+		encodeTable(table, encoder);
+		buffer.flush();
+	}
+
+	void JsonWriter::write(LuaState &state, const string &tableName, OutputSink &sink, WriteStyle style)
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("JsonWriter::write", tableName);
+		OutputBuffer buffer(sink);
+		JsonEncoder encoder(buffer, style);
+		state.encodeGlobalTable(tableName, encoder);
+		buffer.flush();
+	}
+
+	string JsonWriter::toString(const Table &table, WriteStyle style)
+	{
+		string result;
+		StringSink sink(result);
+		write(table, sink, style);
+		return result;
+	}
+
+}
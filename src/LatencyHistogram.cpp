@@ -0,0 +1,266 @@
+#include <iomanip>
+#include <mutex>
+
+#include "luapath/LatencyHistogram.hpp"
+#include "luapath/LuaTypes.hpp"
+#include "LookupLatency.hpp"
+#include "ThreadRegistry.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::uint64_t;
+
+	std::atomic<bool> latencySwitch(false);
+
+	namespace
+	{
+		/** every power of two above EXACT_LIMIT is split into 2^SUB_BUCKET_BITS buckets*/
+		const unsigned SUB_BUCKET_BITS = 6;
+		const uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		const uint64_t EXACT_LIMIT = SUB_BUCKETS * 2;
+		const unsigned MAX_VALUE_BITS = 36;
+		const uint64_t MAX_VALUE = ((uint64_t)1 << MAX_VALUE_BITS) - 1;
+		const std::size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+		unsigned highestBit(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return 63 - __builtin_clzll(value);
+#else
+			unsigned bit = 0;
+			while (value >>= 1)
+				++bit;
+			return bit;
+#endif
+		}
+
+		std::atomic<unsigned> prefixDepth(2);
+		thread_local const char *currentSite = nullptr;
+
+		void mergeInto(std::map<string, LatencyHistogram> &into, const std::map<string, LatencyHistogram> &from)
+		{
+			for (std::map<string, LatencyHistogram>::const_iterator it = from.begin(); it != from.end(); ++it)
+				into[it->first].merge(it->second);
+		}
+
+		/** @brief The histograms of one thread
+			@details The mutex is only contended while the histograms are read or reset*/
+		struct ThreadHistograms
+		{
+			std::mutex mutex;
+			std::map<string, LatencyHistogram> sites;
+			/** reused to build the name of the site so a lookup of a known site doesn't allocate*/
+			string name;
+		};
+
+		void retireHistograms(std::map<string, LatencyHistogram> &retired, const ThreadHistograms &thread)
+		{
+			mergeInto(retired, thread.sites);
+		}
+
+		/** @brief The histograms of the running threads plus those of the threads that exited*/
+		typedef ThreadRegistry<ThreadHistograms, std::map<string, LatencyHistogram>, retireHistograms> Registry;
+
+		Registry &registry()
+		{
+			return Registry::instance();
+		}
+
+		thread_local Registry::Slot threadHistograms;
+
+		/** appends the first @p depth fields of @p path*/
+		void appendPrefix(string &name, const string &path, unsigned depth)
+		{
+			static const char TOKENS[] = { NUMBER_TOKEN, STRING_TOKEN, '\0' };
+			// the field after the last one kept starts at end
+			string::size_type end = 0;
+			for (unsigned fields = 0; end != string::npos && fields < depth; ++fields)
+				end = path.find_first_of(TOKENS, end + 1);
+			name.append(path, 0, end);
+		}
+	}
+
+	LatencyHistogram::LatencyHistogram()
+		: total(0), sum(0), minValue(0), maxValue(0)
+	{
+
+	}
+
+	std::size_t LatencyHistogram::bucketIndex(uint64_t ns)
+	{
+		if (ns < EXACT_LIMIT)
+			return (std::size_t)ns;
+		unsigned shift = highestBit(ns) - SUB_BUCKET_BITS;
+		return (std::size_t)((shift + 1) * SUB_BUCKETS + ((ns >> shift) - SUB_BUCKETS));
+	}
+
+	uint64_t LatencyHistogram::bucketLimit(std::size_t index)
+	{
+		if (index < EXACT_LIMIT)
+			return index;
+		unsigned shift = (unsigned)(index / SUB_BUCKETS) - 1;
+		uint64_t lowest = (index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+		return lowest + ((uint64_t)1 << shift) - 1;
+	}
+
+	void LatencyHistogram::record(uint64_t ns)
+	{
+		if (ns > MAX_VALUE)
+			ns = MAX_VALUE;
+		if (buckets.empty())
+			buckets.resize(BUCKET_COUNT);
+		++buckets[bucketIndex(ns)];
+		minValue = total == 0 || ns < minValue ? ns : minValue;
+		maxValue = ns > maxValue ? ns : maxValue;
+		++total;
+		sum += ns;
+	}
+
+	void LatencyHistogram::merge(const LatencyHistogram &other)
+	{
+		if (other.total == 0)
+			return;
+		if (buckets.empty())
+			buckets.resize(BUCKET_COUNT);
+		for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+			buckets[i] += other.buckets[i];
+		minValue = total == 0 || other.minValue < minValue ? other.minValue : minValue;
+		maxValue = other.maxValue > maxValue ? other.maxValue : maxValue;
+		total += other.total;
+		sum += other.sum;
+	}
+
+	uint64_t LatencyHistogram::count() const
+	{
+		return total;
+	}
+
+	uint64_t LatencyHistogram::min() const
+	{
+		return minValue;
+	}
+
+	uint64_t LatencyHistogram::max() const
+	{
+		return maxValue;
+	}
+
+	double LatencyHistogram::mean() const
+	{
+		return total ? (double)sum / total : 0.0;
+	}
+
+	uint64_t LatencyHistogram::percentile(double percentile) const
+	{
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t)(percentile / 100.0 * total + 0.5);
+		rank = rank < 1 ? 1 : rank > total ? total : rank;
+		uint64_t seen = 0;
+		for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += buckets[i];
+			if (seen >= rank)
+			{
+				uint64_t limit = bucketLimit(i);
+				return limit < maxValue ? limit : maxValue;
+			}
+		}
+		return maxValue;
+	}
+
+	void LatencyHistogram::clear()
+	{
+		buckets.clear();
+		total = sum = minValue = maxValue = 0;
+	}
+
+	LookupSite::LookupSite(const char *label)
+		: previous(currentSite)
+	{
+		currentSite = label;
+	}
+
+	LookupSite::~LookupSite()
+	{
+		currentSite = previous;
+	}
+
+	void enableLatencyHistograms(bool enabled)
+	{
+		latencySwitch.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool latencyHistogramsEnabled()
+	{
+		return latencySwitch.load(std::memory_order_relaxed);
+	}
+
+	void setLatencyPrefixDepth(unsigned fields)
+	{
+		prefixDepth.store(fields, std::memory_order_relaxed);
+	}
+
+	void recordLookupLatency(const char *operation, const string &scope, const string &path, uint64_t ns)
+	{
+		ThreadHistograms &histograms = threadHistograms.local;
+		string &name = histograms.name;
+		if (currentSite)
+			name.assign(currentSite);
+		else
+		{
+			name.assign(operation).append(1, ' ').append(scope);
+			appendPrefix(name, path, prefixDepth.load(std::memory_order_relaxed));
+		}
+
+		std::lock_guard<std::mutex> lock(histograms.mutex);
+		std::map<string, LatencyHistogram>::iterator site = histograms.sites.find(name);
+		if (site == histograms.sites.end())
+			site = histograms.sites.insert(std::make_pair(name, LatencyHistogram())).first;
+		site->second.record(ns);
+	}
+
+	std::map<string, LatencyHistogram> latencyHistograms()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		std::map<string, LatencyHistogram> merged(reg.retired);
+		for (ThreadHistograms *thread : reg.threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mutex);
+			mergeInto(merged, thread->sites);
+		}
+		return merged;
+	}
+
+	void writeLatencyReport(std::ostream &out)
+	{
+		std::map<string, LatencyHistogram> sites = latencyHistograms();
+		std::size_t width = 4;
+		for (std::map<string, LatencyHistogram>::const_iterator it = sites.begin(); it != sites.end(); ++it)
+			width = it->first.size() > width ? it->first.size() : width;
+
+		out << std::left << std::setw((int)width) << "site" << std::right << std::setw(12) << "count"
+			<< std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::setw(12) << "p99.9 ns" << std::setw(12) << "max ns" << '\n';
+		for (std::map<string, LatencyHistogram>::const_iterator it = sites.begin(); it != sites.end(); ++it)
+		{
+			const LatencyHistogram &histogram = it->second;
+			out << std::left << std::setw((int)width) << it->first << std::right << std::setw(12) << histogram.count()
+				<< std::setw(12) << histogram.percentile(50) << std::setw(12) << histogram.percentile(99)
+				<< std::setw(12) << histogram.percentile(99.9) << std::setw(12) << histogram.max() << '\n';
+		}
+	}
+
+	void resetLatencyHistograms()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.retired.clear();
+		for (ThreadHistograms *thread : reg.threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mutex);
+			thread->sites.clear();
+		}
+	}
+
+}
@@ -0,0 +1,57 @@
+#ifndef LOOKUPLATENCY_HPP
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace luapath
+{
+	/** set by luapath::enableLatencyHistograms. Read on every lookup*/
+	extern std::atomic<bool> latencySwitch;
+
+	/** adds @p ns to the histogram of the current LookupSite or of the prefix of @p path*/
+	void recordLookupLatency(const char *operation, const std::string &scope, const std::string &path, std::uint64_t ns);
+
+	/** @brief Records the duration of the lookup it is declared in. Internal to the library
+		@details The clock is not read if latency histograms are disabled. All arguments must outlive the timer.
+	*/
+	class LookupTimer
+	{
+	public:
+		LookupTimer(const char *operation, const std::string &scope, const std::string &path)
+			: operation(operation), scope(scope), path(path), running(latencySwitch.load(std::memory_order_relaxed))
+		{
+			if (running)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~LookupTimer()
+		{
+			if (!running)
+				return;
+			std::uint64_t ns = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			try
+			{
+				recordLookupLatency(operation, scope, path, ns);
+			}
+			catch (...)
+			{
+				// may run while a path_lookup_exception is thrown. Losing a sample is better than terminating
+			}
+		}
+
+	private:
+		LookupTimer(const LookupTimer &);
+		LookupTimer& operator=(const LookupTimer &);
+
+		const char *operation;
+		const std::string &scope;
+		const std::string &path;
+		bool running;
+		std::chrono::steady_clock::time_point start;
+	};
+}
+#endif // !LOOKUPLATENCY_HPP
@@ -1,22 +1,121 @@
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
 
 #include "luapath/LuaState.hpp"
 #include "luapath/LuaTypes.hpp"
+#include "luapath/TableVisitor.hpp"
+#include "luapath/ScriptProfiler.hpp"
+#include "luapath/Trace.hpp"
 #include "luapath/exceptions.hpp"
-
+#include "Encoder.hpp"
+#include "LookupLatency.hpp"
+#include "SearchPath.hpp"
+#include "StatCounters.hpp"
 
 #include <lua.hpp>
 
-using std::cout;
-using std::endl;
-using std::setw;
+#ifdef LUAPATH_LUA_INTERNALS
+// not part of the lua API but exported by the static bundled lua
+extern "C" void luaS_resize(lua_State *L, int newsize);
+#endif
+
 using std::string;
 
 namespace luapath{
 
+namespace
+{
+	/** the address is the registry key under which a LuaState stores itself while a script runs*/
+	const char RUNNING_STATE_KEY = 0;
+
+	/** deeper tables are taken for cycles by the visits and exports, well below what overflows the C stack*/
+	const int MAX_TABLE_DEPTH = 1000;
+
+	/** how often the budgets are checked, in lua instructions*/
+	const int BUDGET_CHECK_INTERVAL = 1000;
+
+	/** average bytes of config source per distinct string, measured on the generated corpora*/
+	const std::size_t SOURCE_BYTES_PER_STRING = 64;
+
+	/** the largest string table LoadOptions::expectedSourceBytes asks for*/
+	const std::size_t MAX_STRING_TABLE_SLOTS = 1 << 24;
+
+	/** pushes the field @p key of the table at @p parent without calling metamethods*/
+	void rawGetField(lua_State *L, int parent, const Key &key)
+	{
+		if (key.type == Key::Type::NUMBER)
+			lua_rawgeti(L, parent, keyNumber(key.key));
+		else
+		{
+			lua_pushlstring(L, key.key.data(), key.key.size());
+			lua_rawget(L, parent);
+		}
+	}
+
+	/** sets the field @p key of the table at @p parent to the value on top of the stack and pops it*/
+	void rawSetField(lua_State *L, int parent, const Key &key)
+	{
+		if (key.type == Key::Type::NUMBER)
+			lua_rawseti(L, parent, keyNumber(key.key));
+		else
+		{
+			lua_pushlstring(L, key.key.data(), key.key.size());
+			lua_insert(L, -2);
+			lua_rawset(L, parent);
+		}
+	}
+
+	void pushValue(lua_State *L, const Value &value)
+	{
+		switch (value.type)
+		{
+		case Value::Type::STRING:
+			lua_pushlstring(L, value.value.data(), value.value.size());
+			break;
+		case Value::Type::NUMBER:
+			lua_pushnumber(L, (lua_Number)(double)value);
+			break;
+		case Value::Type::BOOL:
+			lua_pushboolean(L, (bool)value ? 1 : 0);
+			break;
+		case Value::Type::TABLE:
+			lua_pushnil(L);
+			break;
+		}
+	}
+
+	std::uint64_t steadyNowNs()
+	{
+		return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+struct LuaState::RunningLoad
+{
+	const LoadOptions &options;
+	/** instructions between two calls of the hook*/
+	int hookInterval;
+	/** instructions run so far, counted in steps of hookInterval*/
+	std::uint64_t executed;
+	/** the profiler takes the next sample once executed reaches it*/
+	std::uint64_t nextSample;
+	/** end of the time budget on the clock of steadyNowNs*/
+	std::uint64_t deadlineNs;
+	/** the budget that ran out or null*/
+	const char *exceeded;
+};
+
+LoadOptions::LoadOptions()
+	: profiler(nullptr), instructionBudget(0), timeBudgetMs(0),
+	gcPolicy(GcPolicy::INCREMENTAL), gcPause(0), expectedSourceBytes(0)
+{
+
+}
 
 LuaState::LuaState()
-	:m_L(luaL_newstate()), loaded(false)
+	:m_L(luaL_newstate()), loaded(false), running(nullptr)
 {
 }
 
@@ -36,27 +135,193 @@ void LuaState::close()
 
 void LuaState::loadString(const std::string& str)
 {
-	int err = luaL_dostring(m_L, str.c_str());
-	if (err)
+	loadString(str, LoadOptions());
+}
+
+void LuaState::loadFile(const string& filepath)
+{
+	loadFile(filepath, LoadOptions());
+}
+
+void LuaState::loadString(const std::string& str, const LoadOptions &options)
+{
+	LUAPATH_TRACE_ZONE("LuaState::loadString");
+	std::uint64_t startNs = steadyNowNs();
+	int previousPause = prepareCollector(options);
+	int err;
 	{
-		string errorStr(lua_tostring(m_L, -1));
-		close();
-		throw lua_state_exception(errorStr);
+		LUAPATH_TRACE_ZONE("parse");
+		StatTimer parse(StatCounter::PARSE_NS);
+		err = luaL_loadstring(m_L, str.c_str());
 	}
-	loaded = true;
+	execute(err, options, startNs, previousPause);
 }
 
-void LuaState::loadFile(const string& filepath)
+void LuaState::loadFile(const string& filepath, const LoadOptions &options)
+{
+	LUAPATH_TRACE_ZONE_DETAIL("LuaState::loadFile", filepath);
+	std::uint64_t startNs = steadyNowNs();
+	int previousPause = prepareCollector(options);
+	int err;
+	{
+		LUAPATH_TRACE_ZONE("parse");
+		StatTimer parse(StatCounter::PARSE_NS);
+		err = luaL_loadfile(m_L, filepath.c_str());
+	}
+	execute(err, options, startNs, previousPause);
+}
+
+int LuaState::prepareCollector(const LoadOptions &options)
+{
+	int previousPause = 0;
+	switch (options.gcPolicy)
+	{
+	case GcPolicy::INCREMENTAL:
+		break;
+	case GcPolicy::STOPPED:
+		lua_gc(m_L, LUA_GCSTOP, 0);
+		break;
+	case GcPolicy::GENERATIONAL:
+		lua_gc(m_L, LUA_GCGEN, 0);
+		break;
+	}
+	if (options.gcPause > 0 && options.gcPolicy != GcPolicy::STOPPED)
+		previousPause = lua_gc(m_L, LUA_GCSETPAUSE, options.gcPause);
+	if (options.gcPolicy != GcPolicy::INCREMENTAL || previousPause)
+		countStat(StatCounter::GC_TUNED_LOADS);
+
+#ifdef LUAPATH_LUA_INTERNALS
+	if (options.expectedSourceBytes)
+	{
+		// the table grows by doubling once it holds as many strings as it has slots
+		std::size_t wanted = std::min(options.expectedSourceBytes / SOURCE_BYTES_PER_STRING, MAX_STRING_TABLE_SLOTS);
+		std::size_t slots = 1;
+		while (slots < wanted)
+			slots <<= 1;
+		if (slots > 1)
+		{
+			luaS_resize(m_L, (int)slots);
+			countStat(StatCounter::STRING_TABLE_SLOTS, slots);
+		}
+	}
+#endif
+	return previousPause;
+}
+
+void LuaState::restoreCollector(const LoadOptions &options, int previousPause)
+{
+	if (previousPause)
+		lua_gc(m_L, LUA_GCSETPAUSE, previousPause);
+	switch (options.gcPolicy)
+	{
+	case GcPolicy::INCREMENTAL:
+		break;
+	case GcPolicy::STOPPED:
+		lua_gc(m_L, LUA_GCRESTART, 0);
+		break;
+	case GcPolicy::GENERATIONAL:
+		lua_gc(m_L, LUA_GCINC, 0);
+		break;
+	}
+}
+
+void LuaState::execute(int loadError, const LoadOptions &options, std::uint64_t startNs, int previousPause)
 {
-	int err = luaL_dofile(m_L, filepath.c_str());
+	// same as luaL_dostring and luaL_dofile but the compile and the run are timed separately
+	int err = loadError;
+	RunningLoad load = { options, 0, 0, 0, startNs + options.timeBudgetMs * 1000000, nullptr };
+	if (!err && options.timeBudgetMs && steadyNowNs() >= load.deadlineNs)
+	{
+		// the time budget already ran out while compiling
+		load.exceeded = "time";
+		lua_pushstring(m_L, "time budget exceeded while compiling");
+		err = LUA_ERRRUN;
+	}
+	if (!err)
+	{
+		LUAPATH_TRACE_ZONE("execute");
+		StatTimer run(StatCounter::EXECUTE_NS);
+		int interval = 0;
+		if (options.profiler)
+			interval = options.profiler->instructionInterval();
+		if (options.instructionBudget || options.timeBudgetMs)
+		{
+			int budgetInterval = (int)std::min<std::uint64_t>(BUDGET_CHECK_INTERVAL,
+				options.instructionBudget ? options.instructionBudget : BUDGET_CHECK_INTERVAL);
+			interval = interval ? std::min(interval, budgetInterval) : budgetInterval;
+		}
+		if (interval)
+		{
+			load.hookInterval = interval;
+			load.nextSample = options.profiler ? (std::uint64_t)options.profiler->instructionInterval() : 0;
+			running = &load;
+			lua_pushlightuserdata(m_L, this);
+			lua_rawsetp(m_L, LUA_REGISTRYINDEX, &RUNNING_STATE_KEY);
+			lua_sethook(m_L, &LuaState::dispatchHook, LUA_MASKCOUNT, interval);
+		}
+		err = lua_pcall(m_L, 0, LUA_MULTRET, 0);
+		if (running)
+		{
+			lua_sethook(m_L, nullptr, 0, 0);
+			lua_pushnil(m_L);
+			lua_rawsetp(m_L, LUA_REGISTRYINDEX, &RUNNING_STATE_KEY);
+			running = nullptr;
+		}
+	}
+	countStat(StatCounter::LOADS);
 	if (err)
 	{
+		countStat(StatCounter::LOAD_FAILURES);
 		string errorStr(lua_tostring(m_L, -1));
 		close();
+		if (load.exceeded)
+			throw budget_exceeded_exception(errorStr);
 		throw lua_state_exception(errorStr);
 	}
+	restoreCollector(options, previousPause);
+	countStat(StatCounter::LOAD_HEAP_BYTES, heapSize());
 	loaded = true;
+}
+
+void LuaState::dispatchHook(lua_State *L, lua_Debug *ar)
+{
+	(void)ar;
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &RUNNING_STATE_KEY);
+	LuaState *state = static_cast<LuaState*>(lua_touserdata(L, -1));
+	lua_pop(L, 1);
+	if (!state || !state->running)
+		return;
 
+	RunningLoad &load = *state->running;
+	const LoadOptions &options = load.options;
+	load.executed += load.hookInterval;
+	if (options.profiler && load.executed >= load.nextSample)
+	{
+		load.nextSample += options.profiler->instructionInterval();
+		try
+		{
+			options.profiler->sample(L);
+		}
+		catch (...)
+		{
+			// nothing may be thrown through the lua interpreter. A lost sample is not worth failing the load for
+		}
+	}
+
+	if (!load.exceeded)
+	{
+		if (options.instructionBudget && load.executed >= options.instructionBudget)
+			load.exceeded = "instruction";
+		else if (options.timeBudgetMs && steadyNowNs() >= load.deadlineNs)
+			load.exceeded = "time";
+		if (!load.exceeded)
+			return;
+		// from now on fail every instruction so that a script catching the error with pcall can't carry on
+		load.hookInterval = 1;
+		lua_sethook(L, &LuaState::dispatchHook, LUA_MASKCOUNT, 1);
+	}
+	// luaL_error doesn't return. Nothing with a destructor may be alive here
+	luaL_error(L, "%s budget exceeded", load.exceeded);
 }
 
 bool LuaState::isLoaded() const
@@ -64,72 +329,388 @@ bool LuaState::isLoaded() const
 	return loaded;
 }
 
+std::size_t LuaState::heapSize() const
+{
+	if (!m_L)
+		return 0;
+	return (std::size_t)lua_gc(m_L, LUA_GCCOUNT, 0) * 1024 + (std::size_t)lua_gc(m_L, LUA_GCCOUNTB, 0);
+}
+
+void LuaState::collectGarbage()
+{
+	if (m_L)
+		lua_gc(m_L, LUA_GCCOLLECT, 0);
+}
+
 Value LuaState::getGlobalValue(const string &fieldName) 
 {
+	static const string globalScope;
+	LookupTimer timer("getGlobalValue", globalScope, fieldName);
+	countStat(StatCounter::LOOKUPS);
 	lua_getglobal(m_L, fieldName.c_str());
 	int t = lua_type(m_L, -1);
-	switch (t)
+	if (t == LUA_TNIL)
 	{
-	case LUA_TSTRING:
-		return Value(Value::Type::STRING, lua_tostring(m_L, -1));
-	case LUA_TBOOLEAN:
-		return Value(Value::Type::BOOL, lua_toboolean(m_L, -1) ? true : false);
-	case LUA_TNUMBER:
-		return Value(Value::Type::NUMBER, (float)lua_tonumber(m_L, -1));
-	case LUA_TNIL:
+		lua_pop(m_L, 1);
+		countStat(StatCounter::LOOKUP_MISSES);
 		throw path_lookup_exception(string("The search field - ").append(fieldName).append(" - could not be found"));
-	default:
+	}
+	if (!isLeafType(t))
+	{
+		lua_pop(m_L, 1);
+		countStat(StatCounter::CONVERSION_FAILURES);
 		throw type_mismatch_exception("The type of the result value is not one of : string, number or boolean");
 	}
-	
+	// pop the global once it is copied so repeated lookups don't grow the stack
+	Value value = getValue(-1);
+	lua_pop(m_L, 1);
+	return value;
+}
+
+LookupStatus LuaState::tryGetGlobalValue(const string &fieldName, Value &value)
+{
+	static const string globalScope;
+	LookupTimer timer("tryGetGlobalValue", globalScope, fieldName);
+	countStat(StatCounter::LOOKUPS);
+	lua_getglobal(m_L, fieldName.c_str());
+	int t = lua_type(m_L, -1);
+	LookupStatus status = LookupStatus::FOUND;
+	if (t == LUA_TNIL)
+		status = LookupStatus::NOT_FOUND;
+	else if (!isLeafType(t))
+		status = LookupStatus::NOT_A_VALUE;
+	else
+		value = getValue(-1);
+	lua_pop(m_L, 1);
+	if (status != LookupStatus::FOUND)
+		countStat(StatCounter::LOOKUP_MISSES);
+	return status;
 }
 
 Table LuaState::getGlobalTable(const string &tableName) 
 {
+	LUAPATH_TRACE_ZONE_DETAIL("LuaState::getGlobalTable", tableName);
 	lua_getglobal(m_L, tableName.c_str());
 	int t = lua_type(m_L, -1);
 	switch (t)
 	{
 	case LUA_TTABLE:{
-		Key key(tableName);
-		Table root(key);
-		getTableContents(root, -1);
+		StatTimer timer(StatCounter::SNAPSHOT_NS);
+		Table root((Key(tableName)));
+		try
+		{
+			getTableContents(root, -1, 0);
+		}
+		catch (...)
+		{
+			lua_pop(m_L, 1);
+			throw;
+		}
+		lua_pop(m_L, 1);
+		timer.stop();
+		countStat(StatCounter::SNAPSHOTS);
+		// walking the snapshot again is only worth it when somebody is looking
+		if (statsSwitch.load(std::memory_order_relaxed))
+			countStat(StatCounter::SNAPSHOT_BYTES, root.footprint().totalBytes());
 		return root;
 	}
 	case LUA_TNIL:
+		lua_pop(m_L, 1);
 		throw path_lookup_exception(string("The search field - ").append(tableName).append(" - could not be found"));
 	default:
+		lua_pop(m_L, 1);
+		throw type_mismatch_exception("The type of the result value is not a table");
+	}
+
+}
+
+Table LuaState::getGlobals()
+{
+	LUAPATH_TRACE_ZONE("LuaState::getGlobals");
+	StatTimer timer(StatCounter::SNAPSHOT_NS);
+	Table globals;
+	lua_rawgeti(m_L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+	try
+	{
+		getTableContents(globals, -1, 0);
+	}
+	catch (...)
+	{
+		lua_pop(m_L, 1);
+		throw;
+	}
+	lua_pop(m_L, 1);
+	timer.stop();
+	countStat(StatCounter::SNAPSHOTS);
+	if (statsSwitch.load(std::memory_order_relaxed))
+		countStat(StatCounter::SNAPSHOT_BYTES, globals.footprint().totalBytes());
+	return globals;
+}
+
+void LuaState::visitGlobalTable(const string &tableName, TableVisitor &visitor)
+{
+	int top = lua_gettop(m_L);
+	lua_getglobal(m_L, tableName.c_str());
+	int t = lua_type(m_L, -1);
+	if (t != LUA_TTABLE)
+	{
+		lua_settop(m_L, top);
+		if (t == LUA_TNIL)
+			throw path_lookup_exception(string("The search field - ").append(tableName).append(" - could not be found"));
 		throw type_mismatch_exception("The type of the result value is not a table");
 	}
 
+	KeyRef root = { Key::Type::STRING, tableName.data(), tableName.size(), 0 };
+	try
+	{
+		visitor.onEnterTable(root);
+		visitTableContents(visitor, 0);
+		visitor.onExitTable();
+	}
+	catch (...)
+	{
+		// leave the stack as we found it whatever the visitor throws
+		lua_settop(m_L, top);
+		throw;
+	}
+	lua_settop(m_L, top);
 }
 
-void LuaState::getTableContents(Table &currTable, int tableIndex)
+void LuaState::visitTableContents(TableVisitor &visitor, int depth)
 {
+	if (depth > MAX_TABLE_DEPTH)
+		throw lua_state_exception("Lua tables nested too deeply to visit, does a table contain itself?");
+	if (!lua_checkstack(m_L, 3))
+		throw lua_state_exception("Lua stack overflow while visiting a nested table");
+
 	lua_pushnil(m_L);
-	tableIndex--;
+	while (lua_next(m_L, -2) != 0)
+	{
+		KeyRef key;
+		if (getKeyRef(-2, key))
+		{
+			ValueRef value = { Value::Type::STRING, nullptr, 0, 0.0, false };
+			switch (lua_type(m_L, -1))
+			{
+			case LUA_TTABLE:
+				visitor.onEnterTable(key);
+				visitTableContents(visitor, depth + 1);
+				visitor.onExitTable();
+				break;
+			case LUA_TSTRING:
+				value.data = lua_tolstring(m_L, -1, &value.length);
+				visitor.onLeaf(key, value);
+				break;
+			case LUA_TNUMBER:
+				value.type = Value::Type::NUMBER;
+				value.number = lua_tonumber(m_L, -1);
+				visitor.onLeaf(key, value);
+				break;
+			case LUA_TBOOLEAN:
+				value.type = Value::Type::BOOL;
+				value.boolean = lua_toboolean(m_L, -1) ? true : false;
+				visitor.onLeaf(key, value);
+				break;
+			default:
+				break;
+			}
+		}
+		lua_pop(m_L, 1);
+	}
+}
+
+void LuaState::encodeGlobalTable(const string &tableName, Encoder &encoder)
+{
+	int top = lua_gettop(m_L);
+	lua_getglobal(m_L, tableName.c_str());
+	int t = lua_type(m_L, -1);
+	if (t != LUA_TTABLE)
+	{
+		lua_settop(m_L, top);
+		if (t == LUA_TNIL)
+			throw path_lookup_exception(string("The search field - ").append(tableName).append(" - could not be found"));
+		throw type_mismatch_exception("The type of the result value is not a table");
+	}
 	try
 	{
-	while (lua_next(m_L, tableIndex) != 0)
+		encodeTableContents(encoder, 0);
+	}
+	catch (...)
 	{
-		Key key = getKey(-2);
-		Value value = getValue(-1);
-		if (value.type == Value::Type::TABLE)
+		lua_settop(m_L, top);
+		throw;
+	}
+	lua_settop(m_L, top);
+}
+
+void LuaState::encodeTableContents(Encoder &encoder, int depth)
+{
+	if (depth > MAX_TABLE_DEPTH)
+		throw lua_state_exception("Lua tables nested too deeply to export, does a table contain itself?");
+	if (!lua_checkstack(m_L, 3))
+		throw lua_state_exception("Lua stack overflow while exporting a nested table");
+
+	// count the fields first as the encoders need the size and whether the table is an array up front
+	std::size_t count = 0;
+	bool array = true;
+	lua_Number largest = 0;
+	lua_pushnil(m_L);
+	while (lua_next(m_L, -2) != 0)
+	{
+		int keyType = lua_type(m_L, -2);
+		int valueType = lua_type(m_L, -1);
+		if (isKeyType(keyType) && (valueType == LUA_TTABLE || isLeafType(valueType)))
 		{
-			currTable.nestedSet.emplace(std::make_pair(key, Table(key)));
-			getTableContents(currTable.nestedSet.at(key), -1);
+			++count;
+			lua_Number number = keyType == LUA_TNUMBER ? lua_tonumber(m_L, -2) : 0;
+			// the integers are distinct so they are 1 to count iff all are at least 1 and the largest is count
+			array = array && keyType == LUA_TNUMBER && number >= 1 && number == (lua_Number)(lua_Integer)number;
+			largest = number > largest ? number : largest;
 		}
-		else
+		lua_pop(m_L, 1);
+	}
+	array = array && count > 0 && largest == (lua_Number)count;
+
+	if (array)
+	{
+		encoder.beginArray(count);
+		for (std::size_t i = 1; i <= count; ++i)
+		{
+			lua_rawgeti(m_L, -1, (int)i);
+			encodeValue(encoder, depth);
+			lua_pop(m_L, 1);
+		}
+		encoder.endArray();
+		return;
+	}
+
+	encoder.beginObject(count);
+	lua_pushnil(m_L);
+	while (lua_next(m_L, -2) != 0)
+	{
+		KeyRef key;
+		int valueType = lua_type(m_L, -1);
+		if ((valueType == LUA_TTABLE || isLeafType(valueType)) && getKeyRef(-2, key))
 		{
-			currTable.leafSet.emplace(std::make_pair(key, value));
+			if (key.type == Key::Type::NUMBER)
+				encoder.key(key.index);
+			else
+				encoder.key(key.data, key.length);
+			encodeValue(encoder, depth);
 		}
 		lua_pop(m_L, 1);
 	}
+	encoder.endObject();
+}
+
+void LuaState::encodeValue(Encoder &encoder, int depth)
+{
+	switch (lua_type(m_L, -1))
+	{
+	case LUA_TTABLE:
+		encodeTableContents(encoder, depth + 1);
+		break;
+	case LUA_TSTRING:{
+		std::size_t length;
+		const char *data = lua_tolstring(m_L, -1, &length);
+		encoder.str(data, length);
+		break;
+	}
+	case LUA_TNUMBER:
+		encoder.number((double)lua_tonumber(m_L, -1), nullptr, 0);
+		break;
+	case LUA_TBOOLEAN:
+		encoder.boolean(lua_toboolean(m_L, -1) ? true : false);
+		break;
+	}
+}
+
+bool LuaState::getKeyRef(int index, KeyRef &key)
+{
+	switch (lua_type(m_L, index))
+	{
+	case LUA_TSTRING:
+		key.type = Key::Type::STRING;
+		key.data = lua_tolstring(m_L, index, &key.length);
+		key.index = 0;
+		return true;
+	case LUA_TNUMBER:
+		// lua_tolstring would convert the key in place and confuse lua_next
+		key.type = Key::Type::NUMBER;
+		key.data = nullptr;
+		key.length = 0;
+		key.index = (int)lua_tointeger(m_L, index);
+		return true;
+	default:
+		return false;
 	}
-	catch (std::exception &e){
-		cout << "error: " << e.what() << endl;
+}
+
+void LuaState::getTableContents(Table &currTable, int tableIndex, int depth)
+{
+	// one zone per nested table so the timeline shows the recursion
+	LUAPATH_TRACE_ZONE_DETAIL("LuaState::getTableContents", currTable.tableKey.key);
+	if (depth > MAX_TABLE_DEPTH)
+		throw lua_state_exception("Lua tables nested too deeply to read, does a table contain itself?");
+	if (!lua_checkstack(m_L, 3))
+		throw lua_state_exception("Lua stack overflow while reading a nested table");
+	// the key pushed by lua_pushnil shifts the relative index
+	if (tableIndex < 0)
+		tableIndex--;
+
+	// count the fields first so that each set is allocated exactly once
+	std::size_t leafCount = 0;
+	std::size_t nestedCount = 0;
+	lua_pushnil(m_L);
+	while (lua_next(m_L, tableIndex) != 0)
+	{
+		if (isKeyType(lua_type(m_L, -2)))
+		{
+			int valueType = lua_type(m_L, -1);
+			if (valueType == LUA_TTABLE)
+				++nestedCount;
+			else if (isLeafType(valueType))
+				++leafCount;
+		}
+		lua_pop(m_L, 1);
 	}
+	currTable.leafSet.reserve(leafCount);
+	currTable.nestedSet.reserve(nestedCount);
+	countStat(StatCounter::SNAPSHOT_NODES, leafCount + nestedCount);
 
+	lua_pushnil(m_L);
+	while (lua_next(m_L, tableIndex) != 0)
+	{
+		int valueType = lua_type(m_L, -1);
+		if (isKeyType(lua_type(m_L, -2)) && (valueType == LUA_TTABLE || isLeafType(valueType)))
+		{
+			Key key = getKey(-2);
+			if (valueType == LUA_TTABLE)
+			{
+				Table nested(key);
+				// the set was reserved so the reference stays valid while the nested table is filled
+				Table &nestedRef = currTable.nestedSet.append(std::move(key), std::move(nested)).second;
+				getTableContents(nestedRef, -1, depth + 1);
+			}
+			else
+			{
+				currTable.leafSet.append(std::move(key), getValue(-1));
+			}
+		}
+		lua_pop(m_L, 1);
+	}
+	currTable.leafSet.sort();
+	currTable.nestedSet.sort();
+}
+
+bool LuaState::isKeyType(int luaType)
+{
+	return luaType == LUA_TSTRING || luaType == LUA_TNUMBER;
+}
+
+bool LuaState::isLeafType(int luaType)
+{
+	return luaType == LUA_TSTRING || luaType == LUA_TNUMBER || luaType == LUA_TBOOLEAN;
 }
 
 Key LuaState::getKey(int index)
@@ -137,10 +718,13 @@ Key LuaState::getKey(int index)
 	int keyType = lua_type(m_L,index);
 	switch (keyType)
 	{
-	case LUA_TSTRING:
-		return Key(lua_tostring(m_L, index));
+	case LUA_TSTRING:{
+		std::size_t length;
+		const char *str = lua_tolstring(m_L, index, &length);
+		return Key(Key::Type::STRING, string(str, length));
+	}
 	case LUA_TNUMBER:
-		return Key(lua_tointeger(m_L, index));
+		return Key((int)lua_tointeger(m_L, index));
 	default:
 		throw type_mismatch_exception("Construction of a Key not possible from a stack value that is not either NUMBER or STRING");
 	}
@@ -151,12 +735,15 @@ Value LuaState::getValue(int index)
 	int valueType = lua_type(m_L, index);
 	switch (valueType)
 	{
-	case LUA_TSTRING:
-		return Value(Value::Type::STRING, lua_tostring(m_L, index));
+	case LUA_TSTRING:{
+		std::size_t length;
+		const char *str = lua_tolstring(m_L, index, &length);
+		return Value(Value::Type::STRING, string(str, length));
+	}
 	case LUA_TBOOLEAN:
-		return Value(Value::Type::BOOL, lua_toboolean(m_L, -1) ? true : false);
+		return Value(Value::Type::BOOL, lua_toboolean(m_L, index) ? true : false);
 	case LUA_TNUMBER:
-		return Value(Value::Type::NUMBER, (float)lua_tonumber(m_L, -1));
+		return Value(Value::Type::NUMBER, (double)lua_tonumber(m_L, index));
 	case LUA_TTABLE:
 		//we still need to represent a table in a Value object because
 		// later it will help with the traversal of the Table object
@@ -167,4 +754,100 @@ Value LuaState::getValue(int index)
 }
 
 
-}
\ No newline at end of file
+TableEdit LuaState::editGlobalTable(const string &tableName)
+{
+	return TableEdit(*this, tableName);
+}
+
+std::size_t LuaState::applyEdit(const TableEdit &edit)
+{
+	LUAPATH_TRACE_ZONE_DETAIL("LuaState::applyEdit", edit.tableName);
+	if (!m_L)
+		throw lua_state_exception("The lua state is closed");
+	const std::vector<TableEdit::Change> &changes = edit.changes;
+	if (edit.tableName.empty())
+		lua_rawgeti(m_L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+	else
+		lua_getglobal(m_L, edit.tableName.c_str());
+	int t = lua_type(m_L, -1);
+	if (t == LUA_TNIL)
+	{
+		lua_pop(m_L, 1);
+		bool sets = false;
+		for (const TableEdit::Change &change : changes)
+			sets = sets || !change.erase;
+		if (!sets)
+			return changes.size();
+		lua_newtable(m_L);
+		lua_pushvalue(m_L, -1);
+		lua_setglobal(m_L, edit.tableName.c_str());
+	}
+	else if (t != LUA_TTABLE)
+	{
+		lua_pop(m_L, 1);
+		throw type_mismatch_exception("The type of the edited global is not a table");
+	}
+	int root = lua_gettop(m_L);
+
+	// the stack holds the edited table followed by the tables of the first openDepth fields of *openPath
+	const std::vector<Key> *openPath = nullptr;
+	std::size_t openDepth = 0;
+	std::size_t applied = 0;
+	for (; applied < changes.size(); ++applied)
+	{
+		const TableEdit::Change &change = changes[applied];
+		std::size_t parents = change.path.size() - 1;
+		std::size_t common = 0;
+		if (openPath)
+		{
+			while (common < openDepth && common < parents && (*openPath)[common] == change.path[common])
+				++common;
+		}
+		lua_settop(m_L, root + (int)common);
+		openPath = &change.path;
+		openDepth = common;
+		if (!lua_checkstack(m_L, (int)(parents - common) + 3))
+		{
+			lua_settop(m_L, root - 1);
+			throw lua_state_exception("Lua stack overflow while editing a nested table");
+		}
+
+		bool reached = true;
+		for (; openDepth < parents; ++openDepth)
+		{
+			int parent = lua_gettop(m_L);
+			const Key &key = change.path[openDepth];
+			rawGetField(m_L, parent, key);
+			int fieldType = lua_type(m_L, -1);
+			if (fieldType == LUA_TTABLE)
+				continue;
+			lua_pop(m_L, 1);
+			if (change.erase)
+			{
+				// nothing to remove below a missing table or a value
+				reached = false;
+				break;
+			}
+			if (fieldType != LUA_TNIL)
+			{
+				lua_settop(m_L, root - 1);
+				return applied;
+			}
+			lua_newtable(m_L);
+			lua_pushvalue(m_L, -1);
+			rawSetField(m_L, parent, key);
+		}
+		if (!reached)
+			continue;
+
+		if (change.erase)
+			lua_pushnil(m_L);
+		else
+			pushValue(m_L, change.value);
+		rawSetField(m_L, lua_gettop(m_L) - 1, change.path.back());
+	}
+	lua_settop(m_L, root - 1);
+	return applied;
+}
+
+}
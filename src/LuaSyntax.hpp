@@ -0,0 +1,51 @@
+#ifndef LUASYNTAX_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+namespace luapath
+{
+	/** true iff @p c can start a lua name. Internal to the library*/
+	inline bool isNameStart(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	/** true iff @p c can be part of a lua name*/
+	inline bool isNameChar(char c)
+	{
+		return isNameStart(c) || (c >= '0' && c <= '9');
+	}
+
+	/** true iff [name, name + length) is a reserved word of lua 5.2*/
+	inline bool isKeyword(const char *name, std::size_t length)
+	{
+		if (length < 2 || length > 8)
+			return false;
+		static const char *const KEYWORDS[] = {
+			"and", "break", "do", "else", "elseif", "end", "false", "for", "function", "goto", "if",
+			"in", "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while"
+		};
+		for (const char *keyword : KEYWORDS)
+		{
+			if (keyword[0] == name[0] && std::strlen(keyword) == length && std::memcmp(keyword, name, length) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	/** true iff [name, name + length) can be written as a name, e.g. a field key without brackets*/
+	inline bool isName(const char *name, std::size_t length)
+	{
+		if (length == 0 || !isNameStart(name[0]))
+			return false;
+		for (std::size_t i = 1; i < length; ++i)
+		{
+			if (!isNameChar(name[i]))
+				return false;
+		}
+		return !isKeyword(name, length);
+	}
+}
+#endif // !LUASYNTAX_HPP
@@ -1,10 +1,20 @@
+#include <algorithm>
+#include <cctype>
+#include <climits>
 #include <iomanip>
 
 #include "luapath/LuaTypes.hpp"
+#include "luapath/TableQuery.hpp"
+#include "luapath/Trace.hpp"
 #include "luapath/exceptions.hpp"
+#include "luapath/AccessProfile.hpp"
+#include "AccessRecorder.hpp"
+#include "LookupLatency.hpp"
+#include "NumberFormat.hpp"
+#include "SearchPath.hpp"
+#include "StatCounters.hpp"
 
 namespace luapath{
-	using std::endl;
 	using std::setw;
 	using std::string;
 	using std::ostream;
@@ -23,6 +33,11 @@ namespace luapath{
 		: type(type), key(key)
 	{
 
+	}
+	Key::Key(Key::Type type, string &&key)
+		: type(type), key(std::move(key))
+	{
+
 	}
 	Key::operator string() const
 	{
@@ -36,6 +51,7 @@ namespace luapath{
 		}
 		catch (std::invalid_argument &e)
 		{
+			countStat(StatCounter::CONVERSION_FAILURES);
 			throw type_mismatch_exception(e.what());
 		}
 	}
@@ -54,7 +70,7 @@ namespace luapath{
 		else if (type == Key::Type::STRING && other.type == Key::Type::NUMBER)
 			return false;
 		if (type == Key::Type::NUMBER)
-			return (int)*this < (int)other;
+			return keyNumber(key) < keyNumber(other.key);
 		return key < other.key;
 	}
 	std::ostream& operator<< (std::ostream& out, const Key &key)
@@ -66,10 +82,20 @@ namespace luapath{
 		return out;
 	}
 
+	Value::Value()
+		: type(Value::Type::STRING)
+	{
+
+	}
 	Value::Value(Value::Type type, const string& val)
 		: type(type), value(type == Value::Type::TABLE ? "->" : val)
 	{
 
+	}
+	Value::Value(Value::Type type, string &&val)
+		: type(type), value(type == Value::Type::TABLE ? string("->") : std::move(val))
+	{
+
 	}
 	Value::Value(Value::Type type, const char *val)
 		: type(type), value(type == Value::Type::TABLE ? "->" : val)
@@ -82,9 +108,16 @@ namespace luapath{
 
 	}
 	Value::Value(Value::Type type, float val)
-		: type(type), value(std::to_string(val))
+		: type(type)
 	{
-
+		char buffer[NUMBER_BUFFER_SIZE];
+		value.assign(buffer, formatNumber(val, buffer));
+	}
+	Value::Value(Value::Type type, double val)
+		: type(type)
+	{
+		char buffer[NUMBER_BUFFER_SIZE];
+		value.assign(buffer, formatNumber(val, buffer));
 	}
 	Value::operator string() const
 	{
@@ -92,33 +125,44 @@ namespace luapath{
 	}
 	Value::operator int() const
 	{
-		try
+		double number = *this;
+		if (!(number > INT_MIN - 1.0 && number < INT_MAX + 1.0))
 		{
-			return std::stoi(value);
-		}
-		catch (std::invalid_argument &e)
-		{
-			throw type_mismatch_exception(e.what());
+			countStat(StatCounter::CONVERSION_FAILURES);
+			throw type_mismatch_exception("number out of the range of int - " + value);
 		}
+		return (int)number;
 	}
 
 	Value::operator float() const
 	{
-		try
-		{
-			return std::stof(value);
-		}
-		catch (std::invalid_argument &e)
+		return (float)(double)*this;
+	}
+
+	Value::operator double() const
+	{
+		// leading whitespace is skipped like std::stod does
+		const char *begin = value.data();
+		const char *end = begin + value.size();
+		while (begin != end && std::isspace((unsigned char)*begin))
+			++begin;
+		double number;
+		if (parseNumber(begin, end, number) == begin)
 		{
-			throw type_mismatch_exception(e.what());
+			countStat(StatCounter::CONVERSION_FAILURES);
+			throw type_mismatch_exception("not a number - " + value);
 		}
+		return number;
 	}
 
 	Value::operator bool() const
 	{
-		return value == "true" ? true :
-			value == "false" ? false :
-			throw type_mismatch_exception("invalid bool argument");
+		if (value == "true")
+			return true;
+		if (value == "false")
+			return false;
+		countStat(StatCounter::CONVERSION_FAILURES);
+		throw type_mismatch_exception("invalid bool argument");
 	}
 	bool Value::operator==(const Value &other) const
 	{
@@ -133,7 +177,7 @@ namespace luapath{
 		if (type == other.type)
 		{
 			if (type == Value::Type::NUMBER)
-				return (float)*this < (float)other;
+				return (double)*this < (double)other;
 			else if (type == Value::Type::BOOL)
 				return (bool)*this < (bool)other;
 		}
@@ -147,10 +191,8 @@ namespace luapath{
 		case Value::Type::STRING:
 			out << "\"" << (string)value << "\"";
 			break;
-		case Value::Type::NUMBER:
-			out << (float)value;
-			break;
 		case Value::Type::BOOL:
+		case Value::Type::NUMBER:
 		case Value::Type::TABLE:
 			out << (string)value;
 			break;
@@ -160,101 +202,514 @@ namespace luapath{
 
 
 
+	Table::Table()
+		: tableKey(string())
+	{
+
+	}
+
 	Table::Table(const Key &tableKey)
 		: tableKey(tableKey)
 	{
 
 	}
 
-	Value Table::getValue(const string &searchPath)
+	namespace
 	{
-		if (searchPath.size() == 0)
-			throw path_lookup_exception("empty search path parameter not allowed for Table::getValue");
-		KeyPath keyPath = tokenizePath(searchPath);
-		const Table *currTable = this;
-		do
+		/** @brief A field of a search path looked up without constructing a Key*/
+		struct KeyView
 		{
-			Key currKey = keyPath.front();
-			keyPath.pop();
-			LeafSet::const_iterator leafIt = currTable->leafSet.find(currKey);
-			
-			if (leafIt != currTable->leafSet.end() && !keyPath.empty())
-				throw path_lookup_exception("Found value but not at the end of the search path");
-			else if (leafIt != currTable->leafSet.end())
-				return leafIt->second;
-			else
+			Key::Type type;
+			const char *data;
+			std::size_t length;
+			int number;
+		};
+
+		/** orders Key and KeyView like Key::operator< does*/
+		struct KeyViewLess
+		{
+			static int compare(const Key &key, const KeyView &view)
 			{
-				NestedSet::const_iterator nestedIt = currTable->nestedSet.find(currKey);
-				if (nestedIt == currTable->nestedSet.end())
-					throw path_lookup_exception("Could not find value at specified key");
-				else
+				if (key.type != view.type)
+					return key.type == Key::Type::NUMBER ? -1 : 1;
+				if (key.type == Key::Type::NUMBER)
 				{
-					currTable = &nestedIt->second;
+					int number = keyNumber(key.key);
+					return number < view.number ? -1 : (number > view.number ? 1 : 0);
 				}
+				return key.key.compare(0, string::npos, view.data, view.length);
 			}
-		} while (!keyPath.empty());
-		throw path_lookup_exception("Exhausted search path but did not find a value");
+
+			bool operator()(const Key &key, const KeyView &view) const { return compare(key, view) < 0; }
+			bool operator()(const KeyView &view, const Key &key) const { return compare(key, view) > 0; }
+		};
+
+		/** the number stored in @p value if it is a NUMBER*/
+		bool numberOf(const Value *value, double &number)
+		{
+			if (!value || value->type != Value::Type::NUMBER)
+				return false;
+			const char *begin = value->value.data();
+			return parseNumber(begin, begin + value->value.size(), number) != begin;
+		}
+	}
+
+	const char *toString(LookupStatus status)
+	{
+		switch (status)
+		{
+		case LookupStatus::FOUND: return "FOUND";
+		case LookupStatus::EMPTY_PATH: return "EMPTY_PATH";
+		case LookupStatus::INVALID_PATH: return "INVALID_PATH";
+		case LookupStatus::NOT_FOUND: return "NOT_FOUND";
+		case LookupStatus::NOT_A_TABLE: return "NOT_A_TABLE";
+		case LookupStatus::NOT_A_VALUE: return "NOT_A_VALUE";
+		}
+		return "UNKNOWN";
 	}
 
-	Table Table::getTable(const string &searchPath)
+	LookupResult Table::resolve(const string &searchPath, const Value **value, const Table **table) const
 	{
-		if (searchPath.size() == 0)
-			return *this;
-		KeyPath keyPath = tokenizePath(searchPath);
-		if (keyPath.size() == 0)
-			return *this;
+		LookupResult result = { LookupStatus::FOUND, 0, 0, 0 };
 		const Table *currTable = this;
-		do
+		noteAccess(currTable);
+		const char *begin = searchPath.data();
+		const char *end = begin + searchPath.size();
+		if (begin == end)
 		{
-			Key currKey = keyPath.front();
-			keyPath.pop();
-			
-			NestedSet::const_iterator nestedIt = currTable->nestedSet.find(currKey);
-			if (nestedIt == currTable->nestedSet.end())
-				throw path_lookup_exception("Could not find table at specified key");
+			if (value)
+				result.status = LookupStatus::EMPTY_PATH;
 			else
+				*table = this;
+			return result;
+		}
+
+		const char *segment = begin;
+		while (segment != end)
+		{
+			const char *field = segment + 1;
+			const char *fieldEnd = field;
+			while (fieldEnd != end && !isPathToken(*fieldEnd))
+				++fieldEnd;
+			result.offset = (std::uint32_t)(segment - begin);
+			result.length = (std::uint32_t)(fieldEnd - segment);
+
+			KeyView key = { Key::Type::STRING, field, (std::size_t)(fieldEnd - field), 0 };
+			if (*segment == NUMBER_TOKEN)
+				key.type = Key::Type::NUMBER;
+			if (!isPathToken(*segment) || (key.type == Key::Type::NUMBER && !parseField(field, fieldEnd, key.number)))
 			{
-				currTable = &nestedIt->second;
+				result.status = LookupStatus::INVALID_PATH;
+				return result;
 			}
-		} while (!keyPath.empty());
 
-		return *currTable;
+			LeafSet::const_iterator leafIt = currTable->leafSet.find(key, KeyViewLess());
+			if (leafIt != currTable->leafSet.end())
+			{
+				if (!value || fieldEnd != end)
+				{
+					result.status = LookupStatus::NOT_A_TABLE;
+					return result;
+				}
+				noteAccess(&leafIt->second);
+				*value = &leafIt->second;
+				++result.segment;
+				return result;
+			}
+			NestedSet::const_iterator nestedIt = currTable->nestedSet.find(key, KeyViewLess());
+			if (nestedIt == currTable->nestedSet.end())
+			{
+				result.status = LookupStatus::NOT_FOUND;
+				return result;
+			}
+			currTable = &nestedIt->second;
+			noteAccess(currTable);
+			++result.segment;
+			segment = fieldEnd;
+		}
+
+		if (value)
+		{
+			--result.segment;
+			result.status = LookupStatus::NOT_A_VALUE;
+		}
+		else
+			*table = currTable;
+		return result;
+	}
+
+	path_lookup_exception Table::lookupError(const LookupResult &result, const string &searchPath, bool value)
+	{
+		switch (result.status)
+		{
+		case LookupStatus::EMPTY_PATH:
+			return path_lookup_exception("empty search path parameter not allowed for Table::getValue");
+		case LookupStatus::INVALID_PATH:
+			if (!isPathToken(searchPath[result.offset]))
+				return path_lookup_exception("Invalid starting token character");
+			return path_lookup_exception(string("Number field in the search path is not an integer - ")
+				.append(searchPath, result.offset + 1, result.length - 1));
+		case LookupStatus::NOT_A_TABLE:
+			if (value)
+				return path_lookup_exception("Found value but not at the end of the search path");
+			return path_lookup_exception("Could not find table at specified key");
+		case LookupStatus::NOT_A_VALUE:
+			return path_lookup_exception("Exhausted search path but did not find a value");
+		default:
+			return path_lookup_exception(value ? "Could not find value at specified key" : "Could not find table at specified key");
+		}
+	}
+
+	Value Table::getValue(const string &searchPath) const
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("Table::getValue", searchPath);
+		LookupTimer timer("getValue", tableKey.key, searchPath);
+		countStat(StatCounter::LOOKUPS);
+		const Value *value = nullptr;
+		LookupResult result = resolve(searchPath, &value, nullptr);
+		if (!value)
+		{
+			countStat(StatCounter::LOOKUP_MISSES);
+			throw lookupError(result, searchPath, true);
+		}
+		return *value;
+	}
+
+	bool Table::getValue(const string &searchPath, Value &value) const
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("Table::getValue", searchPath);
+		LookupTimer timer("getValue", tableKey.key, searchPath);
+		countStat(StatCounter::LOOKUPS);
+		const Value *found = nullptr;
+		resolve(searchPath, &found, nullptr);
+		if (!found)
+		{
+			countStat(StatCounter::LOOKUP_MISSES);
+			return false;
+		}
+		value = *found;
+		return true;
+	}
+
+	const Value *Table::tryGetValue(const string &searchPath, LookupResult *result) const
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("Table::tryGetValue", searchPath);
+		LookupTimer timer("tryGetValue", tableKey.key, searchPath);
+		countStat(StatCounter::LOOKUPS);
+		const Value *value = nullptr;
+		LookupResult outcome = resolve(searchPath, &value, nullptr);
+		if (!value)
+			countStat(StatCounter::LOOKUP_MISSES);
+		if (result)
+			*result = outcome;
+		return value;
+	}
+
+	int Table::getOr(const string &searchPath, int fallback) const
+	{
+		double number;
+		if (!numberOf(tryGetValue(searchPath), number) || !(number > INT_MIN - 1.0 && number < INT_MAX + 1.0))
+			return fallback;
+		return (int)number;
+	}
+
+	float Table::getOr(const string &searchPath, float fallback) const
+	{
+		double number;
+		return numberOf(tryGetValue(searchPath), number) ? (float)number : fallback;
+	}
+
+	double Table::getOr(const string &searchPath, double fallback) const
+	{
+		double number;
+		return numberOf(tryGetValue(searchPath), number) ? number : fallback;
+	}
+
+	bool Table::getOr(const string &searchPath, bool fallback) const
+	{
+		const Value *value = tryGetValue(searchPath);
+		if (!value || value->type != Value::Type::BOOL)
+			return fallback;
+		return value->value == "true";
+	}
+
+	const string &Table::getOr(const string &searchPath, const string &fallback) const
+	{
+		const Value *value = tryGetValue(searchPath);
+		return value ? value->value : fallback;
+	}
+
+	const char *Table::getOr(const string &searchPath, const char *fallback) const
+	{
+		const Value *value = tryGetValue(searchPath);
+		return value ? value->value.c_str() : fallback;
+	}
+
+	Table Table::getTable(const string &searchPath) const
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("Table::getTable", searchPath);
+		LookupTimer timer("getTable", tableKey.key, searchPath);
+		countStat(StatCounter::LOOKUPS);
+		const Table *table = nullptr;
+		LookupResult result = resolve(searchPath, nullptr, &table);
+		if (!table)
+		{
+			countStat(StatCounter::LOOKUP_MISSES);
+			throw lookupError(result, searchPath, false);
+		}
+		return *table;
+	}
+
+	bool Table::getTable(const string &searchPath, Table &table) const
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("Table::getTable", searchPath);
+		LookupTimer timer("getTable", tableKey.key, searchPath);
+		countStat(StatCounter::LOOKUPS);
+		const Table *found = nullptr;
+		resolve(searchPath, nullptr, &found);
+		if (!found)
+		{
+			countStat(StatCounter::LOOKUP_MISSES);
+			return false;
+		}
+		table = *found;
+		return true;
+	}
+
+	const Table *Table::tryGetTable(const string &searchPath, LookupResult *result) const
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("Table::tryGetTable", searchPath);
+		LookupTimer timer("tryGetTable", tableKey.key, searchPath);
+		countStat(StatCounter::LOOKUPS);
+		const Table *table = nullptr;
+		LookupResult outcome = resolve(searchPath, nullptr, &table);
+		if (!table)
+			countStat(StatCounter::LOOKUP_MISSES);
+		if (result)
+			*result = outcome;
+		return table;
 	}
-	Table::KeyPath Table::tokenizePath(const std::string &searchPath) const
+
+	bool Table::contains(const string &searchPath) const
 	{
-		KeyPath keyPath;
-		if (searchPath.size() == 0)
-			return keyPath;
-		string::const_iterator currIndex = searchPath.begin();
-		if (!isToken(currIndex))
-			throw path_lookup_exception("Invalid starting token character");
+		const Value *value = nullptr;
+		LookupResult result = resolve(searchPath, &value, nullptr);
+		// a path ending at a table
+		return value != nullptr || result.status == LookupStatus::NOT_A_VALUE;
+	}
 
-		while (currIndex != searchPath.end())
+	Table Table::relayout(const AccessProfile &profile) const
+	{
+		/** a table of the copy that still has to be filled*/
+		struct Pending
 		{
-			// the index of the first character of the field
-			string::const_iterator startIndex = currIndex + 1;
-			char token = *currIndex;
-			//iterate to next token. If we are at the end then this'd be
-			// the last iteration
-			while (++currIndex != searchPath.end() && !isToken(currIndex));
-			
-			string field(startIndex, currIndex);
-			switch (token)
+			const Table *source;
+			Table *target;
+			string path;
+			std::uint64_t visits;
+			/** keeps tables with the same number of visits in the order they were found*/
+			std::size_t order;
+
+			bool operator<(const Pending &other) const
 			{
-			case STRING_TOKEN:
-				keyPath.emplace(Key(field));
-				break;
-			case NUMBER_TOKEN:
-				keyPath.emplace(Key(Key::Type::NUMBER,field));
-				break;
+				return visits != other.visits ? visits < other.visits : order > other.order;
+			}
+		};
+
+		Table copy(tableKey);
+		std::vector<Pending> pending;
+		std::size_t order = 0;
+		Pending root = { this, &copy, string(), profile.count(string()), order++ };
+		pending.push_back(root);
+		// fill the most visited table first so that the storage of the hot tables is allocated together
+		while (!pending.empty())
+		{
+			std::pop_heap(pending.begin(), pending.end());
+			Pending current = pending.back();
+			pending.pop_back();
+
+			// the source is sorted so the copied sets need no FlatMap::sort
+			LeafSet &leaves = current.target->leafSet;
+			leaves.reserve(current.source->leafSet.size());
+			for (const LeafSet::value_type &leaf : current.source->leafSet)
+				leaves.append(leaf.first, leaf.second);
+
+			NestedSet &nested = current.target->nestedSet;
+			nested.reserve(current.source->nestedSet.size());
+			for (const NestedSet::value_type &child : current.source->nestedSet)
+			{
+				// the set was reserved so the reference stays valid until the child is filled
+				Table &target = nested.append(child.first, Table(child.second.tableKey)).second;
+				Pending next = { &child.second, &target, current.path, 0, order++ };
+				next.path += child.first.type == Key::Type::NUMBER ? NUMBER_TOKEN : STRING_TOKEN;
+				next.path += child.first.key;
+				next.visits = profile.count(next.path);
+				pending.push_back(next);
+				std::push_heap(pending.begin(), pending.end());
 			}
 		}
+		return copy;
+	}
 
-		return keyPath;
+	TableQuery Table::query(const string &pattern) const &
+	{
+		return TableQuery(*this, pattern);
 	}
-	bool Table::isToken(string::const_iterator &it) const
+
+	const Key &Table::getKey() const
 	{
-		return (*it == STRING_TOKEN ||*it == NUMBER_TOKEN );
+		return tableKey;
+	}
+
+	Table::LeafRange Table::leaves() const
+	{
+		return LeafRange(leafSet.begin(), leafSet.end());
+	}
+
+	Table::NestedRange Table::tables() const
+	{
+		return NestedRange(nestedSet.begin(), nestedSet.end());
+	}
+
+	Table::EntryRange Table::entries() const
+	{
+		return EntryRange(begin(), end());
+	}
+
+	Table::EntryIterator Table::begin() const
+	{
+		return EntryIterator(leafSet.begin(), leafSet.end(), nestedSet.begin(), nestedSet.end());
+	}
+
+	Table::EntryIterator Table::end() const
+	{
+		return EntryIterator(leafSet.end(), leafSet.end(), nestedSet.end(), nestedSet.end());
+	}
+
+	std::size_t Table::size() const
+	{
+		return leafSet.size() + nestedSet.size();
+	}
+
+	bool Table::empty() const
+	{
+		return leafSet.empty() && nestedSet.empty();
+	}
+
+	bool Table::contains(const Key &key) const
+	{
+		return leafSet.find(key) != leafSet.end() || nestedSet.find(key) != nestedSet.end();
+	}
+
+	namespace
+	{
+		/** Heap bytes owned by @p str. Short strings are stored inside the object itself*/
+		std::size_t heapBytes(const string &str)
+		{
+			const char *data = str.data();
+			const char *object = reinterpret_cast<const char*>(&str);
+			if (data >= object && data < object + sizeof(string))
+				return 0;
+			return str.capacity() + 1;
+		}
+	}
+
+	std::size_t Table::Footprint::totalBytes() const
+	{
+		return sizeof(Table) + leafNodeBytes + nestedTableBytes + keyStringBytes + valueStringBytes;
+	}
+
+	Table::Footprint Table::footprint() const
+	{
+		Footprint footprint = { 0, 0, 0, 0, 0, 0 };
+		addFootprint(footprint);
+		return footprint;
+	}
+
+	void Table::addFootprint(Footprint &footprint) const
+	{
+		++footprint.tables;
+		footprint.keyStringBytes += heapBytes(tableKey.key);
+		footprint.leafNodeBytes += leafSet.capacity() * sizeof(LeafSet::value_type);
+		footprint.nestedTableBytes += nestedSet.capacity() * sizeof(NestedSet::value_type);
+		for (const LeafSet::value_type &leaf : leafSet)
+		{
+			++footprint.leaves;
+			footprint.keyStringBytes += heapBytes(leaf.first.key);
+			footprint.valueStringBytes += heapBytes(leaf.second.value);
+		}
+		for (const NestedSet::value_type &nested : nestedSet)
+		{
+			footprint.keyStringBytes += heapBytes(nested.first.key);
+			nested.second.addFootprint(footprint);
+		}
+	}
+
+	Table::EntryIterator::EntryIterator(LeafSet::const_iterator leafIt, LeafSet::const_iterator leafEnd,
+		NestedSet::const_iterator nestedIt, NestedSet::const_iterator nestedEnd)
+		: leafIt(leafIt), leafEnd(leafEnd), nestedIt(nestedIt), nestedEnd(nestedEnd), atLeaf(false)
+	{
+		select();
+	}
+
+	Table::Entry Table::EntryIterator::operator*() const
+	{
+		if (atLeaf)
+		{
+			Entry entry = { leafIt->first, &leafIt->second, nullptr };
+			return entry;
+		}
+		Entry entry = { nestedIt->first, nullptr, &nestedIt->second };
+		return entry;
+	}
+
+	Table::EntryIterator& Table::EntryIterator::operator++()
+	{
+		if (atLeaf)
+			++leafIt;
+		else
+			++nestedIt;
+		select();
+		return *this;
+	}
+
+	Table::EntryIterator Table::EntryIterator::operator++(int)
+	{
+		EntryIterator previous(*this);
+		++*this;
+		return previous;
+	}
+
+	bool Table::EntryIterator::operator==(const EntryIterator &other) const
+	{
+		return leafIt == other.leafIt && nestedIt == other.nestedIt;
+	}
+
+	bool Table::EntryIterator::operator!=(const EntryIterator &other) const
+	{
+		return !(*this == other);
+	}
+
+	void Table::EntryIterator::select()
+	{
+		// a key can't be both a leaf and a nested table so the order is strict
+		atLeaf = leafIt != leafEnd &&
+			(nestedIt == nestedEnd || leafIt->first < nestedIt->first);
+	}
+
+	bool Table::isNumberField(const string &field)
+	{
+		string::const_iterator digit = field.begin();
+		if (digit != field.end() && *digit == '-')
+			++digit;
+		if (digit == field.end())
+			return false;
+		for (; digit != field.end(); ++digit)
+		{
+			if (*digit < '0' || *digit > '9')
+				return false;
+		}
+		return true;
 	}
 
 	ostream& operator<< (ostream& out, const Table &table)
@@ -265,22 +720,22 @@ namespace luapath{
 
 	void Table::print(ostream &out, const Table& table, int level) const
 	{
-		out << setw(level*INDENT_SIZE) << table.tableKey << " = {" << endl;
+		out << setw(level*INDENT_SIZE) << table.tableKey << " = {\n";
 	
 		if (!table.leafSet.empty())
 		{
 			LeafSet::const_iterator leafIt = table.leafSet.begin();
 			LeafSet::const_iterator leafItEnd = --table.leafSet.end();
 			for (; leafIt != leafItEnd; ++leafIt)
-				out << setw(level*INDENT_SIZE) << "\t" << leafIt->first << " = " << leafIt->second << "," << endl;
-			out << setw(level*INDENT_SIZE) << "\t" << leafIt->first << " = " << leafIt->second << endl;
+				out << setw(level*INDENT_SIZE) << "\t" << leafIt->first << " = " << leafIt->second << ",\n";
+			out << setw(level*INDENT_SIZE) << "\t" << leafIt->first << " = " << leafIt->second << '\n';
 		}
 
 		NestedSet::const_iterator nestedIt = table.nestedSet.begin();
 		for (; nestedIt != table.nestedSet.end(); ++nestedIt)
 			print(out, nestedIt->second, level + 1);
 		
-		out << setw(level*INDENT_SIZE) << "}" << endl;
+		out << setw(level*INDENT_SIZE) << "}" << '\n';
 	}
 
 }
\ No newline at end of file
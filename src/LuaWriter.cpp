@@ -0,0 +1,204 @@
+#include "luapath/LuaWriter.hpp"
+#include "luapath/Trace.hpp"
+#include "LuaSyntax.hpp"
+#include "OutputBuffer.hpp"
+#include "SearchPath.hpp"
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		/** @brief Formats one Table into an OutputBuffer*/
+		class Writer
+		{
+		public:
+			Writer(OutputBuffer &out, WriteStyle style)
+				: out(out), pretty(style == WriteStyle::PRETTY)
+			{
+			}
+
+			/** the chunk for the root @p table*/
+			void writeChunk(const Table &table)
+			{
+				const Key &key = table.getKey();
+				if (key.type == Key::Type::STRING && key.key.empty())
+				{
+					for (Table::Entry entry : table)
+						writeGlobal(entry.key, entry.value, entry.table);
+				}
+				else
+					writeGlobal(key, nullptr, &table);
+			}
+
+		private:
+			void writeGlobal(const Key &key, const Value *value, const Table *table)
+			{
+				if (key.type == Key::Type::STRING && isName(key.key.data(), key.key.size()))
+					out.append(key.key.data(), key.key.size());
+				else
+				{
+					out.append("_ENV");
+					writeBracketKey(key);
+				}
+				writeAssign();
+				if (table)
+					writeTable(*table, 0);
+				else
+					writeValue(*value);
+				out.put('\n');
+			}
+
+			void writeAssign()
+			{
+				if (pretty)
+					out.append(" = ");
+				else
+					out.put('=');
+			}
+
+			void writeBracketKey(const Key &key)
+			{
+				out.put('[');
+				if (key.type == Key::Type::NUMBER)
+					out.append(key.key.data(), key.key.size());
+				else
+					writeString(key.key);
+				out.put(']');
+			}
+
+			void writeTable(const Table &table, std::size_t level)
+			{
+				if (table.empty())
+				{
+					out.append("{}");
+					return;
+				}
+				out.put('{');
+				// the next number key that can be written without its key
+				int sequence = 1;
+				bool first = true;
+				for (Table::Entry entry : table.entries())
+				{
+					const Key &key = entry.key;
+					if (!first && !pretty)
+						out.put(',');
+					first = false;
+					if (pretty)
+					{
+						out.put('\n');
+						out.fill('\t', level + 1);
+					}
+
+					if (key.type == Key::Type::NUMBER && keyNumber(key.key) == sequence)
+						++sequence;
+					else
+					{
+						if (key.type == Key::Type::STRING && isName(key.key.data(), key.key.size()))
+							out.append(key.key.data(), key.key.size());
+						else
+							writeBracketKey(key);
+						writeAssign();
+					}
+
+					if (entry.isTable())
+						writeTable(*entry.table, level + 1);
+					else
+						writeValue(*entry.value);
+					if (pretty)
+						out.put(',');
+				}
+				if (pretty)
+				{
+					out.put('\n');
+					out.fill('\t', level);
+				}
+				out.put('}');
+			}
+
+			void writeValue(const Value &value)
+			{
+				switch (value.type)
+				{
+				case Value::Type::STRING:
+					writeString(value.value);
+					break;
+				case Value::Type::NUMBER:
+					writeNumber(value.value);
+					break;
+				case Value::Type::BOOL:
+					out.append(value.value.data(), value.value.size());
+					break;
+				case Value::Type::TABLE:
+					out.append("{}");
+					break;
+				}
+			}
+
+			/** the text of a number is already the shortest round trip form, but lua has no literal for inf and nan*/
+			void writeNumber(const string &number)
+			{
+				char last = number.empty() ? '0' : number.back();
+				if (last == 'f' && number[0] == '-')
+					out.append("-1/0");
+				else if (last == 'f')
+					out.append("1/0");
+				else if (last == 'n')
+					out.append("0/0");
+				else
+					out.append(number.data(), number.size());
+			}
+
+			void writeString(const string &text)
+			{
+				out.put('"');
+				const char *run = text.data();
+				const char *end = run + text.size();
+				for (const char *p = run; p != end; ++p)
+				{
+					unsigned char c = (unsigned char)*p;
+					if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f)
+						continue;
+					out.append(run, p - run);
+					run = p + 1;
+					switch (c)
+					{
+					case '"': out.append("\\\""); break;
+					case '\\': out.append("\\\\"); break;
+					case '\n': out.append("\\n"); break;
+					case '\r': out.append("\\r"); break;
+					case '\t': out.append("\\t"); break;
+					default:{
+						// always three digits so that a digit following it isn't taken as part of the escape
+						char escape[4] = { '\\', (char)('0' + c / 100), (char)('0' + c / 10 % 10), (char)('0' + c % 10) };
+						out.append(escape, 4);
+					}
+					}
+				}
+				out.append(run, end - run);
+				out.put('"');
+			}
+
+			OutputBuffer &out;
+			bool pretty;
+		};
+	}
+
+	void LuaWriter::write(const Table &table, OutputSink &sink, WriteStyle style)
+	{
+		LUAPATH_TRACE_ZONE("LuaWriter::write");
+		OutputBuffer buffer(sink);
+		Writer writer(buffer, style);
+		writer.writeChunk(table);
+		buffer.flush();
+	}
+
+	string LuaWriter::toString(const Table &table, WriteStyle style)
+	{
+		string result;
+		StringSink sink(result);
+		write(table, sink, style);
+		return result;
+	}
+
+}
@@ -0,0 +1,181 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "luapath/MessagePackWriter.hpp"
+#include "luapath/Trace.hpp"
+#include "Encoder.hpp"
+#include "OutputBuffer.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::uint8_t;
+	using std::uint16_t;
+	using std::uint32_t;
+	using std::uint64_t;
+	using std::int64_t;
+
+	namespace
+	{
+		class MessagePackEncoder
+			: public Encoder
+		{
+		public:
+			explicit MessagePackEncoder(OutputBuffer &out)
+				: out(out)
+			{
+			}
+
+			virtual void beginArray(std::size_t size)
+			{
+				writeHeader(size, 0x90, 15, 0xdc, 0xdd);
+			}
+
+			virtual void endArray()
+			{
+			}
+
+			virtual void beginObject(std::size_t size)
+			{
+				writeHeader(size, 0x80, 15, 0xde, 0xdf);
+			}
+
+			virtual void endObject()
+			{
+			}
+
+			virtual void key(const char *data, std::size_t length)
+			{
+				str(data, length);
+			}
+
+			virtual void key(int number)
+			{
+				writeInt(number);
+			}
+
+			virtual void str(const char *data, std::size_t length)
+			{
+				if (length <= 31)
+					out.put((char)(0xa0 | length));
+				else if (length <= 0xff)
+				{
+					out.put((char)0xd9);
+					out.put((char)length);
+				}
+				else
+					writeHeader(length, 0, 0, 0xda, 0xdb);
+				out.append(data, length);
+			}
+
+			virtual void number(double value, const char *, std::size_t)
+			{
+				// -2^63 <= value < 2^63
+				if (value == std::floor(value) && value >= -9223372036854775808.0 && value < 9223372036854775808.0
+					&& !(value == 0 && std::signbit(value)))
+				{
+					writeInt((int64_t)value);
+					return;
+				}
+				uint64_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				out.put((char)0xcb);
+				writeBigEndian(bits, 8);
+			}
+
+			virtual void boolean(bool value)
+			{
+				out.put((char)(value ? 0xc3 : 0xc2));
+			}
+
+		private:
+			/** the header of a container or str of @p size elements, the fix form if it is at most @p fixLimit*/
+			void writeHeader(std::size_t size, uint8_t fixTag, std::size_t fixLimit, uint8_t tag16, uint8_t tag32)
+			{
+				if (size <= fixLimit)
+					out.put((char)(fixTag | size));
+				else if (size <= 0xffff)
+				{
+					out.put((char)tag16);
+					writeBigEndian(size, 2);
+				}
+				else
+				{
+					out.put((char)tag32);
+					writeBigEndian(size, 4);
+				}
+			}
+
+			void writeInt(int64_t value)
+			{
+				if (value >= 0)
+				{
+					uint64_t positive = (uint64_t)value;
+					if (positive <= 0x7f)
+						out.put((char)positive);
+					else if (positive <= 0xff)
+						writeTagged(0xcc, positive, 1);
+					else if (positive <= 0xffff)
+						writeTagged(0xcd, positive, 2);
+					else if (positive <= 0xffffffffu)
+						writeTagged(0xce, positive, 4);
+					else
+						writeTagged(0xcf, positive, 8);
+				}
+				else if (value >= -32)
+					out.put((char)(uint8_t)value);
+				else if (value >= INT8_MIN)
+					writeTagged(0xd0, (uint64_t)value, 1);
+				else if (value >= INT16_MIN)
+					writeTagged(0xd1, (uint64_t)value, 2);
+				else if (value >= INT32_MIN)
+					writeTagged(0xd2, (uint64_t)value, 4);
+				else
+					writeTagged(0xd3, (uint64_t)value, 8);
+			}
+
+			void writeTagged(uint8_t tag, uint64_t value, int bytes)
+			{
+				out.put((char)tag);
+				writeBigEndian(value, bytes);
+			}
+
+			void writeBigEndian(uint64_t value, int bytes)
+			{
+				char buffer[8];
+				for (int i = 0; i < bytes; ++i)
+					buffer[i] = (char)(value >> (8 * (bytes - 1 - i)));
+				out.append(buffer, bytes);
+			}
+
+			OutputBuffer &out;
+		};
+	}
+
+	void MessagePackWriter::write(const Table &table, OutputSink &sink)
+	{
+		LUAPATH_TRACE_ZONE("MessagePackWriter::write");
+		OutputBuffer buffer(sink);
+		MessagePackEncoder encoder(buffer);
+		encodeTable(table, encoder);
+		buffer.flush();
+	}
+
+	void MessagePackWriter::write(LuaState &state, const string &tableName, OutputSink &sink)
+	{
+		LUAPATH_TRACE_ZONE_DETAIL("MessagePackWriter::write", tableName);
+		OutputBuffer buffer(sink);
+		MessagePackEncoder encoder(buffer);
+		state.encodeGlobalTable(tableName, encoder);
+		buffer.flush();
+	}
+
+	string MessagePackWriter::toString(const Table &table)
+	{
+		string result;
+		StringSink sink(result);
+		write(table, sink);
+		return result;
+	}
+
+}
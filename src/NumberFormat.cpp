@@ -0,0 +1,521 @@
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "NumberFormat.hpp"
+
+namespace luapath{
+	using std::uint64_t;
+
+	namespace
+	{
+		/** the powers of ten which are exact doubles*/
+		const double POWERS_OF_TEN[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		/** integers up to this are exact doubles*/
+		const double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+		/** most fraction digits tried by the exact fraction fast path*/
+		const int MAX_FAST_FRACTION_DIGITS = 8;
+
+		bool isDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		/** writes @p digits, the integer @p integer with a decimal point @p fractionDigits from the right*/
+		std::size_t writeFixed(bool negative, uint64_t integer, int fractionDigits, char *buffer)
+		{
+			char digits[24];
+			int count = 0;
+			do
+			{
+				digits[count++] = (char)('0' + integer % 10);
+				integer /= 10;
+			} while (integer != 0);
+			// at least one digit in front of the decimal point
+			while (count <= fractionDigits)
+				digits[count++] = '0';
+
+			std::size_t length = 0;
+			if (negative)
+				buffer[length++] = '-';
+			for (int i = count - 1; i >= 0; --i)
+			{
+				buffer[length++] = digits[i];
+				if (i == fractionDigits && i != 0)
+					buffer[length++] = '.';
+			}
+			return length;
+		}
+
+		/** @brief A floating point number f * 2^e with a 64 bit significand*/
+		struct DiyFp
+		{
+			uint64_t f;
+			int e;
+		};
+
+		/** x - y of two numbers with the same exponent where x >= y*/
+		DiyFp subtract(DiyFp x, DiyFp y)
+		{
+			DiyFp result = { x.f - y.f, x.e };
+			return result;
+		}
+
+		/** the upper 64 bits of the product, rounded*/
+		DiyFp multiply(DiyFp x, DiyFp y)
+		{
+			const uint64_t mask = 0xFFFFFFFFu;
+			uint64_t xLow = x.f & mask, xHigh = x.f >> 32;
+			uint64_t yLow = y.f & mask, yHigh = y.f >> 32;
+			uint64_t lowLow = xLow * yLow;
+			uint64_t lowHigh = xLow * yHigh;
+			uint64_t highLow = xHigh * yLow;
+			uint64_t highHigh = xHigh * yHigh;
+			uint64_t middle = (lowLow >> 32) + (lowHigh & mask) + (highLow & mask) + (1u << 31);
+			DiyFp result = { highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32), x.e + y.e + 64 };
+			return result;
+		}
+
+		DiyFp normalize(DiyFp x)
+		{
+			while ((x.f >> 63) == 0)
+			{
+				x.f <<= 1;
+				--x.e;
+			}
+			return x;
+		}
+
+		/** @brief A positive finite number and the bounds of the interval of numbers that round to it*/
+		struct Boundaries
+		{
+			DiyFp value;
+			DiyFp lower;
+			DiyFp upper;
+		};
+
+		Boundaries boundaries(uint64_t bits, int significandBits, int maxExponent)
+		{
+			const int bias = maxExponent - 1 + significandBits;
+			const uint64_t hiddenBit = (uint64_t)1 << significandBits;
+			uint64_t fraction = bits & (hiddenBit - 1);
+			int exponent = (int)(bits >> significandBits);
+
+			DiyFp value = { fraction, 1 - bias };
+			if (exponent != 0)
+			{
+				value.f += hiddenBit;
+				value.e = exponent - bias;
+			}
+			// the next smaller number is closer at a power of two
+			bool lowerIsCloser = fraction == 0 && exponent > 1;
+			DiyFp upper = { 2 * value.f + 1, value.e - 1 };
+			DiyFp lower = { 2 * value.f - 1, value.e - 1 };
+			if (lowerIsCloser)
+			{
+				lower.f = 4 * value.f - 1;
+				lower.e = value.e - 2;
+			}
+
+			Boundaries result;
+			result.upper = normalize(upper);
+			result.lower.f = lower.f << (lower.e - result.upper.e);
+			result.lower.e = result.upper.e;
+			result.value = normalize(value);
+			return result;
+		}
+
+		Boundaries boundaries(double number)
+		{
+			uint64_t bits;
+			std::memcpy(&bits, &number, sizeof(bits));
+			return boundaries(bits, std::numeric_limits<double>::digits - 1, std::numeric_limits<double>::max_exponent);
+		}
+
+		Boundaries boundaries(float number)
+		{
+			std::uint32_t bits;
+			std::memcpy(&bits, &number, sizeof(bits));
+			return boundaries(bits, std::numeric_limits<float>::digits - 1, std::numeric_limits<float>::max_exponent);
+		}
+
+		/** @brief A power of ten f * 2^e = 10^k*/
+		struct CachedPower
+		{
+			uint64_t f;
+			int e;
+			int k;
+		};
+
+		/** 10^k for k = -300, -292, ..., 324 rounded to 64 bit significands*/
+		const CachedPower CACHED_POWERS[] = {
+			{ 0xAB70FE17C79AC6CAULL, -1060, -300 },
+			{ 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+			{ 0xBE5691EF416BD60CULL, -1007, -284 },
+			{ 0x8DD01FAD907FFC3CULL, -980, -276 },
+			{ 0xD3515C2831559A83ULL, -954, -268 },
+			{ 0x9D71AC8FADA6C9B5ULL, -927, -260 },
+			{ 0xEA9C227723EE8BCBULL, -901, -252 },
+			{ 0xAECC49914078536DULL, -874, -244 },
+			{ 0x823C12795DB6CE57ULL, -847, -236 },
+			{ 0xC21094364DFB5637ULL, -821, -228 },
+			{ 0x9096EA6F3848984FULL, -794, -220 },
+			{ 0xD77485CB25823AC7ULL, -768, -212 },
+			{ 0xA086CFCD97BF97F4ULL, -741, -204 },
+			{ 0xEF340A98172AACE5ULL, -715, -196 },
+			{ 0xB23867FB2A35B28EULL, -688, -188 },
+			{ 0x84C8D4DFD2C63F3BULL, -661, -180 },
+			{ 0xC5DD44271AD3CDBAULL, -635, -172 },
+			{ 0x936B9FCEBB25C996ULL, -608, -164 },
+			{ 0xDBAC6C247D62A584ULL, -582, -156 },
+			{ 0xA3AB66580D5FDAF6ULL, -555, -148 },
+			{ 0xF3E2F893DEC3F126ULL, -529, -140 },
+			{ 0xB5B5ADA8AAFF80B8ULL, -502, -132 },
+			{ 0x87625F056C7C4A8BULL, -475, -124 },
+			{ 0xC9BCFF6034C13053ULL, -449, -116 },
+			{ 0x964E858C91BA2655ULL, -422, -108 },
+			{ 0xDFF9772470297EBDULL, -396, -100 },
+			{ 0xA6DFBD9FB8E5B88FULL, -369, -92 },
+			{ 0xF8A95FCF88747D94ULL, -343, -84 },
+			{ 0xB94470938FA89BCFULL, -316, -76 },
+			{ 0x8A08F0F8BF0F156BULL, -289, -68 },
+			{ 0xCDB02555653131B6ULL, -263, -60 },
+			{ 0x993FE2C6D07B7FACULL, -236, -52 },
+			{ 0xE45C10C42A2B3B06ULL, -210, -44 },
+			{ 0xAA242499697392D3ULL, -183, -36 },
+			{ 0xFD87B5F28300CA0EULL, -157, -28 },
+			{ 0xBCE5086492111AEBULL, -130, -20 },
+			{ 0x8CBCCC096F5088CCULL, -103, -12 },
+			{ 0xD1B71758E219652CULL, -77, -4 },
+			{ 0x9C40000000000000ULL, -50, 4 },
+			{ 0xE8D4A51000000000ULL, -24, 12 },
+			{ 0xAD78EBC5AC620000ULL, 3, 20 },
+			{ 0x813F3978F8940984ULL, 30, 28 },
+			{ 0xC097CE7BC90715B3ULL, 56, 36 },
+			{ 0x8F7E32CE7BEA5C70ULL, 83, 44 },
+			{ 0xD5D238A4ABE98068ULL, 109, 52 },
+			{ 0x9F4F2726179A2245ULL, 136, 60 },
+			{ 0xED63A231D4C4FB27ULL, 162, 68 },
+			{ 0xB0DE65388CC8ADA8ULL, 189, 76 },
+			{ 0x83C7088E1AAB65DBULL, 216, 84 },
+			{ 0xC45D1DF942711D9AULL, 242, 92 },
+			{ 0x924D692CA61BE758ULL, 269, 100 },
+			{ 0xDA01EE641A708DEAULL, 295, 108 },
+			{ 0xA26DA3999AEF774AULL, 322, 116 },
+			{ 0xF209787BB47D6B85ULL, 348, 124 },
+			{ 0xB454E4A179DD1877ULL, 375, 132 },
+			{ 0x865B86925B9BC5C2ULL, 402, 140 },
+			{ 0xC83553C5C8965D3DULL, 428, 148 },
+			{ 0x952AB45CFA97A0B3ULL, 455, 156 },
+			{ 0xDE469FBD99A05FE3ULL, 481, 164 },
+			{ 0xA59BC234DB398C25ULL, 508, 172 },
+			{ 0xF6C69A72A3989F5CULL, 534, 180 },
+			{ 0xB7DCBF5354E9BECEULL, 561, 188 },
+			{ 0x88FCF317F22241E2ULL, 588, 196 },
+			{ 0xCC20CE9BD35C78A5ULL, 614, 204 },
+			{ 0x98165AF37B2153DFULL, 641, 212 },
+			{ 0xE2A0B5DC971F303AULL, 667, 220 },
+			{ 0xA8D9D1535CE3B396ULL, 694, 228 },
+			{ 0xFB9B7CD9A4A7443CULL, 720, 236 },
+			{ 0xBB764C4CA7A44410ULL, 747, 244 },
+			{ 0x8BAB8EEFB6409C1AULL, 774, 252 },
+			{ 0xD01FEF10A657842CULL, 800, 260 },
+			{ 0x9B10A4E5E9913129ULL, 827, 268 },
+			{ 0xE7109BFBA19C0C9DULL, 853, 276 },
+			{ 0xAC2820D9623BF429ULL, 880, 284 },
+			{ 0x80444B5E7AA7CF85ULL, 907, 292 },
+			{ 0xBF21E44003ACDD2DULL, 933, 300 },
+			{ 0x8E679C2F5E44FF8FULL, 960, 308 },
+			{ 0xD433179D9C8CB841ULL, 986, 316 },
+			{ 0x9E19DB92B4E31BA9ULL, 1013, 324 }
+		};
+
+		/** the range the scaled upper boundary is brought into so its integral part fits 32 bits*/
+		const int MIN_SCALED_EXPONENT = -60;
+
+		/** the cached power which brings a number with binary exponent @p e into range*/
+		const CachedPower &cachedPower(int e)
+		{
+			// k = ceil((MIN_SCALED_EXPONENT - e - 1) * log10(2)), 78913 / 2^18 approximates log10(2)
+			int f = MIN_SCALED_EXPONENT - e - 1;
+			int k = (f * 78913) / (1 << 18) + (f > 0);
+			return CACHED_POWERS[(300 + k + 7) / 8];
+		}
+
+		/** the number of decimal digits of @p n and the power of ten of the first one*/
+		int decimalDigits(std::uint32_t n, std::uint32_t &power)
+		{
+			int digits = 10;
+			power = 1000000000;
+			while (digits > 1 && n < power)
+			{
+				power /= 10;
+				--digits;
+			}
+			return digits;
+		}
+
+		/** moves the last digit towards the exact value while the digits stay inside the interval*/
+		void roundLastDigit(char *digits, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t unit)
+		{
+			while (rest < distance && delta - rest >= unit &&
+				(rest + unit < distance || distance - rest > rest + unit - distance))
+			{
+				--digits[length - 1];
+				rest += unit;
+			}
+		}
+
+		/** @brief Grisu2: the shortest digits, in almost all cases, of the positive finite @p number
+			@details Fills @p digits and returns their count. The number is digits * 10^exponent.
+			The digits always read back as @p number. See Loitsch, "Printing Floating-Point Numbers
+			Quickly and Accurately with Integers".
+		*/
+		template<class T>
+		int shortestDigits(T number, char *digits, int &exponent)
+		{
+			Boundaries bounds = boundaries(number);
+			const CachedPower &power = cachedPower(bounds.upper.e);
+			DiyFp scale = { power.f, power.e };
+			DiyFp value = multiply(bounds.value, scale);
+			DiyFp lower = multiply(bounds.lower, scale);
+			DiyFp upper = multiply(bounds.upper, scale);
+			// stay strictly inside the interval whatever the rounding of the products
+			++lower.f;
+			--upper.f;
+			exponent = -power.k;
+
+			uint64_t delta = subtract(upper, lower).f;
+			uint64_t distance = subtract(upper, value).f;
+			DiyFp one = { (uint64_t)1 << -upper.e, upper.e };
+			std::uint32_t integral = (std::uint32_t)(upper.f >> -one.e);
+			uint64_t fraction = upper.f & (one.f - 1);
+
+			int length = 0;
+			std::uint32_t divisor;
+			for (int remaining = decimalDigits(integral, divisor); remaining > 0; )
+			{
+				digits[length++] = (char)('0' + integral / divisor);
+				integral %= divisor;
+				--remaining;
+				uint64_t rest = ((uint64_t)integral << -one.e) + fraction;
+				if (rest <= delta)
+				{
+					exponent += remaining;
+					roundLastDigit(digits, length, distance, delta, rest, (uint64_t)divisor << -one.e);
+					return length;
+				}
+				divisor /= 10;
+			}
+			for (;;)
+			{
+				fraction *= 10;
+				digits[length++] = (char)('0' + (fraction >> -one.e));
+				fraction &= one.f - 1;
+				delta *= 10;
+				distance *= 10;
+				--exponent;
+				if (fraction <= delta)
+					break;
+			}
+			roundLastDigit(digits, length, distance, delta, fraction, one.f);
+			return length;
+		}
+
+		/** @brief The shortest decimal form of @p number for the precision of T
+			@details Numbers with at most MAX_FAST_FRACTION_DIGITS fraction digits are written from
+			integers, everything else from shortestDigits. The layout is that of printf("%.*g") with
+			the least precision of at least @p minPrecision that reads back.
+		*/
+		template<class T>
+		std::size_t formatShortest(T number, char *buffer, int minPrecision)
+		{
+			if (std::isnan(number))
+			{
+				std::memcpy(buffer, "nan", 3);
+				return 3;
+			}
+			if (std::isinf(number))
+			{
+				std::memcpy(buffer, number < 0 ? "-inf" : "inf", number < 0 ? 4 : 3);
+				return number < 0 ? 4 : 3;
+			}
+
+			bool negative = std::signbit(number);
+			double magnitude = std::fabs((double)number);
+			if (magnitude < MAX_EXACT_INTEGER)
+			{
+				for (int fractionDigits = 0; fractionDigits <= MAX_FAST_FRACTION_DIGITS; ++fractionDigits)
+				{
+					double scaled = magnitude * POWERS_OF_TEN[fractionDigits];
+					if (scaled >= MAX_EXACT_INTEGER)
+						break;
+					// the division is correctly rounded so this reads back as number
+					if (scaled == std::floor(scaled) && (T)(scaled / POWERS_OF_TEN[fractionDigits]) == (T)magnitude)
+						return writeFixed(negative, (uint64_t)scaled, fractionDigits, buffer);
+				}
+			}
+
+			char digits[20];
+			int exponent;
+			int count = shortestDigits(negative ? -number : number, digits, exponent);
+			while (count > 1 && digits[count - 1] == '0')
+			{
+				--count;
+				++exponent;
+			}
+			// the exponent of the first digit
+			int scientific = count - 1 + exponent;
+
+			std::size_t length = 0;
+			if (negative)
+				buffer[length++] = '-';
+			if (scientific < -4 || scientific >= std::max(minPrecision, count))
+			{
+				buffer[length++] = digits[0];
+				if (count > 1)
+				{
+					buffer[length++] = '.';
+					std::memcpy(buffer + length, digits + 1, count - 1);
+					length += count - 1;
+				}
+				buffer[length++] = 'e';
+				buffer[length++] = scientific < 0 ? '-' : '+';
+				int absolute = scientific < 0 ? -scientific : scientific;
+				if (absolute >= 100)
+					buffer[length++] = (char)('0' + absolute / 100);
+				buffer[length++] = (char)('0' + absolute / 10 % 10);
+				buffer[length++] = (char)('0' + absolute % 10);
+			}
+			else if (scientific < 0)
+			{
+				buffer[length++] = '0';
+				buffer[length++] = '.';
+				for (int i = -1; i > scientific; --i)
+					buffer[length++] = '0';
+				std::memcpy(buffer + length, digits, count);
+				length += count;
+			}
+			else if (count <= scientific + 1)
+			{
+				std::memcpy(buffer + length, digits, count);
+				length += count;
+				for (int i = count; i <= scientific; ++i)
+					buffer[length++] = '0';
+			}
+			else
+			{
+				std::memcpy(buffer + length, digits, scientific + 1);
+				length += scientific + 1;
+				buffer[length++] = '.';
+				std::memcpy(buffer + length, digits + scientific + 1, count - scientific - 1);
+				length += count - scientific - 1;
+			}
+			return length;
+		}
+
+		/** strtod on a copy of [begin, end) with the '.' replaced by the decimal point of the current locale*/
+		const char *parseWithStrtod(const char *begin, const char *end, double &number)
+		{
+			char copy[128];
+			std::size_t length = std::min((std::size_t)(end - begin), sizeof(copy) - 1);
+			std::memcpy(copy, begin, length);
+			copy[length] = '\0';
+			char point = *std::localeconv()->decimal_point;
+			if (point != '.')
+				std::replace(copy, copy + length, '.', point);
+			char *stop;
+			number = std::strtod(copy, &stop);
+			return begin + (stop - copy);
+		}
+	}
+
+	std::size_t formatNumber(double number, char *buffer)
+	{
+		return formatShortest(number, buffer, 15);
+	}
+
+	std::size_t formatNumber(float number, char *buffer)
+	{
+		return formatShortest(number, buffer, 6);
+	}
+
+	const char *parseNumber(const char *begin, const char *end, double &number)
+	{
+		const char *p = begin;
+		bool negative = false;
+		if (p != end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		// hex numbers, inf and nan
+		if (p == end || !(isDigit(*p) || *p == '.') || (*p == '0' && p + 1 != end && (p[1] | 0x20) == 'x'))
+			return parseWithStrtod(begin, end, number);
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool any = false;
+		for (; p != end && isDigit(*p); ++p, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+				digits += mantissa != 0;
+			}
+			else
+				++exponent;
+		}
+		if (p != end && *p == '.')
+		{
+			for (++p; p != end && isDigit(*p); ++p, any = true)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+					digits += mantissa != 0;
+					--exponent;
+				}
+			}
+		}
+		if (!any)
+		{
+			number = 0.0;
+			return begin;
+		}
+		if (p != end && (*p == 'e' || *p == 'E'))
+		{
+			const char *exponentStart = p++;
+			bool negativeExponent = false;
+			if (p != end && (*p == '-' || *p == '+'))
+				negativeExponent = *p++ == '-';
+			if (p == end || !isDigit(*p))
+				p = exponentStart;
+			else
+			{
+				int value = 0;
+				for (; p != end && isDigit(*p); ++p)
+					value = std::min(value * 10 + (*p - '0'), 100000);
+				exponent += negativeExponent ? -value : value;
+			}
+		}
+
+		// Clinger's fast path: both the mantissa and the power of ten are exact doubles
+		if (digits <= 15 && (double)mantissa <= MAX_EXACT_INTEGER && exponent >= -22 && exponent <= 22)
+		{
+			double value = (double)mantissa;
+			value = exponent < 0 ? value / POWERS_OF_TEN[-exponent] : value * POWERS_OF_TEN[exponent];
+			number = negative ? -value : value;
+			return p;
+		}
+		return parseWithStrtod(begin, p, number);
+	}
+
+}
@@ -0,0 +1,28 @@
+#ifndef NUMBERFORMAT_HPP
+#pragma once
+
+#include <cstddef>
+
+namespace luapath
+{
+	/** size of the buffer needed by formatNumber*/
+	const std::size_t NUMBER_BUFFER_SIZE = 32;
+
+	/** @brief Writes the shortest decimal form of @p number that reads back as the same double
+		@details Always uses '.' as the decimal point whatever the locale. Integers are written without
+		a fraction e.g. "40", very large and small numbers with an exponent e.g. "1e+300". Internal to the library
+		@return the length of the text written to @p buffer, which is not null terminated
+	*/
+	std::size_t formatNumber(double number, char *buffer);
+
+	/** @brief Like formatNumber(double, char*) but the shortest form that reads back as the same float*/
+	std::size_t formatNumber(float number, char *buffer);
+
+	/** @brief Parses the number at the start of [begin, end) like strtod in the "C" locale
+		@details Decimal numbers of up to 15 significant digits with small exponents, which is most
+		numbers found in config files, are converted exactly without strtod. Internal to the library
+		@return the end of the parsed number or @p begin if there is none
+	*/
+	const char *parseNumber(const char *begin, const char *end, double &number);
+}
+#endif // !NUMBERFORMAT_HPP
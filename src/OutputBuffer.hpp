@@ -0,0 +1,86 @@
+#ifndef OUTPUTBUFFER_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "luapath/OutputSink.hpp"
+
+namespace luapath
+{
+	/** @brief The buffer the serializers format into. Internal to the library
+		@details Hands the output to the OutputSink in chunks of OutputBuffer::CAPACITY bytes.
+		OutputBuffer::flush has to be called at the end, the destructor doesn't, so that nothing
+		is written to the sink while an exception unwinds.
+	*/
+	class OutputBuffer
+	{
+	public:
+		static const std::size_t CAPACITY = 32 * 1024;
+
+		explicit OutputBuffer(OutputSink &sink)
+			: sink(sink), used(0)
+		{
+		}
+
+		void put(char c)
+		{
+			if (used == CAPACITY)
+				flush();
+			data[used++] = c;
+		}
+
+		void append(const char *text, std::size_t length)
+		{
+			if (length > CAPACITY - used)
+			{
+				flush();
+				if (length >= CAPACITY)
+				{
+					sink.write(text, length);
+					return;
+				}
+			}
+			std::memcpy(data + used, text, length);
+			used += length;
+		}
+
+		template<std::size_t N>
+		void append(const char (&text)[N])
+		{
+			append(text, N - 1);
+		}
+
+		/** writes @p count copies of @p c*/
+		void fill(char c, std::size_t count)
+		{
+			while (count > CAPACITY - used)
+			{
+				std::size_t part = CAPACITY - used;
+				std::memset(data + used, c, part);
+				used = CAPACITY;
+				count -= part;
+				flush();
+			}
+			std::memset(data + used, c, count);
+			used += count;
+		}
+
+		/** hands everything buffered to the sink*/
+		void flush()
+		{
+			if (used)
+				sink.write(data, used);
+			used = 0;
+		}
+
+	private:
+		OutputBuffer(const OutputBuffer &);
+		OutputBuffer &operator=(const OutputBuffer &);
+
+		OutputSink &sink;
+		std::size_t used;
+		char data[CAPACITY];
+	};
+}
+#endif // !OUTPUTBUFFER_HPP
@@ -0,0 +1,527 @@
+#include <cstdint>
+#include <cstring>
+
+#include "luapath/PersistentTable.hpp"
+#include "luapath/exceptions.hpp"
+#include "SearchPath.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::uint32_t;
+	using std::shared_ptr;
+
+	struct PersistentTable::Field
+	{
+		explicit Field(const Key &key)
+			: key(key), number(0), hash(0), isTable(false)
+		{
+
+		}
+
+		Key key;
+		/** the int value of a NUMBER key*/
+		int number;
+		uint32_t hash;
+		bool isTable;
+		Value value;
+		PersistentTable table;
+	};
+
+	struct PersistentTable::Node
+	{
+		/** exactly one of field and child is set*/
+		struct Slot
+		{
+			shared_ptr<const Field> field;
+			shared_ptr<const Node> child;
+		};
+
+		/** bit i is set iff a slot holds the hashes with the 5 bits i at the depth of the node.
+			0 for a collision node below the last level, whose slots are all fields*/
+		uint32_t bitmap;
+		/** the slots in the order of their bits*/
+		std::vector<Slot> slots;
+	};
+
+	namespace
+	{
+		typedef PersistentTable::Node Node;
+		typedef PersistentTable::Field Field;
+
+		const int BITS_PER_LEVEL = 5;
+		const uint32_t LEVEL_MASK = (1u << BITS_PER_LEVEL) - 1;
+		/** nodes at this shift and deeper hold the fields whose whole hash collides*/
+		const int COLLISION_SHIFT = 35;
+
+		uint32_t hashNumber(int number)
+		{
+			// murmur3 finalizer, consecutive array indices spread over the whole trie
+			uint32_t hash = (uint32_t)number;
+			hash ^= hash >> 16;
+			hash *= 0x85ebca6bu;
+			hash ^= hash >> 13;
+			hash *= 0xc2b2ae35u;
+			hash ^= hash >> 16;
+			return hash;
+		}
+
+		uint32_t hashString(const char *data, std::size_t length)
+		{
+			// FNV-1a
+			uint32_t hash = 2166136261u;
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				hash ^= (unsigned char)data[i];
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+
+		/** @brief A key looked up without constructing a Key*/
+		struct KeyView
+		{
+			Key::Type type;
+			const char *data;
+			std::size_t length;
+			int number;
+			uint32_t hash;
+
+			bool matches(const Field &field) const
+			{
+				if (field.key.type != type)
+					return false;
+				if (type == Key::Type::NUMBER)
+					return field.number == number;
+				return field.key.key.size() == length && std::memcmp(field.key.key.data(), data, length) == 0;
+			}
+		};
+
+		KeyView viewOf(const Key &key)
+		{
+			KeyView view = { key.type, key.key.data(), key.key.size(), 0, 0 };
+			if (key.type == Key::Type::NUMBER)
+			{
+				view.number = keyNumber(key.key);
+				view.hash = hashNumber(view.number);
+			}
+			else
+				view.hash = hashString(view.data, view.length);
+			return view;
+		}
+
+		uint32_t bitOf(uint32_t hash, int shift)
+		{
+			return 1u << ((hash >> shift) & LEVEL_MASK);
+		}
+
+		std::size_t slotIndex(uint32_t bitmap, uint32_t bit)
+		{
+			uint32_t below = bitmap & (bit - 1);
+#if defined(__GNUC__) || defined(__clang__)
+			return (std::size_t)__builtin_popcount(below);
+#else
+			std::size_t count = 0;
+			for (; below; below &= below - 1)
+				++count;
+			return count;
+#endif
+		}
+
+		const Field *find(const Node *node, const KeyView &key)
+		{
+			for (int shift = 0; node; shift += BITS_PER_LEVEL)
+			{
+				if (shift >= COLLISION_SHIFT)
+				{
+					for (const Node::Slot &slot : node->slots)
+					{
+						if (key.matches(*slot.field))
+							return slot.field.get();
+					}
+					return nullptr;
+				}
+				uint32_t bit = bitOf(key.hash, shift);
+				if (!(node->bitmap & bit))
+					return nullptr;
+				const Node::Slot &slot = node->slots[slotIndex(node->bitmap, bit)];
+				if (slot.field)
+					return key.matches(*slot.field) ? slot.field.get() : nullptr;
+				node = slot.child.get();
+			}
+			return nullptr;
+		}
+
+		shared_ptr<const Node> singleField(const shared_ptr<const Field> &field, int shift)
+		{
+			shared_ptr<Node> node = std::make_shared<Node>();
+			node->bitmap = shift >= COLLISION_SHIFT ? 0 : bitOf(field->hash, shift);
+			Node::Slot slot = { field, shared_ptr<const Node>() };
+			node->slots.push_back(slot);
+			return node;
+		}
+
+		/** @p node with @p field added or replacing the field with the same key. Copies the nodes on the way*/
+		shared_ptr<const Node> assocNode(const shared_ptr<const Node> &node, int shift, const shared_ptr<const Field> &field, bool &added)
+		{
+			if (!node)
+			{
+				added = true;
+				return singleField(field, shift);
+			}
+			KeyView key = viewOf(field->key);
+			shared_ptr<Node> copy = std::make_shared<Node>(*node);
+			if (shift >= COLLISION_SHIFT)
+			{
+				for (Node::Slot &slot : copy->slots)
+				{
+					if (key.matches(*slot.field))
+					{
+						slot.field = field;
+						return copy;
+					}
+				}
+				Node::Slot slot = { field, shared_ptr<const Node>() };
+				copy->slots.push_back(slot);
+				added = true;
+				return copy;
+			}
+
+			uint32_t bit = bitOf(field->hash, shift);
+			std::size_t index = slotIndex(node->bitmap, bit);
+			if (!(node->bitmap & bit))
+			{
+				Node::Slot slot = { field, shared_ptr<const Node>() };
+				copy->slots.insert(copy->slots.begin() + index, slot);
+				copy->bitmap |= bit;
+				added = true;
+				return copy;
+			}
+			Node::Slot &slot = copy->slots[index];
+			if (slot.child)
+				slot.child = assocNode(slot.child, shift + BITS_PER_LEVEL, field, added);
+			else if (key.matches(*slot.field))
+				slot.field = field;
+			else
+			{
+				// two fields share the bits of this level, push both down
+				bool ignored = false;
+				shared_ptr<const Node> child = singleField(slot.field, shift + BITS_PER_LEVEL);
+				slot.child = assocNode(child, shift + BITS_PER_LEVEL, field, ignored);
+				slot.field.reset();
+				added = true;
+			}
+			return copy;
+		}
+
+		/** @p node without @p key, null if it becomes empty or @p node itself if @p key is not in it*/
+		shared_ptr<const Node> dissocNode(const shared_ptr<const Node> &node, int shift, const KeyView &key, bool &removed)
+		{
+			std::size_t index = 0;
+			if (shift >= COLLISION_SHIFT)
+			{
+				while (index < node->slots.size() && !key.matches(*node->slots[index].field))
+					++index;
+				if (index == node->slots.size())
+					return node;
+			}
+			else
+			{
+				uint32_t bit = bitOf(key.hash, shift);
+				if (!(node->bitmap & bit))
+					return node;
+				index = slotIndex(node->bitmap, bit);
+				const Node::Slot &slot = node->slots[index];
+				if (slot.child)
+				{
+					shared_ptr<const Node> child = dissocNode(slot.child, shift + BITS_PER_LEVEL, key, removed);
+					if (child == slot.child)
+						return node;
+					if (child)
+					{
+						shared_ptr<Node> copy = std::make_shared<Node>(*node);
+						// a lone field moves up so that the trie stays as shallow as possible
+						if (child->slots.size() == 1 && child->slots[0].field)
+						{
+							copy->slots[index].field = child->slots[0].field;
+							copy->slots[index].child.reset();
+						}
+						else
+							copy->slots[index].child = child;
+						return copy;
+					}
+				}
+				else if (!key.matches(*slot.field))
+					return node;
+			}
+
+			removed = true;
+			if (node->slots.size() == 1)
+				return shared_ptr<const Node>();
+			shared_ptr<Node> copy = std::make_shared<Node>(*node);
+			copy->slots.erase(copy->slots.begin() + index);
+			if (shift < COLLISION_SHIFT)
+				copy->bitmap &= ~bitOf(key.hash, shift);
+			return copy;
+		}
+
+		void forEachField(const Node *node, const PersistentTable::FieldCallback &callback)
+		{
+			if (!node)
+				return;
+			for (const Node::Slot &slot : node->slots)
+			{
+				if (slot.child)
+					forEachField(slot.child.get(), callback);
+				else if (slot.field->isTable)
+					callback(slot.field->key, nullptr, &slot.field->table);
+				else
+					callback(slot.field->key, &slot.field->value, nullptr);
+			}
+		}
+
+		shared_ptr<const Field> makeField(const Key &key, const Value *value, const PersistentTable *table)
+		{
+			shared_ptr<Field> field = std::make_shared<Field>(key);
+			KeyView view = viewOf(key);
+			field->number = view.number;
+			field->hash = view.hash;
+			field->isTable = value == nullptr;
+			if (value)
+				field->value = *value;
+			else
+				field->table = *table;
+			return field;
+		}
+	}
+
+	PersistentTable::PersistentTable()
+		: count(0)
+	{
+
+	}
+
+	PersistentTable::PersistentTable(const Table &table)
+		: count(0)
+	{
+		for (const Table::LeafSet::value_type &leaf : table.leafSet)
+			*this = assoc(makeField(leaf.first, &leaf.second, nullptr));
+		for (const Table::NestedSet::value_type &nested : table.nestedSet)
+		{
+			PersistentTable child(nested.second);
+			*this = assoc(makeField(nested.first, nullptr, &child));
+		}
+	}
+
+	PersistentTable::PersistentTable(shared_ptr<const Node> root, std::size_t count)
+		: root(std::move(root)), count(count)
+	{
+
+	}
+
+	PersistentTable PersistentTable::with(const string &searchPath, const Value &value) const
+	{
+		return withPath(splitSearchPath(searchPath, "empty search path parameter not allowed for PersistentTable"), 0, &value, nullptr);
+	}
+
+	PersistentTable PersistentTable::with(const string &searchPath, const PersistentTable &table) const
+	{
+		return withPath(splitSearchPath(searchPath, "empty search path parameter not allowed for PersistentTable"), 0, nullptr, &table);
+	}
+
+	PersistentTable PersistentTable::without(const string &searchPath) const
+	{
+		return withoutPath(splitSearchPath(searchPath, "empty search path parameter not allowed for PersistentTable"), 0);
+	}
+
+	PersistentTable PersistentTable::assoc(const shared_ptr<const Field> &field) const
+	{
+		bool added = false;
+		shared_ptr<const Node> newRoot = assocNode(root, 0, field, added);
+		return PersistentTable(newRoot, count + (added ? 1 : 0));
+	}
+
+	PersistentTable PersistentTable::withPath(const std::vector<Key> &path, std::size_t index,
+		const Value *value, const PersistentTable *table) const
+	{
+		const Key &key = path[index];
+		if (index + 1 == path.size())
+			return assoc(makeField(key, value, table));
+
+		KeyView view = viewOf(key);
+		const Field *existing = find(root.get(), view);
+		if (existing && !existing->isTable)
+			throw path_lookup_exception("Found value but not at the end of the search path");
+		PersistentTable child = existing ? existing->table : PersistentTable();
+		PersistentTable edited = child.withPath(path, index + 1, value, table);
+		return assoc(makeField(key, nullptr, &edited));
+	}
+
+	PersistentTable PersistentTable::withoutPath(const std::vector<Key> &path, std::size_t index) const
+	{
+		KeyView view = viewOf(path[index]);
+		const Field *existing = find(root.get(), view);
+		if (!existing)
+			return *this;
+		if (index + 1 == path.size())
+		{
+			bool removed = false;
+			shared_ptr<const Node> newRoot = dissocNode(root, 0, view, removed);
+			return PersistentTable(newRoot, count - (removed ? 1 : 0));
+		}
+		if (!existing->isTable)
+			return *this;
+		PersistentTable edited = existing->table.withoutPath(path, index + 1);
+		if (edited.sameVersion(existing->table))
+			return *this;
+		return assoc(makeField(existing->key, nullptr, &edited));
+	}
+
+	const PersistentTable::Field *PersistentTable::findField(Key::Type type, const char *data, std::size_t length, int number) const
+	{
+		KeyView view = { type, data, length, number, type == Key::Type::NUMBER ? hashNumber(number) : hashString(data, length) };
+		return find(root.get(), view);
+	}
+
+	LookupResult PersistentTable::resolve(const string &searchPath, const Value **value, const PersistentTable **table) const
+	{
+		LookupResult result = { LookupStatus::FOUND, 0, 0, 0 };
+		const PersistentTable *currTable = this;
+		const char *begin = searchPath.data();
+		const char *end = begin + searchPath.size();
+		if (begin == end)
+		{
+			if (value)
+				result.status = LookupStatus::EMPTY_PATH;
+			else
+				*table = this;
+			return result;
+		}
+
+		const char *segment = begin;
+		while (segment != end)
+		{
+			const char *field = segment + 1;
+			const char *fieldEnd = field;
+			while (fieldEnd != end && !isPathToken(*fieldEnd))
+				++fieldEnd;
+			result.offset = (uint32_t)(segment - begin);
+			result.length = (uint32_t)(fieldEnd - segment);
+
+			int number = 0;
+			Key::Type type = *segment == NUMBER_TOKEN ? Key::Type::NUMBER : Key::Type::STRING;
+			if (!isPathToken(*segment) || (type == Key::Type::NUMBER && !parseField(field, fieldEnd, number)))
+			{
+				result.status = LookupStatus::INVALID_PATH;
+				return result;
+			}
+
+			const Field *found = currTable->findField(type, field, fieldEnd - field, number);
+			if (!found)
+			{
+				result.status = LookupStatus::NOT_FOUND;
+				return result;
+			}
+			if (!found->isTable)
+			{
+				if (!value || fieldEnd != end)
+				{
+					result.status = LookupStatus::NOT_A_TABLE;
+					return result;
+				}
+				*value = &found->value;
+				++result.segment;
+				return result;
+			}
+			currTable = &found->table;
+			++result.segment;
+			segment = fieldEnd;
+		}
+
+		if (value)
+		{
+			--result.segment;
+			result.status = LookupStatus::NOT_A_VALUE;
+		}
+		else
+			*table = currTable;
+		return result;
+	}
+
+	Value PersistentTable::getValue(const string &searchPath) const
+	{
+		const Value *value = nullptr;
+		LookupResult result = resolve(searchPath, &value, nullptr);
+		if (!value)
+			throw Table::lookupError(result, searchPath, true);
+		return *value;
+	}
+
+	PersistentTable PersistentTable::getTable(const string &searchPath) const
+	{
+		const PersistentTable *table = nullptr;
+		LookupResult result = resolve(searchPath, nullptr, &table);
+		if (!table)
+			throw Table::lookupError(result, searchPath, false);
+		return *table;
+	}
+
+	const Value *PersistentTable::tryGetValue(const string &searchPath, LookupResult *result) const
+	{
+		const Value *value = nullptr;
+		LookupResult outcome = resolve(searchPath, &value, nullptr);
+		if (result)
+			*result = outcome;
+		return value;
+	}
+
+	const PersistentTable *PersistentTable::tryGetTable(const string &searchPath, LookupResult *result) const
+	{
+		const PersistentTable *table = nullptr;
+		LookupResult outcome = resolve(searchPath, nullptr, &table);
+		if (result)
+			*result = outcome;
+		return table;
+	}
+
+	bool PersistentTable::contains(const string &searchPath) const
+	{
+		const Value *value = nullptr;
+		LookupResult result = resolve(searchPath, &value, nullptr);
+		return value != nullptr || result.status == LookupStatus::NOT_A_VALUE;
+	}
+
+	std::size_t PersistentTable::size() const
+	{
+		return count;
+	}
+
+	bool PersistentTable::empty() const
+	{
+		return count == 0;
+	}
+
+	void PersistentTable::forEach(const FieldCallback &callback) const
+	{
+		forEachField(root.get(), callback);
+	}
+
+	Table PersistentTable::toTable(const Key &tableKey) const
+	{
+		Table table(tableKey);
+		forEach([&table](const Key &key, const Value *value, const PersistentTable *nested) {
+			if (value)
+				table.leafSet.append(key, *value);
+			else
+				table.nestedSet.append(key, nested->toTable(key));
+		});
+		table.leafSet.sort();
+		table.nestedSet.sort();
+		return table;
+	}
+
+	bool PersistentTable::sameVersion(const PersistentTable &other) const
+	{
+		return root == other.root;
+	}
+
+}
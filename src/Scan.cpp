@@ -0,0 +1,241 @@
+#include <atomic>
+
+#include "Scan.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define LUAPATH_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace luapath{
+
+	namespace
+	{
+		/** ScanLevel as int, -1 until the first call of scanner or setScanLevel*/
+		std::atomic<int> currentLevel(-1);
+
+		bool isSpace(char c)
+		{
+			return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+		}
+
+		bool isNumeral(char c)
+		{
+			return (unsigned char)(c - '0') <= 9 || (unsigned char)((c | 0x20) - 'a') <= 'f' - 'a' || c == '.';
+		}
+
+		const char *findAnyScalar(const char *p, const char *end, char a, char b, char c, char d)
+		{
+			while (p != end && *p != a && *p != b && *p != c && *p != d)
+				++p;
+			return p;
+		}
+
+		const char *findStringEndScalar(const char *p, const char *end, char quote)
+		{
+			while (p != end && *p != quote && *p != '\\' && (unsigned char)*p >= 0x20)
+				++p;
+			return p;
+		}
+
+		const char *skipSpaceScalar(const char *p, const char *end)
+		{
+			while (p != end && isSpace(*p))
+				++p;
+			return p;
+		}
+
+		const char *skipNumeralScalar(const char *p, const char *end)
+		{
+			while (p != end && isNumeral(*p))
+				++p;
+			return p;
+		}
+
+#ifdef LUAPATH_SCAN_X86
+		// unsigned x <= limit for every byte, there is no unsigned byte comparison before AVX-512
+		inline __m128i lessEqual(__m128i x, __m128i limit)
+		{
+			return _mm_cmpeq_epi8(_mm_min_epu8(x, limit), x);
+		}
+
+		inline __m128i spaceMask(__m128i x)
+		{
+			return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+				lessEqual(_mm_sub_epi8(x, _mm_set1_epi8('\t')), _mm_set1_epi8('\r' - '\t')));
+		}
+
+		inline __m128i numeralMask(__m128i x)
+		{
+			__m128i digit = lessEqual(_mm_sub_epi8(x, _mm_set1_epi8('0')), _mm_set1_epi8(9));
+			__m128i letter = lessEqual(_mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a')), _mm_set1_epi8('f' - 'a'));
+			return _mm_or_si128(_mm_or_si128(digit, letter), _mm_cmpeq_epi8(x, _mm_set1_epi8('.')));
+		}
+
+		const char *findAnySse2(const char *p, const char *end, char a, char b, char c, char d)
+		{
+			const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b), vc = _mm_set1_epi8(c), vd = _mm_set1_epi8(d);
+			for (; end - p >= 16; p += 16)
+			{
+				__m128i x = _mm_loadu_si128((const __m128i*)p);
+				__m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)),
+					_mm_or_si128(_mm_cmpeq_epi8(x, vc), _mm_cmpeq_epi8(x, vd)));
+				int mask = _mm_movemask_epi8(found);
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return findAnyScalar(p, end, a, b, c, d);
+		}
+
+		const char *findStringEndSse2(const char *p, const char *end, char quote)
+		{
+			const __m128i vquote = _mm_set1_epi8(quote), vescape = _mm_set1_epi8('\\'), vcontrol = _mm_set1_epi8(0x1F);
+			for (; end - p >= 16; p += 16)
+			{
+				__m128i x = _mm_loadu_si128((const __m128i*)p);
+				__m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, vquote), _mm_cmpeq_epi8(x, vescape)),
+					lessEqual(x, vcontrol));
+				int mask = _mm_movemask_epi8(found);
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return findStringEndScalar(p, end, quote);
+		}
+
+		const char *skipSpaceSse2(const char *p, const char *end)
+		{
+			for (; end - p >= 16; p += 16)
+			{
+				int mask = ~_mm_movemask_epi8(spaceMask(_mm_loadu_si128((const __m128i*)p))) & 0xFFFF;
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return skipSpaceScalar(p, end);
+		}
+
+		const char *skipNumeralSse2(const char *p, const char *end)
+		{
+			for (; end - p >= 16; p += 16)
+			{
+				int mask = ~_mm_movemask_epi8(numeralMask(_mm_loadu_si128((const __m128i*)p))) & 0xFFFF;
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return skipNumeralScalar(p, end);
+		}
+
+#define LUAPATH_AVX2 __attribute__((target("avx2")))
+
+		LUAPATH_AVX2 inline __m256i lessEqual256(__m256i x, __m256i limit)
+		{
+			return _mm256_cmpeq_epi8(_mm256_min_epu8(x, limit), x);
+		}
+
+		LUAPATH_AVX2 const char *findAnyAvx2(const char *p, const char *end, char a, char b, char c, char d)
+		{
+			const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b), vc = _mm256_set1_epi8(c), vd = _mm256_set1_epi8(d);
+			for (; end - p >= 32; p += 32)
+			{
+				__m256i x = _mm256_loadu_si256((const __m256i*)p);
+				__m256i found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)),
+					_mm256_or_si256(_mm256_cmpeq_epi8(x, vc), _mm256_cmpeq_epi8(x, vd)));
+				unsigned mask = (unsigned)_mm256_movemask_epi8(found);
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return findAnySse2(p, end, a, b, c, d);
+		}
+
+		LUAPATH_AVX2 const char *findStringEndAvx2(const char *p, const char *end, char quote)
+		{
+			const __m256i vquote = _mm256_set1_epi8(quote), vescape = _mm256_set1_epi8('\\'), vcontrol = _mm256_set1_epi8(0x1F);
+			for (; end - p >= 32; p += 32)
+			{
+				__m256i x = _mm256_loadu_si256((const __m256i*)p);
+				__m256i found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, vquote), _mm256_cmpeq_epi8(x, vescape)),
+					lessEqual256(x, vcontrol));
+				unsigned mask = (unsigned)_mm256_movemask_epi8(found);
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return findStringEndSse2(p, end, quote);
+		}
+
+		LUAPATH_AVX2 const char *skipSpaceAvx2(const char *p, const char *end)
+		{
+			for (; end - p >= 32; p += 32)
+			{
+				__m256i x = _mm256_loadu_si256((const __m256i*)p);
+				__m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+					lessEqual256(_mm256_sub_epi8(x, _mm256_set1_epi8('\t')), _mm256_set1_epi8('\r' - '\t')));
+				unsigned mask = ~(unsigned)_mm256_movemask_epi8(space);
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return skipSpaceSse2(p, end);
+		}
+
+		LUAPATH_AVX2 const char *skipNumeralAvx2(const char *p, const char *end)
+		{
+			for (; end - p >= 32; p += 32)
+			{
+				__m256i x = _mm256_loadu_si256((const __m256i*)p);
+				__m256i digit = lessEqual256(_mm256_sub_epi8(x, _mm256_set1_epi8('0')), _mm256_set1_epi8(9));
+				__m256i letter = lessEqual256(_mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a')),
+					_mm256_set1_epi8('f' - 'a'));
+				__m256i numeral = _mm256_or_si256(_mm256_or_si256(digit, letter), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('.')));
+				unsigned mask = ~(unsigned)_mm256_movemask_epi8(numeral);
+				if (mask)
+					return p + __builtin_ctz(mask);
+			}
+			return skipNumeralSse2(p, end);
+		}
+
+#undef LUAPATH_AVX2
+#endif
+
+		const Scanner SCANNERS[] = {
+			{ findAnyScalar, findStringEndScalar, skipSpaceScalar, skipNumeralScalar },
+#ifdef LUAPATH_SCAN_X86
+			{ findAnySse2, findStringEndSse2, skipSpaceSse2, skipNumeralSse2 },
+			{ findAnyAvx2, findStringEndAvx2, skipSpaceAvx2, skipNumeralAvx2 },
+#endif
+		};
+
+		ScanLevel detectScanLevel()
+		{
+#ifdef LUAPATH_SCAN_X86
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") ? ScanLevel::AVX2 : ScanLevel::SSE2;
+#else
+			return ScanLevel::SCALAR;
+#endif
+		}
+	}
+
+	ScanLevel supportedScanLevel()
+	{
+		static const ScanLevel supported = detectScanLevel();
+		return supported;
+	}
+
+	ScanLevel scanLevel()
+	{
+		int level = currentLevel.load(std::memory_order_relaxed);
+		return level < 0 ? supportedScanLevel() : (ScanLevel)level;
+	}
+
+	ScanLevel setScanLevel(ScanLevel level)
+	{
+		if (level > supportedScanLevel())
+			level = supportedScanLevel();
+		currentLevel.store((int)level, std::memory_order_relaxed);
+		return level;
+	}
+
+	const Scanner &scanner()
+	{
+		return SCANNERS[(int)scanLevel()];
+	}
+
+}
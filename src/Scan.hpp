@@ -0,0 +1,27 @@
+#ifndef SCAN_HPP
+#pragma once
+
+#include "luapath/DataLoader.hpp"
+
+namespace luapath
+{
+	/** @brief Byte scanners of the DataLoader. Internal to the library
+		@details Every function returns a pointer into [p, end) or @p end and reads nothing outside of it.
+		There is one Scanner per ScanLevel, scanner() returns the one selected with setScanLevel.
+	*/
+	struct Scanner
+	{
+		/** the first byte equal to @p a, @p b, @p c or @p d*/
+		const char *(*findAny)(const char *p, const char *end, char a, char b, char c, char d);
+		/** the first byte equal to @p quote or '\\' or below 0x20, i.e. where a JSON string stops being plain text*/
+		const char *(*findStringEnd)(const char *p, const char *end, char quote);
+		/** the first byte which is not lua whitespace*/
+		const char *(*skipSpace)(const char *p, const char *end);
+		/** the first byte which is neither a hex digit nor '.'*/
+		const char *(*skipNumeral)(const char *p, const char *end);
+	};
+
+	/** the Scanner of the current ScanLevel*/
+	const Scanner &scanner();
+}
+#endif // !SCAN_HPP
@@ -0,0 +1,88 @@
+#include <string>
+
+#include "luapath/ScriptProfiler.hpp"
+
+#include <lua.hpp>
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		/** only the innermost frames of deeper stacks are recorded*/
+		const int MAX_FRAMES = 128;
+
+		void appendFrame(string &out, lua_Debug &frame)
+		{
+			if (*frame.what == 'C')
+			{
+				out += frame.name ? frame.name : "?";
+				out += " [C]";
+				return;
+			}
+			if (*frame.what == 'm')
+				out += "main chunk";
+			else
+				out += frame.name ? frame.name : "?";
+			out += " (";
+			// ';' separates the frames of a folded stack
+			for (const char *c = frame.short_src; *c; ++c)
+				out += *c == ';' ? ',' : *c;
+			out += ':';
+			out += std::to_string(frame.currentline);
+			out += ')';
+		}
+	}
+
+	ScriptProfiler::ScriptProfiler(int instructionInterval)
+		: interval(instructionInterval > 0 ? instructionInterval : 1), samples(0)
+	{
+
+	}
+
+	void ScriptProfiler::writeFolded(std::ostream &out) const
+	{
+		for (std::map<string, std::uint64_t>::const_iterator it = stacks.begin(); it != stacks.end(); ++it)
+			out << it->first << ' ' << it->second << '\n';
+	}
+
+	std::uint64_t ScriptProfiler::sampleCount() const
+	{
+		return samples;
+	}
+
+	int ScriptProfiler::instructionInterval() const
+	{
+		return interval;
+	}
+
+	void ScriptProfiler::clear()
+	{
+		samples = 0;
+		stacks.clear();
+	}
+
+	void ScriptProfiler::sample(lua_State *L)
+	{
+		// level 0 is the innermost function. The folded format wants the outermost first
+		int depth = 0;
+		lua_Debug frame;
+		while (depth < MAX_FRAMES && lua_getstack(L, depth, &frame))
+			++depth;
+
+		string stack;
+		for (int level = depth - 1; level >= 0; --level)
+		{
+			if (!lua_getstack(L, level, &frame) || !lua_getinfo(L, "Sln", &frame))
+				continue;
+			if (!stack.empty())
+				stack += ';';
+			appendFrame(stack, frame);
+		}
+		if (stack.empty())
+			return;
+		++samples;
+		++stacks[stack];
+	}
+
+}
@@ -0,0 +1,71 @@
+#include <climits>
+
+#include "SearchPath.hpp"
+#include "luapath/exceptions.hpp"
+
+namespace luapath{
+	using std::string;
+
+	int keyNumber(const string &key)
+	{
+		string::const_iterator it = key.begin();
+		bool negative = it != key.end() && *it == '-';
+		if (negative)
+			++it;
+		long long number = 0;
+		for (; it != key.end(); ++it)
+			number = number * 10 + (*it - '0');
+		return (int)(negative ? -number : number);
+	}
+
+	bool parseField(const char *begin, const char *end, int &number)
+	{
+		bool negative = begin != end && *begin == '-';
+		if (negative)
+			++begin;
+		if (begin == end)
+			return false;
+		long long value = 0;
+		for (; begin != end; ++begin)
+		{
+			if (*begin < '0' || *begin > '9')
+				return false;
+			value = value * 10 + (*begin - '0');
+			if (value > (long long)INT_MAX + 1)
+				return false;
+		}
+		value = negative ? -value : value;
+		if (value > INT_MAX || value < INT_MIN)
+			return false;
+		number = (int)value;
+		return true;
+	}
+
+	std::vector<Key> splitSearchPath(const string &searchPath, const char *emptyMessage)
+	{
+		if (searchPath.empty())
+			throw path_lookup_exception(emptyMessage);
+		if (!isPathToken(searchPath[0]))
+			throw path_lookup_exception("Invalid starting token character");
+		std::vector<Key> path;
+		const char *segment = searchPath.data();
+		const char *end = segment + searchPath.size();
+		while (segment != end)
+		{
+			const char *field = segment + 1;
+			const char *fieldEnd = field;
+			while (fieldEnd != end && !isPathToken(*fieldEnd))
+				++fieldEnd;
+			int number;
+			if (*segment == STRING_TOKEN)
+				path.push_back(Key(Key::Type::STRING, string(field, fieldEnd)));
+			else if (parseField(field, fieldEnd, number))
+				path.push_back(Key(number));
+			else
+				throw path_lookup_exception(string("Number field in the search path is not an integer - ").append(field, fieldEnd));
+			segment = fieldEnd;
+		}
+		return path;
+	}
+
+}
@@ -0,0 +1,30 @@
+#ifndef SEARCHPATH_HPP
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "luapath/LuaTypes.hpp"
+
+namespace luapath
+{
+	/** true iff @p c starts a field of a search path. Internal to the library*/
+	inline bool isPathToken(char c)
+	{
+		return c == STRING_TOKEN || c == NUMBER_TOKEN;
+	}
+
+	/** the int value of a NUMBER key. Keys hold the text of an int so this doesn't fail*/
+	int keyNumber(const std::string &key);
+
+	/** parses the number field [begin, end) of a search path, false if it is not an int*/
+	bool parseField(const char *begin, const char *end, int &number);
+
+	/** @brief The keys of the fields of @p searchPath for the functions that edit along a path
+		@details Number fields are stored in their canonical form i.e. "#007" gives Key(7).
+		@throws path_lookup_exception with the message @p emptyMessage if @p searchPath is empty
+		or with the messages of Table::getValue if it is malformed
+	*/
+	std::vector<Key> splitSearchPath(const std::string &searchPath, const char *emptyMessage);
+}
+#endif // !SEARCHPATH_HPP
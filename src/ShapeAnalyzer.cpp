@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "luapath/ShapeAnalyzer.hpp"
+#include "NumberFormat.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::size_t;
+
+	namespace
+	{
+		/** FNV-1a. Only used to tell strings apart so a collision merely undercounts the distinct strings*/
+		std::uint64_t hashString(const char *data, size_t length)
+		{
+			std::uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < length; ++i)
+			{
+				hash ^= (unsigned char)data[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		/** keeps the largest subtrees on top of a min heap*/
+		bool largerShape(const SubtreeShape &lhs, const SubtreeShape &rhs)
+		{
+			return lhs.estimatedBytes > rhs.estimatedBytes;
+		}
+
+		double share(size_t part, size_t whole)
+		{
+			return whole ? 100.0 * part / whole : 0.0;
+		}
+
+		void writeJson(std::ostream &out, const SubtreeShape &shape)
+		{
+			out << "{\"path\":\"";
+			for (string::const_iterator it = shape.path.begin(); it != shape.path.end(); ++it)
+			{
+				unsigned char c = (unsigned char)*it;
+				if (c == '"' || c == '\\')
+					out << '\\' << *it;
+				else if (c < 0x20)
+					out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xF];
+				else
+					out << *it;
+			}
+			out << "\",\"depth\":" << shape.depth << ",\"tables\":" << shape.tables << ",\"leaves\":" << shape.leaves
+				<< ",\"number_keys\":" << shape.numberKeys << ",\"string_keys\":" << shape.stringKeys
+				<< ",\"string_bytes\":" << shape.stringBytes << ",\"estimated_bytes\":" << shape.estimatedBytes << "}";
+		}
+	}
+
+	double ShapeReport::duplicateRatio() const
+	{
+		return strings ? (double)duplicatedStrings / strings : 0.0;
+	}
+
+	void ShapeReport::write(std::ostream &out) const
+	{
+		std::ios::fmtflags flags = out.flags();
+		out << std::fixed << std::setprecision(1)
+			<< root.path << ": " << root.tables << " tables, " << root.leaves << " leaves, depth " << root.depth
+			<< ", " << root.estimatedBytes << " bytes estimated, " << root.stringBytes << " string bytes, "
+			<< 100.0 * duplicateRatio() << "% duplicated strings (" << duplicatedStringBytes << " bytes), "
+			<< share(root.numberKeys, root.numberKeys + root.stringKeys) << "% number keys\n";
+
+		size_t width = 4;
+		for (const SubtreeShape &shape : largest)
+			width = std::max(width, shape.path.size());
+		out << std::left << std::setw((int)width) << "path" << std::right << std::setw(14) << "bytes" << std::setw(8) << "share"
+			<< std::setw(10) << "tables" << std::setw(10) << "leaves" << std::setw(7) << "depth" << std::setw(14) << "number keys" << '\n';
+		for (const SubtreeShape &shape : largest)
+		{
+			out << std::left << std::setw((int)width) << shape.path << std::right << std::setw(14) << shape.estimatedBytes
+				<< std::setw(7) << share(shape.estimatedBytes, root.estimatedBytes) << '%' << std::setw(10) << shape.tables
+				<< std::setw(10) << shape.leaves << std::setw(7) << shape.depth
+				<< std::setw(13) << share(shape.numberKeys, shape.numberKeys + shape.stringKeys) << "%\n";
+		}
+		out.flags(flags);
+	}
+
+	string ShapeReport::toJson() const
+	{
+		std::ostringstream out;
+		out << "{\"root\":";
+		writeJson(out, root);
+		out << ",\"strings\":" << strings << ",\"duplicated_strings\":" << duplicatedStrings
+			<< ",\"duplicated_string_bytes\":" << duplicatedStringBytes << ",\"largest\":[";
+		for (size_t i = 0; i < largest.size(); ++i)
+		{
+			out << (i ? "," : "");
+			writeJson(out, largest[i]);
+		}
+		out << "]}";
+		return out.str();
+	}
+
+	ShapeAnalyzer::ShapeAnalyzer(size_t largestCount)
+		: largestCount(largestCount), result()
+	{
+
+	}
+
+	size_t ShapeAnalyzer::stringHeapBytes(size_t length)
+	{
+		// strings up to the capacity of an empty std::string are stored inside the object
+		static const size_t inPlace = string().capacity();
+		return length > inPlace ? length + 1 : 0;
+	}
+
+	void ShapeAnalyzer::addString(const char *data, size_t length)
+	{
+		++result.strings;
+		size_t &seen = seenStrings[hashString(data, length)];
+		if (seen++ > 0)
+		{
+			++result.duplicatedStrings;
+			result.duplicatedStringBytes += length;
+		}
+	}
+
+	size_t ShapeAnalyzer::addKey(Key::Type type, const char *data, size_t length)
+	{
+		SubtreeShape &current = stack.back();
+		if (type == Key::Type::NUMBER)
+		{
+			++current.numberKeys;
+			return 0;
+		}
+		++current.stringKeys;
+		current.stringBytes += length;
+		addString(data, length);
+		return stringHeapBytes(length);
+	}
+
+	void ShapeAnalyzer::onEnterTable(const KeyRef &key)
+	{
+		string path;
+		if (!stack.empty())
+		{
+			SubtreeShape &parent = stack.back();
+			// a nested Table keeps a copy of its key next to the one of the slot
+			size_t keyBytes = addKey(key.type, key.data, key.length);
+			parent.estimatedBytes += sizeof(Table::NestedSet::value_type) + 2 * keyBytes;
+			path = parent.path;
+			path += key.type == Key::Type::NUMBER ? NUMBER_TOKEN : STRING_TOKEN;
+		}
+		if (key.type == Key::Type::NUMBER)
+			path += std::to_string(key.index);
+		else
+			path.append(key.data, key.length);
+
+		SubtreeShape shape = { path, 1, 0, 0, 0, 0, 0, 0 };
+		stack.push_back(shape);
+	}
+
+	void ShapeAnalyzer::onLeaf(const KeyRef &key, const ValueRef &value)
+	{
+		size_t bytes = sizeof(Table::LeafSet::value_type) + addKey(key.type, key.data, key.length);
+		SubtreeShape &current = stack.back();
+		++current.leaves;
+		switch (value.type)
+		{
+		case Value::Type::STRING:
+			current.stringBytes += value.length;
+			addString(value.data, value.length);
+			bytes += stringHeapBytes(value.length);
+			break;
+		case Value::Type::NUMBER:
+			if (value.data)
+				bytes += stringHeapBytes(value.length);
+			else
+			{
+				// a snapshot stores numbers as their shortest text
+				char buffer[NUMBER_BUFFER_SIZE];
+				bytes += stringHeapBytes(formatNumber(value.number, buffer));
+			}
+			break;
+		default:
+			break;
+		}
+		current.estimatedBytes += bytes;
+	}
+
+	void ShapeAnalyzer::onExitTable()
+	{
+		SubtreeShape child = stack.back();
+		stack.pop_back();
+		if (stack.empty())
+		{
+			result.root = child;
+			return;
+		}
+
+		SubtreeShape &parent = stack.back();
+		parent.depth = std::max(parent.depth, child.depth + 1);
+		parent.tables += child.tables + 1;
+		parent.leaves += child.leaves;
+		parent.numberKeys += child.numberKeys;
+		parent.stringKeys += child.stringKeys;
+		parent.stringBytes += child.stringBytes;
+		parent.estimatedBytes += child.estimatedBytes;
+
+		if (largestCount == 0)
+			return;
+		if (result.largest.size() < largestCount)
+		{
+			result.largest.push_back(child);
+			std::push_heap(result.largest.begin(), result.largest.end(), largerShape);
+		}
+		else if (child.estimatedBytes > result.largest.front().estimatedBytes)
+		{
+			std::pop_heap(result.largest.begin(), result.largest.end(), largerShape);
+			result.largest.back() = child;
+			std::push_heap(result.largest.begin(), result.largest.end(), largerShape);
+		}
+	}
+
+	void ShapeAnalyzer::analyze(const Table &table)
+	{
+		const Key &key = table.getKey();
+		KeyRef root = { key.type, key.key.data(), key.key.size(), key.type == Key::Type::NUMBER ? (int)key : 0 };
+		onEnterTable(root);
+		analyzeContents(table);
+		onExitTable();
+	}
+
+	void ShapeAnalyzer::analyzeContents(const Table &table)
+	{
+		for (const Table::Entry &entry : table)
+		{
+			KeyRef key = { entry.key.type, entry.key.key.data(), entry.key.key.size(),
+				entry.key.type == Key::Type::NUMBER ? (int)entry.key : 0 };
+			if (entry.isTable())
+			{
+				onEnterTable(key);
+				analyzeContents(*entry.table);
+				onExitTable();
+				continue;
+			}
+			// pass the stored text so the estimate matches the snapshot exactly
+			const Value &stored = *entry.value;
+			ValueRef value = { stored.type, stored.value.data(), stored.value.size(), 0.0, stored.type == Value::Type::BOOL && stored.value == "true" };
+			onLeaf(key, value);
+		}
+	}
+
+	ShapeReport ShapeAnalyzer::report() const
+	{
+		ShapeReport report = result;
+		std::sort(report.largest.begin(), report.largest.end(), largerShape);
+		return report;
+	}
+
+}
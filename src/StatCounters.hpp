@@ -0,0 +1,69 @@
+#ifndef STATCOUNTERS_HPP
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace luapath
+{
+	/** @brief The counters behind luapath::Stats. Internal to the library */
+	enum class StatCounter
+	{
+		LOADS, LOAD_FAILURES, PARSE_NS, EXECUTE_NS,
+		GC_TUNED_LOADS, LOAD_HEAP_BYTES, STRING_TABLE_SLOTS,
+		SNAPSHOTS, SNAPSHOT_NODES, SNAPSHOT_NS, SNAPSHOT_BYTES,
+		LOOKUPS, LOOKUP_MISSES, CONVERSION_FAILURES,
+		COUNT
+	};
+
+	/** set by luapath::enableStats. Read on every counted operation*/
+	extern std::atomic<bool> statsSwitch;
+
+	/** adds @p amount to the counter of the calling thread. Use countStat*/
+	void addStat(StatCounter counter, std::uint64_t amount);
+
+	/** Adds @p amount to @p counter if stats are enabled. A single relaxed load when they are not*/
+	inline void countStat(StatCounter counter, std::uint64_t amount = 1)
+	{
+		if (statsSwitch.load(std::memory_order_relaxed))
+			addStat(counter, amount);
+	}
+
+	/** @brief Adds the nanoseconds between construction and StatTimer::stop to a counter
+		@details Does not read the clock at all if stats are disabled when it is constructed
+	*/
+	class StatTimer
+	{
+	public:
+		explicit StatTimer(StatCounter counter)
+			: counter(counter), running(statsSwitch.load(std::memory_order_relaxed))
+		{
+			if (running)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~StatTimer()
+		{
+			stop();
+		}
+
+		void stop()
+		{
+			if (!running)
+				return;
+			running = false;
+			addStat(counter, (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count());
+		}
+
+	private:
+		StatTimer(const StatTimer &);
+		StatTimer& operator=(const StatTimer &);
+
+		StatCounter counter;
+		bool running;
+		std::chrono::steady_clock::time_point start;
+	};
+}
+#endif // !STATCOUNTERS_HPP
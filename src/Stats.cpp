@@ -0,0 +1,134 @@
+#include <array>
+#include <sstream>
+
+#include "luapath/Stats.hpp"
+#include "StatCounters.hpp"
+#include "ThreadRegistry.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::uint64_t;
+
+	std::atomic<bool> statsSwitch(false);
+
+	namespace
+	{
+		const std::size_t COUNTER_COUNT = (std::size_t)StatCounter::COUNT;
+
+		/** the names used by the text and JSON dumps, in the order of StatCounter*/
+		const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+			"loads", "load_failures", "parse_ns", "execute_ns",
+			"gc_tuned_loads", "load_heap_bytes", "string_table_slots",
+			"snapshots", "snapshot_nodes", "snapshot_ns", "snapshot_bytes",
+			"lookups", "lookup_misses", "conversion_failures"
+		};
+
+		/** @brief The counters of one thread
+			@details Only the owning thread adds to them. Other threads read them in luapath::stats
+			and clear them in luapath::resetStats which is why they are atomic.
+		*/
+		struct ThreadCounters
+		{
+			std::atomic<uint64_t> values[COUNTER_COUNT];
+
+			ThreadCounters()
+			{
+				for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+					values[i].store(0, std::memory_order_relaxed);
+			}
+		};
+
+		typedef std::array<uint64_t, COUNTER_COUNT> RetiredCounters;
+
+		void retireCounters(RetiredCounters &retired, const ThreadCounters &thread)
+		{
+			for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+				retired[i] += thread.values[i].load(std::memory_order_relaxed);
+		}
+
+		/** @brief Every thread's counters plus the totals of the threads that exited*/
+		typedef ThreadRegistry<ThreadCounters, RetiredCounters, retireCounters> Registry;
+
+		Registry &registry()
+		{
+			return Registry::instance();
+		}
+
+		thread_local Registry::Slot threadCounters;
+
+		/** the members of Stats in the order of StatCounter*/
+		uint64_t Stats::*const COUNTER_MEMBERS[COUNTER_COUNT] = {
+			&Stats::loads, &Stats::loadFailures, &Stats::parseNs, &Stats::executeNs,
+			&Stats::gcTunedLoads, &Stats::loadHeapBytes, &Stats::stringTableSlots,
+			&Stats::snapshots, &Stats::snapshotNodes, &Stats::snapshotNs, &Stats::snapshotBytes,
+			&Stats::lookups, &Stats::lookupMisses, &Stats::conversionFailures
+		};
+	}
+
+	void addStat(StatCounter counter, uint64_t amount)
+	{
+		threadCounters.local.values[(std::size_t)counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	void enableStats(bool enabled)
+	{
+		statsSwitch.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool statsEnabled()
+	{
+		return statsSwitch.load(std::memory_order_relaxed);
+	}
+
+	Stats stats()
+	{
+		Stats result = Stats();
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+		{
+			uint64_t &total = result.*COUNTER_MEMBERS[i];
+			total = reg.retired[i];
+			for (const ThreadCounters *thread : reg.threads)
+				total += thread->values[i].load(std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	void resetStats()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+		{
+			reg.retired[i] = 0;
+			for (ThreadCounters *thread : reg.threads)
+				thread->values[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	string Stats::toText() const
+	{
+		std::ostringstream out;
+		out << *this;
+		return out.str();
+	}
+
+	string Stats::toJson() const
+	{
+		std::ostringstream out;
+		out << "{";
+		for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+			out << (i ? "," : "") << "\"" << COUNTER_NAMES[i] << "\":" << this->*COUNTER_MEMBERS[i];
+		out << "}";
+		return out.str();
+	}
+
+	std::ostream& operator<< (std::ostream& out, const Stats &stats)
+	{
+		for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+			out << COUNTER_NAMES[i] << " " << stats.*COUNTER_MEMBERS[i] << "\n";
+		return out;
+	}
+
+}
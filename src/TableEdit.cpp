@@ -0,0 +1,66 @@
+#include "luapath/TableEdit.hpp"
+#include "luapath/LuaState.hpp"
+#include "luapath/exceptions.hpp"
+#include "SearchPath.hpp"
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		const char EMPTY_PATH_MESSAGE[] = "empty search path parameter not allowed for TableEdit";
+	}
+
+	TableEdit::TableEdit(LuaState &state, const string &tableName)
+		: state(&state), tableName(tableName)
+	{
+
+	}
+
+	TableEdit& TableEdit::set(const string &searchPath, const Value &value)
+	{
+		if (value.type == Value::Type::TABLE)
+			throw type_mismatch_exception("TableEdit can only set string, number or boolean values");
+		Change change = { splitSearchPath(searchPath, EMPTY_PATH_MESSAGE), false, value };
+		changes.push_back(std::move(change));
+		return *this;
+	}
+
+	TableEdit& TableEdit::erase(const string &searchPath)
+	{
+		Change change = { splitSearchPath(searchPath, EMPTY_PATH_MESSAGE), true, Value() };
+		changes.push_back(std::move(change));
+		return *this;
+	}
+
+	void TableEdit::apply()
+	{
+		if (changes.empty())
+			return;
+		std::size_t applied = state->applyEdit(*this);
+		changes.erase(changes.begin(), changes.begin() + applied);
+		if (!changes.empty())
+			throw path_lookup_exception("Found value but not at the end of the search path");
+	}
+
+	std::size_t TableEdit::size() const
+	{
+		return changes.size();
+	}
+
+	bool TableEdit::empty() const
+	{
+		return changes.empty();
+	}
+
+	void TableEdit::clear()
+	{
+		changes.clear();
+	}
+
+	const string &TableEdit::getTableName() const
+	{
+		return tableName;
+	}
+
+}
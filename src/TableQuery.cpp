@@ -0,0 +1,222 @@
+#include "luapath/TableQuery.hpp"
+#include "luapath/exceptions.hpp"
+
+namespace luapath{
+	using std::string;
+
+	namespace
+	{
+		bool isTokenChar(char c)
+		{
+			return c == STRING_TOKEN || c == NUMBER_TOKEN;
+		}
+
+		void appendKey(string &path, const Key &key)
+		{
+			path += key.type == Key::Type::NUMBER ? NUMBER_TOKEN : STRING_TOKEN;
+			path += key.key;
+		}
+
+		/** Narrows [first, last) of the sorted @p set to the keys of type @p type.
+			Relies on number keys always being ordered before string keys*/
+		template<class Set>
+		void typeRange(const Set &set, Key::Type type,
+			typename Set::const_iterator &first, typename Set::const_iterator &last)
+		{
+			typename Set::const_iterator firstString = set.lower_bound(Key(string()));
+			first = type == Key::Type::NUMBER ? set.begin() : firstString;
+			last = type == Key::Type::NUMBER ? firstString : set.end();
+		}
+	}
+
+	TableQuery::TableQuery(const Table &table, const string &pattern)
+		: table(&table), segments(compile(pattern))
+	{
+	}
+
+	std::shared_ptr<const TableQuery::Segments> TableQuery::compile(const string &pattern)
+	{
+		if (pattern.size() == 0)
+			throw path_lookup_exception("empty pattern not allowed for Table::query");
+		string::const_iterator currIndex = pattern.begin();
+		if (!isTokenChar(*currIndex))
+			throw path_lookup_exception("Invalid starting token character");
+
+		std::shared_ptr<Segments> segments = std::make_shared<Segments>();
+		bool recursive = false;
+		while (currIndex != pattern.end())
+		{
+			string::const_iterator startIndex = currIndex + 1;
+			char token = *currIndex;
+			while (++currIndex != pattern.end() && !isTokenChar(*currIndex));
+
+			string field(startIndex, currIndex);
+			if (field.empty())
+			{
+				// ".." marks the following field as recursive, "..name" or "..#2".
+				// Any other empty field is a stray '.'
+				if (token == STRING_TOKEN && !recursive && currIndex != pattern.end() && *currIndex == STRING_TOKEN)
+				{
+					recursive = true;
+					// the second '.' of "..#2" only separates
+					if (currIndex + 1 != pattern.end() && *(currIndex + 1) == NUMBER_TOKEN)
+						++currIndex;
+					continue;
+				}
+				throw path_lookup_exception("Empty field in the query pattern");
+			}
+
+			bool wildcard = field == "*";
+			if (token == NUMBER_TOKEN && !wildcard && !Table::isNumberField(field))
+				throw path_lookup_exception(string("Number field in the query pattern is not an integer - ").append(field));
+
+			Segment segment = { token == NUMBER_TOKEN ? Key(Key::Type::NUMBER, field) : Key(field), wildcard, recursive };
+			segments->push_back(segment);
+			recursive = false;
+		}
+		return segments;
+	}
+
+	bool TableQuery::Segment::matches(const Key &other) const
+	{
+		if (wildcard)
+			return key.type == other.type;
+		return key == other;
+	}
+
+	TableQuery::iterator TableQuery::begin() const
+	{
+		return iterator(*table, segments);
+	}
+
+	TableQuery::iterator TableQuery::end() const
+	{
+		return iterator();
+	}
+
+	TableQuery::iterator::iterator()
+		: current(nullptr)
+	{
+
+	}
+
+	TableQuery::iterator::iterator(const Table &table, const std::shared_ptr<const Segments> &segments)
+		: segments(segments), current(nullptr)
+	{
+		push(table, 0);
+		advance();
+	}
+
+	TableQuery::Match TableQuery::iterator::operator*() const
+	{
+		Match match = { path, *current };
+		return match;
+	}
+
+	TableQuery::iterator& TableQuery::iterator::operator++()
+	{
+		advance();
+		return *this;
+	}
+
+	bool TableQuery::iterator::operator==(const iterator &other) const
+	{
+		return current == other.current;
+	}
+
+	bool TableQuery::iterator::operator!=(const iterator &other) const
+	{
+		return !(*this == other);
+	}
+
+	void TableQuery::iterator::push(const Table &table, std::size_t segmentIndex)
+	{
+		const Segment &segment = (*segments)[segmentIndex];
+		bool last = segmentIndex + 1 == segments->size();
+
+		Frame frame;
+		frame.table = &table;
+		frame.segment = segmentIndex;
+		frame.pathLength = path.size();
+		frame.nestedMatched = false;
+		frame.leafIt = frame.leafEnd = table.leafSet.end();
+		frame.nestedIt = frame.nestedEnd = table.nestedSet.end();
+
+		// only the last segment yields values
+		if (last && segment.wildcard)
+			typeRange(table.leafSet, segment.key.type, frame.leafIt, frame.leafEnd);
+		else if (last)
+		{
+			std::pair<Table::LeafSet::const_iterator, Table::LeafSet::const_iterator> range = table.leafSet.equal_range(segment.key);
+			frame.leafIt = range.first;
+			frame.leafEnd = range.second;
+		}
+
+		// a recursive segment has to look into every nested table
+		if (segment.recursive)
+		{
+			frame.nestedIt = table.nestedSet.begin();
+			frame.nestedEnd = table.nestedSet.end();
+		}
+		else if (!last && segment.wildcard)
+			typeRange(table.nestedSet, segment.key.type, frame.nestedIt, frame.nestedEnd);
+		else if (!last)
+		{
+			std::pair<Table::NestedSet::const_iterator, Table::NestedSet::const_iterator> range = table.nestedSet.equal_range(segment.key);
+			frame.nestedIt = range.first;
+			frame.nestedEnd = range.second;
+		}
+
+		stack.push_back(frame);
+	}
+
+	void TableQuery::iterator::advance()
+	{
+		current = nullptr;
+		while (!stack.empty())
+		{
+			Frame &frame = stack.back();
+			path.resize(frame.pathLength);
+
+			if (frame.leafIt != frame.leafEnd)
+			{
+				appendKey(path, frame.leafIt->first);
+				current = &frame.leafIt->second;
+				++frame.leafIt;
+				return;
+			}
+
+			if (frame.nestedIt == frame.nestedEnd)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			// copy what we need out of the frame as pushing invalidates it
+			const Segment &segment = (*segments)[frame.segment];
+			std::size_t segmentIndex = frame.segment;
+			const Key &childKey = frame.nestedIt->first;
+			const Table &child = frame.nestedIt->second;
+
+			if (!frame.nestedMatched)
+			{
+				frame.nestedMatched = true;
+				if (segmentIndex + 1 < segments->size() && segment.matches(childKey))
+				{
+					appendKey(path, childKey);
+					push(child, segmentIndex + 1);
+					continue;
+				}
+			}
+
+			frame.nestedMatched = false;
+			++frame.nestedIt;
+			if (segment.recursive)
+			{
+				appendKey(path, childKey);
+				push(child, segmentIndex);
+			}
+		}
+	}
+
+}
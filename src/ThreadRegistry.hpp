@@ -0,0 +1,52 @@
+#ifndef THREADREGISTRY_HPP
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace luapath
+{
+	/** @brief The per-thread @p Local data of the running threads plus the @p Retired data of the threads that exited.
+		Internal to the library
+		@details Each thread owns one Slot, declared thread_local by the module. The Slot adds its Local to
+		threads when the thread first touches it and hands it to @p retire under the mutex when the thread exits.
+		Readers lock the mutex and combine retired with the Local of every running thread.
+	*/
+	template <typename Local, typename Retired, void (*retire)(Retired &retired, const Local &local)>
+	struct ThreadRegistry
+	{
+		std::mutex mutex;
+		std::vector<Local*> threads;
+		Retired retired;
+
+		static ThreadRegistry &instance()
+		{
+			// never destroyed so that threads exiting during static destruction can still retire their data
+			static ThreadRegistry *registry = new ThreadRegistry();
+			return *registry;
+		}
+
+		/** @brief The Local of one thread, registered for as long as the thread runs*/
+		struct Slot
+		{
+			Local local;
+
+			Slot()
+			{
+				ThreadRegistry &registry = instance();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				registry.threads.push_back(&local);
+			}
+
+			~Slot()
+			{
+				ThreadRegistry &registry = instance();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				retire(registry.retired, local);
+				registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &local));
+			}
+		};
+	};
+}
+#endif // !THREADREGISTRY_HPP
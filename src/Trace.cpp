@@ -0,0 +1,197 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "luapath/Trace.hpp"
+#include "ThreadRegistry.hpp"
+
+namespace luapath{
+	using std::string;
+	using std::uint64_t;
+
+	namespace
+	{
+		/** events kept per thread. Zones ending after that are counted but dropped*/
+		const std::size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+		struct Event
+		{
+			const char *name;
+			string detail;
+			uint64_t startNs;
+			uint64_t durationNs;
+			unsigned thread;
+		};
+
+		std::atomic<bool> tracingSwitch(false);
+		std::atomic<uint64_t> droppedEvents(0);
+
+		uint64_t nowNs()
+		{
+			// relative to the first call so the timestamps stay small
+			static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+		}
+
+		std::atomic<unsigned> nextThread(0);
+
+		/** @brief The events of one thread
+			@details The mutex is only contended while the trace is written or cleared*/
+		struct ThreadTrace
+		{
+			std::mutex mutex;
+			std::vector<Event> events;
+			unsigned id;
+
+			ThreadTrace()
+				: id(++nextThread)
+			{
+			}
+
+			void record(const char *name, string &&detail, uint64_t startNs, uint64_t durationNs)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (events.size() >= MAX_EVENTS_PER_THREAD)
+				{
+					droppedEvents.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				Event event = { name, std::move(detail), startNs, durationNs, id };
+				events.push_back(std::move(event));
+			}
+		};
+
+		void retireEvents(std::vector<Event> &retired, const ThreadTrace &thread)
+		{
+			retired.insert(retired.end(), thread.events.begin(), thread.events.end());
+		}
+
+		/** @brief The buffers of the running threads plus the events of the threads that exited*/
+		typedef ThreadRegistry<ThreadTrace, std::vector<Event>, retireEvents> Registry;
+
+		Registry &registry()
+		{
+			return Registry::instance();
+		}
+
+		thread_local Registry::Slot threadTrace;
+
+		void writeEscaped(std::ostream &out, const char *text, std::size_t length)
+		{
+			static const char HEX[] = "0123456789abcdef";
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				unsigned char c = (unsigned char)text[i];
+				if (c == '"' || c == '\\')
+					out << '\\' << (char)c;
+				else if (c < 0x20)
+					out << "\\u00" << HEX[c >> 4] << HEX[c & 0xF];
+				else
+					out << (char)c;
+			}
+		}
+
+		/** timestamps in the trace_event format are microseconds*/
+		void writeMicros(std::ostream &out, uint64_t ns)
+		{
+			out << ns / 1000 << '.' << (char)('0' + ns / 100 % 10) << (char)('0' + ns / 10 % 10) << (char)('0' + ns % 10);
+		}
+
+		void writeEvent(std::ostream &out, const Event &event, bool first)
+		{
+			out << (first ? "\n" : ",\n") << "{\"name\":\"";
+			writeEscaped(out, event.name, std::char_traits<char>::length(event.name));
+			out << "\",\"cat\":\"luapath\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+			writeMicros(out, event.startNs);
+			out << ",\"dur\":";
+			writeMicros(out, event.durationNs);
+			if (!event.detail.empty())
+			{
+				out << ",\"args\":{\"detail\":\"";
+				writeEscaped(out, event.detail.data(), event.detail.size());
+				out << "\"}";
+			}
+			out << "}";
+		}
+	}
+
+	void startTracing()
+	{
+		nowNs();
+		tracingSwitch.store(true, std::memory_order_relaxed);
+	}
+
+	void stopTracing()
+	{
+		tracingSwitch.store(false, std::memory_order_relaxed);
+	}
+
+	bool tracing()
+	{
+		return tracingSwitch.load(std::memory_order_relaxed);
+	}
+
+	void clearTrace()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.retired.clear();
+		droppedEvents.store(0, std::memory_order_relaxed);
+		for (ThreadTrace *thread : reg.threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mutex);
+			thread->events.clear();
+		}
+	}
+
+	void writeChromeTrace(std::ostream &out)
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		bool first = true;
+		out << "{\"traceEvents\":[";
+		for (const Event &event : reg.retired)
+		{
+			writeEvent(out, event, first);
+			first = false;
+		}
+		for (ThreadTrace *thread : reg.threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mutex);
+			for (const Event &event : thread->events)
+			{
+				writeEvent(out, event, first);
+				first = false;
+			}
+		}
+		out << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":" << droppedEvents.load(std::memory_order_relaxed) << "}}\n";
+	}
+
+	TraceZone::TraceZone(const char *name)
+		: name(name), startNs(0), recording(tracingSwitch.load(std::memory_order_relaxed))
+	{
+		if (recording)
+			startNs = nowNs();
+	}
+
+	TraceZone::TraceZone(const char *name, const string &detail)
+		: name(name), startNs(0), recording(tracingSwitch.load(std::memory_order_relaxed))
+	{
+		if (recording)
+		{
+			this->detail = detail;
+			startNs = nowNs();
+		}
+	}
+
+	TraceZone::~TraceZone()
+	{
+		if (recording)
+		{
+			uint64_t endNs = nowNs();
+			threadTrace.local.record(name, std::move(detail), startNs, endNs - startNs);
+		}
+	}
+
+}
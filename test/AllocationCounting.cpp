@@ -0,0 +1,164 @@
+#include "AllocationCounting.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Every allocating and deallocating form is replaced so that memory always goes from malloc to
+// free. Replacing only some of them mixes the library's allocator with ours, e.g. a nothrow new
+// from std::get_temporary_buffer freed by the replaced delete.
+
+namespace
+{
+	thread_local std::uint64_t allocationCount = 0;
+	thread_local std::uint64_t allocationBytes = 0;
+
+	void *countedAlloc(std::size_t size) noexcept
+	{
+		++allocationCount;
+		allocationBytes += size;
+		return std::malloc(size ? size : 1);
+	}
+
+	void *countedAllocOrThrow(std::size_t size)
+	{
+		void *ptr = countedAlloc(size);
+		if (!ptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+
+#if defined(__cpp_aligned_new) && !defined(_WIN32)
+	void *countedAlignedAlloc(std::size_t size, std::align_val_t alignment) noexcept
+	{
+		++allocationCount;
+		allocationBytes += size;
+		std::size_t align = static_cast<std::size_t>(alignment);
+		if (align < sizeof(void*))
+			align = sizeof(void*);
+		void *ptr = nullptr;
+		if (posix_memalign(&ptr, align, size ? size : 1) != 0)
+			return nullptr;
+		return ptr;
+	}
+
+	void *countedAlignedAllocOrThrow(std::size_t size, std::align_val_t alignment)
+	{
+		void *ptr = countedAlignedAlloc(size, alignment);
+		if (!ptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+#endif
+}
+
+std::uint64_t threadAllocationCount()
+{
+	return allocationCount;
+}
+
+std::uint64_t threadAllocationBytes()
+{
+	return allocationBytes;
+}
+
+void *operator new(std::size_t size)
+{
+	return countedAllocOrThrow(size);
+}
+
+void *operator new[](std::size_t size)
+{
+	return countedAllocOrThrow(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+#if defined(__cpp_aligned_new) && !defined(_WIN32)
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+	return countedAlignedAllocOrThrow(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return countedAlignedAllocOrThrow(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	return countedAlignedAlloc(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	return countedAlignedAlloc(size, alignment);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
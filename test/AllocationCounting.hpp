@@ -0,0 +1,15 @@
+#ifndef ALLOCATIONCOUNTING_HPP
+#pragma once
+
+#include <cstdint>
+
+/** @brief The calls to the global operator new made by the current thread so far
+	@details AllocationCounting.cpp replaces every form of the global operator new and delete
+	with malloc and free, counting the allocations. The unit tests and luapath_bench both link it.
+*/
+std::uint64_t threadAllocationCount();
+
+/** @brief The bytes requested from the global operator new by the current thread so far*/
+std::uint64_t threadAllocationBytes();
+
+#endif // !ALLOCATIONCOUNTING_HPP
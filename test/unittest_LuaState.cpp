@@ -1,3 +1,13 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
 #include "utils.hpp"
 #include "luapath/luapath.hpp"
 
@@ -202,6 +212,18 @@ BOOST_AUTO_TEST_CASE(readTableValuesThrows)
 
 }
 
+BOOST_AUTO_TEST_CASE(readCyclicTableThrows)
+{
+	//a snapshot of a table which contains itself throws instead of overflowing the C stack
+	state.loadString("t = {a=1} t.self = t");
+	BOOST_CHECK_THROW(state.getGlobalTable("t"), lua_state_exception);
+	BOOST_CHECK_THROW(state.getGlobals(), lua_state_exception);
+	//the stack is left as it was
+	BOOST_CHECK_EQUAL((string)state.getGlobalValue("str1"), "hello");
+	state.loadString("t = nil");
+	BOOST_CHECK_EQUAL((string)state.getGlobals().getValue(".str1"), "hello");
+}
+
 BOOST_AUTO_TEST_CASE(readTableValuesReturnFalse)
 {
 	Table cars = state.getGlobalTable("cars");
@@ -257,4 +279,1442 @@ BOOST_AUTO_TEST_CASE(readTableArraysThrows)
 	BOOST_CHECK_THROW(arrays.getTable("#10").toArray<bool>(), type_mismatch_exception);
 }
 
-BOOST_AUTO_TEST_SUITE_END();
\ No newline at end of file
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(queryValues, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(queryWildcards)
+{
+	Table company = state.getGlobalTable("company");
+	vector<string> paths;
+	vector<string> cities;
+	for (TableQuery::Match match : company.query(".buildings#*.city"))
+	{
+		paths.push_back(match.path);
+		cities.push_back(match.value);
+	}
+	BOOST_REQUIRE_EQUAL(cities.size(), 2u);
+	BOOST_CHECK_EQUAL(paths[0], ".buildings#1.city");
+	BOOST_CHECK_EQUAL(cities[0], "Dublin");
+	BOOST_CHECK_EQUAL(paths[1], ".buildings#2.city");
+	BOOST_CHECK_EQUAL(cities[1], "Carlow");
+
+	//string wildcard does not match number keys
+	Table cars = state.getGlobalTable("cars");
+	vector<string> carPaths;
+	for (TableQuery::Match match : cars.query(".*.price"))
+		carPaths.push_back(match.path);
+	BOOST_REQUIRE_EQUAL(carPaths.size(), 2u);
+	BOOST_CHECK_EQUAL(carPaths[0], ".bmw.price");
+	BOOST_CHECK_EQUAL(carPaths[1], ".honda.price");
+
+	TableQuery numberedQuery = cars.query("#*.price");
+	TableQuery::iterator numbered = numberedQuery.begin();
+	BOOST_REQUIRE(numbered != numberedQuery.end());
+	BOOST_CHECK_EQUAL((*numbered).path, "#5.price");
+	BOOST_CHECK(++numbered == numberedQuery.end());
+
+	//the iterator keeps the pattern alive on its own
+	TableQuery::iterator detached;
+	{
+		TableQuery scoped = cars.query(".*.price");
+		detached = scoped.begin();
+	}
+	BOOST_CHECK_EQUAL((*detached).path, ".bmw.price");
+	BOOST_CHECK_EQUAL((*++detached).path, ".honda.price");
+	BOOST_CHECK(++detached == TableQuery::iterator());
+
+	BOOST_CHECK(cars.query(".NON_EXISTANT#*").begin() == cars.query(".NON_EXISTANT#*").end());
+}
+
+BOOST_AUTO_TEST_CASE(queryRecursive)
+{
+	Table superStructure = state.getGlobalTable("superStructure");
+	TableQuery query = superStructure.query("..5");
+	TableQuery::iterator it = query.begin();
+	BOOST_REQUIRE(it != query.end());
+	BOOST_CHECK_EQUAL((*it).path, "#1.level2#3.4.5");
+	BOOST_CHECK_EQUAL((int)(*it).value, 6);
+	BOOST_CHECK(++it == query.end());
+
+	//every city at any depth
+	int cities = 0;
+	Table company = state.getGlobalTable("company");
+	for (TableQuery::Match match : company.query("..city"))
+	{
+		BOOST_CHECK(!((string)match.value).empty());
+		++cities;
+	}
+	BOOST_CHECK_EQUAL(cities, 2);
+
+	//recursive number fields are written "..#n"
+	vector<string> seconds;
+	for (TableQuery::Match match : company.query("..#2"))
+		seconds.push_back(match.path);
+	BOOST_REQUIRE_EQUAL(seconds.size(), 2u);
+	BOOST_CHECK_EQUAL(seconds[0], "#1#2");
+	BOOST_CHECK_EQUAL(seconds[1], ".buildings#1.bosses#2");
+
+	//every number keyed value at any depth
+	int arrayValues = 0;
+	for (TableQuery::Match match : superStructure.query("..*.arrays#10#*"))
+	{
+		(void)match;
+		++arrayValues;
+	}
+	BOOST_CHECK_EQUAL(arrayValues, 5);
+}
+
+BOOST_AUTO_TEST_CASE(queryThrows)
+{
+	Table cars = state.getGlobalTable("cars");
+	BOOST_CHECK_THROW(cars.query(""), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query("Wrong"), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query("#5.."), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query("...class"), path_lookup_exception);
+	//a recursive number field needs both dots
+	BOOST_CHECK_THROW(cars.query(".#1"), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query("#5.#2"), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query(".a.#2"), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query("...#2"), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query(".."), path_lookup_exception);
+	BOOST_CHECK_THROW(cars.query("#five"), path_lookup_exception);
+	//wildcards are only allowed when querying
+	BOOST_CHECK_THROW(cars.getValue("#*.price"), path_lookup_exception);
+}
+BOOST_AUTO_TEST_SUITE_END();
+
+struct recordingVisitor
+	: public TableVisitor
+{
+	recordingVisitor()
+		: depth(0), maxDepth(0), tables(0), leaves(0)
+	{
+	}
+	void onEnterTable(const KeyRef &key)
+	{
+		if (key.type == Key::Type::STRING)
+			path.push_back(string(key.data, key.length));
+		else
+			path.push_back("#" + std::to_string(key.index));
+		++tables;
+		maxDepth = std::max(maxDepth, ++depth);
+	}
+	void onLeaf(const KeyRef &key, const ValueRef &value)
+	{
+		++leaves;
+		if (key.type == Key::Type::STRING && value.type == Value::Type::STRING)
+			strings[path.back() + "." + string(key.data, key.length)] = string(value.data, value.length);
+		else if (value.type == Value::Type::NUMBER)
+			numbers.push_back(value.number);
+	}
+	void onExitTable()
+	{
+		--depth;
+		path.pop_back();
+	}
+	int depth;
+	int maxDepth;
+	int tables;
+	int leaves;
+	vector<string> path;
+	std::map<string, string> strings;
+	vector<double> numbers;
+};
+
+BOOST_FIXTURE_TEST_SUITE(visitTables, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(visitGlobalTable)
+{
+	recordingVisitor visitor;
+	state.visitGlobalTable("company", visitor);
+	BOOST_CHECK_EQUAL(visitor.depth, 0);
+	BOOST_CHECK_EQUAL(visitor.maxDepth, 4);
+	// company, buildings, 2 buildings, bosses, empty and {1,2,3}
+	BOOST_CHECK_EQUAL(visitor.tables, 7);
+	BOOST_CHECK_EQUAL(visitor.strings["company.what"], "Business");
+	BOOST_CHECK_EQUAL(visitor.strings["#1.city"], "Dublin");
+	BOOST_CHECK_EQUAL(visitor.strings["#2.city"], "Carlow");
+	BOOST_CHECK(std::find(visitor.numbers.begin(), visitor.numbers.end(), 2014.0) != visitor.numbers.end());
+
+	//the same number of leaves as the snapshot holds
+	Table company = state.getGlobalTable("company");
+	int snapshotLeaves = 0;
+	for (TableQuery::Match match : company.query("..*"))
+	{
+		(void)match;
+		++snapshotLeaves;
+	}
+	for (TableQuery::Match match : company.query("..#*"))
+	{
+		(void)match;
+		++snapshotLeaves;
+	}
+	BOOST_CHECK_EQUAL(visitor.leaves, snapshotLeaves);
+}
+
+BOOST_AUTO_TEST_CASE(visitGlobalTableThrows)
+{
+	recordingVisitor visitor;
+	BOOST_CHECK_THROW(state.visitGlobalTable("nonExistent", visitor), path_lookup_exception);
+	BOOST_CHECK_THROW(state.visitGlobalTable("N1", visitor), type_mismatch_exception);
+	//the state is still usable afterwards
+	BOOST_CHECK_EQUAL((string)state.getGlobalValue("str1"), "hello");
+
+	//cycles and very deep nesting throw instead of overflowing the C stack
+	state.loadString("cyclic = {} cyclic.self = cyclic "
+		"local t = {} deep = t for i = 1, 2000 do t.next = {} t = t.next end");
+	BOOST_CHECK_THROW(state.visitGlobalTable("cyclic", visitor), lua_state_exception);
+	BOOST_CHECK_THROW(state.visitGlobalTable("deep", visitor), lua_state_exception);
+	BOOST_CHECK_EQUAL((string)state.getGlobalValue("str1"), "hello");
+}
+
+struct countingVisitor
+	: public TableVisitor
+{
+	countingVisitor()
+		: tables(0), leaves(0), bytes(0)
+	{
+	}
+	void onEnterTable(const KeyRef &)
+	{
+		++tables;
+	}
+	void onLeaf(const KeyRef &key, const ValueRef &value)
+	{
+		++leaves;
+		bytes += key.length + value.length;
+	}
+	void onExitTable()
+	{
+	}
+	int tables;
+	int leaves;
+	std::size_t bytes;
+};
+
+BOOST_AUTO_TEST_CASE(visitNoAllocations)
+{
+	countingVisitor visitor;
+	string name = "superStructure";
+	AllocationCounter counter;
+	state.visitGlobalTable(name, visitor);
+	BOOST_CHECK_EQUAL(counter.count(), 0u);
+	BOOST_CHECK_GT(visitor.leaves, 20);
+	BOOST_CHECK_GT(visitor.bytes, 0u);
+}
+BOOST_AUTO_TEST_SUITE_END();
+
+BOOST_FIXTURE_TEST_SUITE(iterateTables, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(keyOrder)
+{
+	// number keys by value and before every string key, string keys by text
+	BOOST_CHECK(Key(9) < Key(10));
+	BOOST_CHECK(Key(-10) < Key(-9));
+	BOOST_CHECK(Key(2147483647) < Key("0"));
+	BOOST_CHECK(!(Key("0") < Key(-2147483647 - 1)));
+	BOOST_CHECK(Key("10") < Key("9"));
+	BOOST_CHECK(!(Key(7) < Key(7)));
+}
+BOOST_AUTO_TEST_CASE(iterateEntries)
+{
+	Table company = state.getGlobalTable("company");
+	BOOST_CHECK_EQUAL((string)company.getKey(), "company");
+	// [1], [-1] and 8 string keys
+	BOOST_CHECK_EQUAL(company.size(), 10u);
+	BOOST_CHECK(!company.empty());
+	BOOST_CHECK(company.getTable(".empty").empty());
+	BOOST_CHECK(company.contains(Key("buildings")));
+	BOOST_CHECK(company.contains(Key("what")));
+	BOOST_CHECK(company.contains(Key(-1)));
+	BOOST_CHECK(!company.contains(Key("money")));
+	BOOST_CHECK(!company.contains(Key(Key::Type::STRING, "-1")));
+
+	vector<Key> keys;
+	std::size_t tables = 0;
+	for (Table::Entry entry : company)
+	{
+		keys.push_back(entry.key);
+		if (entry.isTable())
+		{
+			BOOST_CHECK(entry.value == nullptr);
+			BOOST_CHECK(entry.table->getKey() == entry.key);
+			++tables;
+		}
+		else
+			BOOST_CHECK(entry.value != nullptr);
+	}
+	BOOST_REQUIRE_EQUAL(keys.size(), company.size());
+	BOOST_CHECK(std::is_sorted(keys.begin(), keys.end()));
+	BOOST_CHECK(keys.front() == Key(-1));
+	BOOST_CHECK_EQUAL(tables, 3u);
+
+	std::size_t leaves = 0;
+	for (const Table::LeafSet::value_type &leaf : company.leaves())
+	{
+		BOOST_CHECK(leaf.second.type != Value::Type::TABLE);
+		++leaves;
+	}
+	std::size_t nested = 0;
+	for (const Table::NestedSet::value_type &table : company.tables())
+	{
+		BOOST_CHECK(table.first == table.second.getKey());
+		++nested;
+	}
+	BOOST_CHECK_EQUAL(leaves + nested, company.size());
+	BOOST_CHECK_EQUAL(nested, tables);
+	BOOST_CHECK(company.getTable(".empty").entries().empty());
+}
+BOOST_AUTO_TEST_SUITE_END();
+
+struct luaStateLargeFixture
+{
+	luaStateLargeFixture()
+		: entries(20000)
+	{
+		string source = "large = {\n";
+		for (int i = 1; i <= entries; ++i)
+		{
+			source += "\t{ name = \"n" + std::to_string(i % 100) + "\", value = " + std::to_string(i) +
+				", flag = true, [\"aVeryLongKeyThatDoesNotFitInPlace\"] = \"" + std::to_string(i) + "\" },\n";
+		}
+		source += "}\n";
+		state.loadString(source);
+	}
+	int entries;
+	luapath::LuaState state;
+};
+
+BOOST_FIXTURE_TEST_SUITE(snapshotAllocations, luaStateLargeFixture);
+BOOST_AUTO_TEST_CASE(snapshotAllocatesAtMostOncePerNode)
+{
+	std::size_t allocations;
+	{
+		AllocationCounter counter;
+		Table large = state.getGlobalTable("large");
+		allocations = counter.count();
+		BOOST_REQUIRE_EQUAL(large.size(), (std::size_t)entries);
+		BOOST_CHECK_EQUAL((string)large.getValue("#20000.aVeryLongKeyThatDoesNotFitInPlace"), "20000");
+		BOOST_CHECK_EQUAL((int)large.getValue("#42.value"), 42);
+	}
+	// the root, one table and four leaves per entry
+	std::size_t nodes = 1 + 5 * (std::size_t)entries;
+	BOOST_TEST_MESSAGE("snapshot allocations per node: " << (double)allocations / nodes);
+	// every nested table allocates its leaf set and the long key once
+	BOOST_CHECK_LE(allocations, 2 * (std::size_t)entries + 2);
+	BOOST_CHECK_LE(allocations, nodes);
+}
+
+BOOST_AUTO_TEST_CASE(snapshotFootprint)
+{
+	Table large = state.getGlobalTable("large");
+	Table::Footprint footprint = large.footprint();
+	BOOST_CHECK_EQUAL(footprint.tables, (std::size_t)entries + 1);
+	BOOST_CHECK_EQUAL(footprint.leaves, 4 * (std::size_t)entries);
+	BOOST_CHECK_EQUAL(footprint.leafNodeBytes, 4 * entries * sizeof(Table::LeafSet::value_type));
+	BOOST_CHECK_EQUAL(footprint.nestedTableBytes, entries * sizeof(Table::NestedSet::value_type));
+	// only the long key doesn't fit in place
+	BOOST_CHECK_GE(footprint.keyStringBytes, entries * sizeof("aVeryLongKeyThatDoesNotFitInPlace") - entries);
+	BOOST_CHECK_EQUAL(footprint.valueStringBytes, 0u);
+	BOOST_CHECK_GT(state.heapSize(), 0u);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(runtimeStats, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(statsCountOperations)
+{
+	enableStats(true);
+	resetStats();
+	state.loadString(testString);
+	Table cars = state.getGlobalTable("cars");
+	cars.getValue(".bmw.price");
+	Value dummy;
+	BOOST_CHECK(!cars.getValue(".NON_EXISTANT", dummy));
+	BOOST_CHECK_THROW(cars.getTable(".NON_EXISTANT"), path_lookup_exception);
+	BOOST_CHECK_THROW((int)Value(Value::Type::STRING, "abc"), type_mismatch_exception);
+	enableStats(false);
+	// nothing is counted once disabled
+	cars.getValue(".bmw.price");
+
+	Stats counters = stats();
+	BOOST_CHECK_EQUAL(counters.loads, 1u);
+	BOOST_CHECK_EQUAL(counters.loadFailures, 0u);
+	BOOST_CHECK_EQUAL(counters.snapshots, 1u);
+	// the root table is not a node of the snapshot
+	BOOST_CHECK_EQUAL(counters.snapshotNodes, cars.footprint().leaves + cars.footprint().tables - 1);
+	BOOST_CHECK_EQUAL(counters.snapshotBytes, cars.footprint().totalBytes());
+	BOOST_CHECK_EQUAL(counters.lookups, 3u);
+	BOOST_CHECK_EQUAL(counters.lookupMisses, 2u);
+	BOOST_CHECK_EQUAL(counters.conversionFailures, 1u);
+	BOOST_CHECK(counters.toJson().find("\"lookup_misses\":2") != string::npos);
+	BOOST_CHECK(counters.toText().find("loads 1\n") != string::npos);
+
+	resetStats();
+	BOOST_CHECK_EQUAL(stats().lookups, 0u);
+}
+BOOST_AUTO_TEST_CASE(statsAggregateThreads)
+{
+	state.loadString(testString);
+	Table cars = state.getGlobalTable("cars");
+	enableStats(true);
+	resetStats();
+	std::thread reader([&cars]() {
+		for (int i = 0; i < 100; ++i)
+			cars.getValue(".bmw.price");
+	});
+	reader.join();
+	cars.getValue(".bmw.price");
+	enableStats(false);
+	// the exited thread's counts are kept
+	BOOST_CHECK_EQUAL(stats().lookups, 101u);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(traceZones, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(writeChromeTraceEvents)
+{
+	clearTrace();
+	{
+		TraceZone ignored("ignored");
+	}
+	startTracing();
+	{
+		TraceZone outer("outer", "config \"main\"");
+		TraceZone inner("inner");
+	}
+	state.loadString(testString);
+	state.getGlobalTable("cars").getValue(".bmw.price");
+	stopTracing();
+
+	std::ostringstream out;
+	writeChromeTrace(out);
+	string json = out.str();
+	BOOST_CHECK(json.find("\"traceEvents\":[") != string::npos);
+	BOOST_CHECK(json.find("\"name\":\"outer\"") != string::npos);
+	BOOST_CHECK(json.find("\"name\":\"inner\"") != string::npos);
+	BOOST_CHECK(json.find("\"args\":{\"detail\":\"config \\\"main\\\"\"}") != string::npos);
+	BOOST_CHECK(json.find("\"ph\":\"X\"") != string::npos);
+	// only zones started while tracing are recorded
+	BOOST_CHECK(json.find("ignored") == string::npos);
+#ifdef LUAPATH_ENABLE_TRACING
+	BOOST_CHECK(json.find("\"name\":\"LuaState::loadString\"") != string::npos);
+	BOOST_CHECK(json.find("\"name\":\"execute\"") != string::npos);
+	BOOST_CHECK(json.find("\"detail\":\"cars\"") != string::npos);
+	BOOST_CHECK(json.find("\"detail\":\".bmw.price\"") != string::npos);
+#endif
+
+	clearTrace();
+	std::ostringstream empty;
+	writeChromeTrace(empty);
+	BOOST_CHECK(empty.str().find("outer") == string::npos);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(scriptProfiler, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(profileFoldedStacks)
+{
+	ScriptProfiler profiler(100);
+	LoadOptions options;
+	options.profiler = &profiler;
+	state.loadString(
+		"local function buildName(i)\n"
+		"	local s = ''\n"
+		"	for j = 1, 20 do s = s .. (i + j) end\n"
+		"	return s\n"
+		"end\n"
+		"names = {}\n"
+		"for i = 1, 2000 do names[i] = buildName(i) end\n", options);
+	BOOST_REQUIRE(state.isLoaded());
+	BOOST_CHECK(profiler.sampleCount() > 0);
+
+	std::ostringstream out;
+	profiler.writeFolded(out);
+	std::istringstream lines(out.str());
+	string line;
+	std::uint64_t total = 0;
+	bool sawFunction = false;
+	while (std::getline(lines, line))
+	{
+		std::size_t space = line.rfind(' ');
+		BOOST_REQUIRE(space != string::npos);
+		BOOST_CHECK(line.compare(0, 10, "main chunk") == 0);
+		total += std::stoull(line.substr(space + 1));
+		sawFunction = sawFunction || line.find(";buildName (") != string::npos;
+	}
+	BOOST_CHECK_EQUAL(total, profiler.sampleCount());
+	BOOST_CHECK(sawFunction);
+
+	// the hook is gone after the load
+	std::uint64_t samples = profiler.sampleCount();
+	state.loadString("for i = 1, 100000 do end");
+	BOOST_CHECK_EQUAL(profiler.sampleCount(), samples);
+}
+BOOST_AUTO_TEST_CASE(profileFailedLoad)
+{
+	ScriptProfiler profiler(10);
+	LoadOptions options;
+	options.profiler = &profiler;
+	BOOST_CHECK_THROW(state.loadString("for i = 1, 1000 do end error('boom')", options), lua_state_exception);
+	BOOST_CHECK(profiler.sampleCount() > 0);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE(lookupLatency);
+BOOST_AUTO_TEST_CASE(histogramPercentiles)
+{
+	LatencyHistogram histogram;
+	BOOST_CHECK_EQUAL(histogram.percentile(99), 0u);
+	for (std::uint64_t ns = 1; ns <= 1000; ++ns)
+		histogram.record(ns);
+	BOOST_CHECK_EQUAL(histogram.count(), 1000u);
+	BOOST_CHECK_EQUAL(histogram.min(), 1u);
+	BOOST_CHECK_EQUAL(histogram.max(), 1000u);
+	BOOST_CHECK_CLOSE(histogram.mean(), 500.5, 0.001);
+	// exact below 128ns, within 1.6% above
+	BOOST_CHECK_EQUAL(histogram.percentile(10), 100u);
+	BOOST_CHECK_CLOSE((double)histogram.percentile(50), 500.0, 1.6);
+	BOOST_CHECK_CLOSE((double)histogram.percentile(99), 990.0, 1.6);
+	BOOST_CHECK_EQUAL(histogram.percentile(100), 1000u);
+
+	LatencyHistogram slow;
+	slow.record(5000000000ull);
+	histogram.merge(slow);
+	BOOST_CHECK_EQUAL(histogram.count(), 1001u);
+	BOOST_CHECK_EQUAL(histogram.max(), 5000000000ull);
+	BOOST_CHECK_CLOSE((double)histogram.percentile(100), 5e9, 1.6);
+}
+BOOST_FIXTURE_TEST_CASE(histogramsByPrefixAndSite, luaStateLoadedFixture)
+{
+	Table cars = state.getGlobalTable("cars");
+	Table superStructure = state.getGlobalTable("superStructure");
+	enableLatencyHistograms(true);
+	resetLatencyHistograms();
+	cars.getValue(".bmw.price");
+	cars.getValue(".bmw.price");
+	Value dummy;
+	cars.getValue(".bmw.NON_EXISTANT", dummy);
+	{
+		LookupSite site("deepLookup");
+		superStructure.getValue("#1.level2#3.4.5");
+	}
+	state.getGlobalValue("N1");
+	enableLatencyHistograms(false);
+	cars.getValue(".bmw.price");
+
+	std::map<string, LatencyHistogram> sites = latencyHistograms();
+	BOOST_REQUIRE_EQUAL(sites.size(), 4u);
+	BOOST_CHECK_EQUAL(sites["getValue cars.bmw.price"].count(), 2u);
+	BOOST_CHECK_EQUAL(sites["getValue cars.bmw.NON_EXISTANT"].count(), 1u);
+	BOOST_CHECK_EQUAL(sites["deepLookup"].count(), 1u);
+	BOOST_CHECK_EQUAL(sites["getGlobalValue N1"].count(), 1u);
+	BOOST_CHECK(sites["deepLookup"].max() > 0);
+
+	std::ostringstream report;
+	writeLatencyReport(report);
+	BOOST_CHECK(report.str().find("deepLookup") != string::npos);
+	resetLatencyHistograms();
+	BOOST_CHECK(latencyHistograms().empty());
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(shapeAnalyzer, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(analyzeSnapshotAndLiveTable)
+{
+	Table company = state.getGlobalTable("company");
+	ShapeAnalyzer fromSnapshot(3);
+	fromSnapshot.analyze(company);
+	ShapeReport snapshot = fromSnapshot.report();
+
+	Table::Footprint footprint = company.footprint();
+	BOOST_CHECK_EQUAL(snapshot.root.path, "company");
+	BOOST_CHECK_EQUAL(snapshot.root.leaves, footprint.leaves);
+	BOOST_CHECK_EQUAL(snapshot.root.tables + 1, footprint.tables);
+	BOOST_CHECK_EQUAL(snapshot.root.numberKeys + snapshot.root.stringKeys, footprint.leaves + footprint.tables - 1);
+	BOOST_CHECK(snapshot.root.depth > 1);
+	BOOST_CHECK(snapshot.root.estimatedBytes > 0);
+
+	BOOST_REQUIRE(!snapshot.largest.empty());
+	BOOST_CHECK(snapshot.largest.size() <= 3u);
+	for (std::size_t i = 1; i < snapshot.largest.size(); ++i)
+		BOOST_CHECK(snapshot.largest[i - 1].estimatedBytes >= snapshot.largest[i].estimatedBytes);
+	BOOST_CHECK(snapshot.largest[0].path.compare(0, 8, "company.") == 0);
+
+	// walking the lua table directly gives the same answer without a snapshot
+	ShapeAnalyzer fromState(3);
+	state.visitGlobalTable("company", fromState);
+	ShapeReport live = fromState.report();
+	BOOST_CHECK_EQUAL(live.root.leaves, snapshot.root.leaves);
+	BOOST_CHECK_EQUAL(live.root.tables, snapshot.root.tables);
+	BOOST_CHECK_EQUAL(live.root.depth, snapshot.root.depth);
+	BOOST_CHECK_EQUAL(live.root.stringBytes, snapshot.root.stringBytes);
+	BOOST_CHECK_EQUAL(live.root.estimatedBytes, snapshot.root.estimatedBytes);
+	BOOST_CHECK_EQUAL(live.strings, snapshot.strings);
+	BOOST_CHECK_EQUAL(live.duplicatedStrings, snapshot.duplicatedStrings);
+
+	std::ostringstream text;
+	snapshot.write(text);
+	BOOST_CHECK(text.str().compare(0, 8, "company:") == 0);
+	BOOST_CHECK(snapshot.toJson().find("\"root\":{\"path\":\"company\"") != string::npos);
+}
+BOOST_AUTO_TEST_CASE(analyzeDuplicatedStrings)
+{
+	LuaState local;
+	local.loadString("t = { { name = 'same' }, { name = 'same' }, { name = 'other' } }");
+	ShapeAnalyzer analyzer;
+	analyzer.analyze(local.getGlobalTable("t"));
+	ShapeReport report = analyzer.report();
+	// 3 "name" keys and 3 values of which "name" twice and "same" once are repeats
+	BOOST_CHECK_EQUAL(report.strings, 6u);
+	BOOST_CHECK_EQUAL(report.duplicatedStrings, 3u);
+	BOOST_CHECK_EQUAL(report.duplicatedStringBytes, 12u);
+	BOOST_CHECK_EQUAL(report.root.numberKeys, 3u);
+	BOOST_CHECK_EQUAL(report.root.stringKeys, 3u);
+	BOOST_CHECK_EQUAL(report.largest.size(), 3u);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(accessProfile, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(recordAndSaveProfile)
+{
+	Table cars = state.getGlobalTable("cars");
+	clearAccessRecording();
+	startAccessRecording();
+	for (int i = 0; i < 3; ++i)
+		cars.getValue(".bmw.price");
+	cars.getValue("#5.price");
+	Value dummy;
+	cars.getValue(".honda.NON_EXISTANT", dummy);
+	cars.getTable(".honda");
+	stopAccessRecording();
+	cars.getValue(".bmw.price");
+
+	AccessProfile profile = AccessProfile::capture(cars);
+	BOOST_CHECK_EQUAL(profile.count(""), 6u);
+	BOOST_CHECK_EQUAL(profile.count(".bmw"), 3u);
+	BOOST_CHECK_EQUAL(profile.count(".bmw.price"), 3u);
+	BOOST_CHECK_EQUAL(profile.count("#5"), 1u);
+	BOOST_CHECK_EQUAL(profile.count(".honda"), 2u);
+	BOOST_CHECK_EQUAL(profile.count(".honda.price"), 0u);
+	BOOST_CHECK_EQUAL(profile.size(), 6u);
+
+	std::stringstream saved;
+	profile.save(saved);
+	BOOST_CHECK(saved.str().find("6 \n3 .bmw\n3 .bmw.price\n") != string::npos);
+	AccessProfile loaded = AccessProfile::load(saved);
+	BOOST_CHECK_EQUAL(loaded.size(), profile.size());
+	BOOST_CHECK_EQUAL(loaded.count(".bmw.price"), 3u);
+	loaded.merge(profile);
+	BOOST_CHECK_EQUAL(loaded.count(".bmw.price"), 6u);
+
+	std::istringstream junk("not a profile\n");
+	BOOST_CHECK_THROW(AccessProfile::load(junk), std::runtime_error);
+	clearAccessRecording();
+	BOOST_CHECK_EQUAL(AccessProfile::capture(cars).size(), 0u);
+}
+BOOST_AUTO_TEST_CASE(relayoutKeepsContents)
+{
+	Table company = state.getGlobalTable("company");
+	clearAccessRecording();
+	startAccessRecording();
+	company.getValue(".buildings#2.city");
+	stopAccessRecording();
+	Table relaid = company.relayout(AccessProfile::capture(company));
+	clearAccessRecording();
+
+	std::ostringstream original, copy;
+	original << company;
+	copy << relaid;
+	BOOST_CHECK_EQUAL(original.str(), copy.str());
+	BOOST_CHECK_EQUAL(relaid.getKey(), company.getKey());
+	BOOST_CHECK_EQUAL((string)relaid.getValue(".buildings#2.city"), (string)company.getValue(".buildings#2.city"));
+	BOOST_CHECK_EQUAL(relaid.footprint().leaves, company.footprint().leaves);
+	BOOST_CHECK_EQUAL(relaid.footprint().tables, company.footprint().tables);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(loadBudgets, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(instructionBudget)
+{
+	LoadOptions options;
+	options.instructionBudget = 100000;
+	state.loadString(testString, options);
+	BOOST_CHECK(state.isLoaded());
+
+	LuaState looping;
+	BOOST_CHECK_THROW(looping.loadString("while true do end", options), budget_exceeded_exception);
+	// closed like after any failed load
+	BOOST_CHECK(!looping.isLoaded());
+}
+BOOST_AUTO_TEST_CASE(timeBudget)
+{
+	LoadOptions options;
+	options.timeBudgetMs = 50;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	BOOST_CHECK_THROW(state.loadString("local i = 0 while true do i = i + 1 end", options), budget_exceeded_exception);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	BOOST_CHECK(seconds >= 0.05);
+	BOOST_CHECK(seconds < 5.0);
+	BOOST_CHECK(!state.isLoaded());
+}
+BOOST_AUTO_TEST_CASE(budgetWithProfiler)
+{
+	ScriptProfiler profiler(100);
+	LoadOptions options;
+	options.profiler = &profiler;
+	options.instructionBudget = 50000;
+	try
+	{
+		state.loadString("while true do end", options);
+		BOOST_ERROR("the budget did not stop the script");
+	}
+	catch (budget_exceeded_exception &e)
+	{
+		BOOST_CHECK(string(e.what()).find("instruction budget exceeded") != string::npos);
+	}
+	// the profiler kept its interval while the budget was checked
+	BOOST_CHECK(profiler.sampleCount() >= 400u);
+	BOOST_CHECK(profiler.sampleCount() <= 500u);
+}
+BOOST_AUTO_TEST_CASE(collectorPolicy)
+{
+	const string garbage = "for i = 1, 100000 do local t = { i } end data = { 1, 2, 3 }";
+	enableStats(true);
+	resetStats();
+	LuaState incremental;
+	incremental.loadString(garbage);
+	Stats counters = stats();
+	BOOST_CHECK_EQUAL(counters.gcTunedLoads, 0u);
+	BOOST_CHECK_EQUAL(counters.loadHeapBytes, incremental.heapSize());
+
+	LoadOptions options;
+	options.gcPolicy = GcPolicy::STOPPED;
+	options.expectedSourceBytes = 1 << 20;
+	LuaState stopped;
+	stopped.loadString(garbage, options);
+	// nothing was collected during the load
+	BOOST_CHECK_GT(stopped.heapSize(), incremental.heapSize() + 4 * 1024 * 1024);
+	BOOST_CHECK_EQUAL(stats().gcTunedLoads, 1u);
+#ifdef LUAPATH_LUA_INTERNALS
+	BOOST_CHECK_EQUAL(stats().stringTableSlots, 16384u);
+#endif
+	// the collector runs again for the next load
+	stopped.loadString(garbage);
+	stopped.collectGarbage();
+	BOOST_CHECK_LT(stopped.heapSize(), 1024u * 1024);
+	stopped.loadString(garbage);
+	BOOST_CHECK_LT(stopped.heapSize(), incremental.heapSize() * 4);
+
+	options = LoadOptions();
+	options.gcPolicy = GcPolicy::GENERATIONAL;
+	LuaState generational;
+	generational.loadString(garbage, options);
+	options = LoadOptions();
+	options.gcPause = 400;
+	LuaState paused;
+	paused.loadString(garbage, options);
+	enableStats(false);
+	BOOST_CHECK_EQUAL(stats().gcTunedLoads, 3u);
+	BOOST_CHECK_EQUAL((int)generational.getGlobalTable("data").getValue("#3"), 3);
+	BOOST_CHECK_EQUAL((int)paused.getGlobalTable("data").getValue("#3"), 3);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(dataLoader, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(sameAsSnapshot)
+{
+	Table parsed;
+	BOOST_REQUIRE(DataLoader::parse(testString, parsed));
+	state.loadString(testString);
+	std::ostringstream expected, actual;
+	expected << state.getGlobals();
+	actual << parsed;
+	BOOST_CHECK_EQUAL(actual.str(), expected.str());
+	BOOST_CHECK_EQUAL((string)parsed.getValue(".cars.honda.owner"), "Jack");
+	BOOST_CHECK_EQUAL((float)parsed.getValue(".company#1#3"), 3);
+}
+BOOST_AUTO_TEST_CASE(literals)
+{
+	string source = ""
+		"-- comment\n"
+		"s = { 'a\\tb\\65\\x43\\z   \n  d', [[\nline1\r\nline2]], [==[x]]y]==], \"\\\"q\\\"\" } --[[ block\n comment ]]\n"
+		"n = { 0x10, 1e2, -2.5, - 3, .5 }; flags = { true, false, nil, [5] = true }\n";
+	Table parsed;
+	BOOST_REQUIRE(DataLoader::parse(source, parsed));
+	LuaState lua;
+	lua.loadString(source);
+	std::ostringstream expected, actual;
+	expected << lua.getGlobals();
+	actual << parsed;
+	BOOST_CHECK_EQUAL(actual.str(), expected.str());
+	BOOST_CHECK_EQUAL((string)parsed.getValue(".s#1"), "a\tbACd");
+	BOOST_CHECK_EQUAL((string)parsed.getValue(".s#2"), "line1\nline2");
+	BOOST_CHECK_EQUAL((string)parsed.getValue(".s#3"), "x]]y");
+	BOOST_CHECK_EQUAL((float)parsed.getValue(".n#1"), 16);
+	BOOST_CHECK_EQUAL((float)parsed.getValue(".n#4"), -3);
+	BOOST_CHECK(!parsed.getTable(".flags").contains(Key(3)));
+}
+BOOST_AUTO_TEST_CASE(file)
+{
+	string path = "dataLoader.lua";
+	{
+		std::ofstream out(path.c_str(), std::ios::binary);
+		out << "\xEF\xBB\xBF#!/usr/bin/lua\n" << testString;
+	}
+	Table loaded = DataLoader::loadFile(path);
+	state.loadFile(path);
+	std::ostringstream expected, actual;
+	expected << state.getGlobals();
+	actual << loaded;
+	BOOST_CHECK_EQUAL(actual.str(), expected.str());
+	std::remove(path.c_str());
+}
+BOOST_AUTO_TEST_CASE(scanLevels)
+{
+	// runs crossing the 16 and 32 byte blocks of the vector scanners
+	string source = testString;
+	for (int length = 0; length < 70; ++length)
+	{
+		string padding(length, ' ');
+		source += "\ns" + std::to_string(length) + " = { \"" + string(length, 'a') + "\\n\\\"" + string(length % 7, 'b') + "\", "
+			+ "[[" + string(length, 'c') + "]]" + padding + ", 0x" + string(length % 9 + 1, 'F') + ", 1" + string(length % 20, '0') + ".5e-3"
+			+ " }" + padding + "-- " + string(length, '-') + "\n--[==[" + string(length, ']') + "]==]";
+	}
+	ScanLevel previous = scanLevel();
+	std::vector<string> printed;
+	for (int level = 0; level <= (int)supportedScanLevel(); ++level)
+	{
+		BOOST_CHECK(setScanLevel((ScanLevel)level) == (ScanLevel)level);
+		Table parsed;
+		BOOST_REQUIRE(DataLoader::parse(source, parsed));
+		std::ostringstream out;
+		out << parsed;
+		printed.push_back(out.str());
+		BOOST_CHECK_EQUAL(printed.back(), printed.front());
+	}
+	setScanLevel(previous);
+	LuaState lua;
+	lua.loadString(source);
+	std::ostringstream expected;
+	expected << lua.getGlobals();
+	BOOST_CHECK_EQUAL(printed.front(), expected.str());
+}
+BOOST_AUTO_TEST_CASE(notData)
+{
+	const char *sources[] = {
+		"x = f()",
+		"local a = 1",
+		"a = 1 + 2",
+		"a = { b = c }",
+		"a = { [1] = 1, 2 }",
+		"a = { b = 1, b = {} }",
+		"a = 1 a = nil",
+		"a = { [1.5] = 1 }",
+		"a = { [1e300] = 1 }",
+		"a = { [-1e999] = 1 }",
+		"a = { [2147483648] = 1 }",
+		"a = \"unfinished",
+		"a = { 1, 2"
+	};
+	for (const char *source : sources)
+	{
+		Table parsed;
+		BOOST_CHECK_MESSAGE(!DataLoader::parse(source, parsed), source);
+	}
+}
+BOOST_AUTO_TEST_CASE(fallback)
+{
+	Table globals = DataLoader::loadString("local base = 10 price = base * 2 t = { base, [1] = 3, 4 }");
+	BOOST_CHECK_EQUAL((float)globals.getValue(".price"), 20);
+	BOOST_CHECK_EQUAL((float)globals.getValue(".t#1"), 10);
+	BOOST_CHECK_EQUAL((float)globals.getValue(".t#2"), 4);
+	BOOST_CHECK(!globals.contains(Key("base")));
+	BOOST_CHECK_THROW(DataLoader::loadString("a = "), lua_state_exception);
+	BOOST_CHECK_THROW(DataLoader::loadFile("missing.lua"), lua_state_exception);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE(numberFormat);
+BOOST_AUTO_TEST_CASE(shortestText)
+{
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 40.8), "40.8");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 5.0), "5");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, -0.125), "-0.125");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 0.1 + 0.2), "0.30000000000000004");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 123456789012.0), "123456789012");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 1e300), "1e+300");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 40.8f), "40.8");
+	// beyond the integer fast path, laid out like printf's %g
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 9007199254740992.0), "9007199254740992");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 1e16), "1e+16");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 2.5e-10), "2.5e-10");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 5e-324), "5e-324");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 1.7976931348623157e308), "1.7976931348623157e+308");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 1.0 / 3), "0.3333333333333333");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 1e-10f), "1e-10");
+	BOOST_CHECK_EQUAL((string)Value(Value::Type::NUMBER, 3.4028235e38f), "3.4028235e+38");
+}
+BOOST_AUTO_TEST_CASE(randomRoundTrip)
+{
+	std::mt19937_64 random(2024);
+	int failures = 0;
+	for (int i = 0; i < 100000; ++i)
+	{
+		std::uint64_t bits = random();
+		double number;
+		std::memcpy(&number, &bits, sizeof(number));
+		std::uint32_t floatBits = (std::uint32_t)bits;
+		float single;
+		std::memcpy(&single, &floatBits, sizeof(single));
+		if (!std::isnan(number) && std::strtod(((string)Value(Value::Type::NUMBER, number)).c_str(), nullptr) != number)
+			++failures;
+		if (!std::isnan(single) && std::strtof(((string)Value(Value::Type::NUMBER, single)).c_str(), nullptr) != single)
+			++failures;
+	}
+	BOOST_CHECK_EQUAL(failures, 0);
+}
+BOOST_AUTO_TEST_CASE(roundTrip)
+{
+	const double numbers[] = { 0.1, 1.0 / 3, 2.0 / 3 * 1e-10, 6.02214076e23, -1.7976931348623157e308,
+		4.9406564584124654e-324, 9007199254740993.0, 3.14159265358979, -0.0 };
+	for (double number : numbers)
+	{
+		Value value(Value::Type::NUMBER, number);
+		BOOST_CHECK_MESSAGE((double)value == number, (string)value);
+		BOOST_CHECK_EQUAL(std::signbit((double)value), std::signbit(number));
+	}
+	BOOST_CHECK_EQUAL((double)Value(Value::Type::STRING, " 12.5e1x"), 125.0);
+	BOOST_CHECK_EQUAL((int)Value(Value::Type::NUMBER, -7.9), -7);
+	BOOST_CHECK_THROW((double)Value(Value::Type::STRING, "hello"), type_mismatch_exception);
+	BOOST_CHECK_THROW((int)Value(Value::Type::NUMBER, 1e20), type_mismatch_exception);
+}
+BOOST_AUTO_TEST_CASE(snapshotKeepsDoubles)
+{
+	string source = "v = { 0.1, 3.14159265358979, 16777217, 1e-7, 2^60 }";
+	LuaState state;
+	state.loadString(source);
+	Table snapshot = state.getGlobalTable("v");
+	BOOST_CHECK_EQUAL((double)snapshot.getValue("#1"), 0.1);
+	BOOST_CHECK_EQUAL((double)snapshot.getValue("#2"), 3.14159265358979);
+	BOOST_CHECK_EQUAL((string)snapshot.getValue("#3"), "16777217");
+	BOOST_CHECK_EQUAL((double)snapshot.getValue("#4"), 1e-7);
+	BOOST_CHECK_EQUAL((double)snapshot.getValue("#5"), 1152921504606846976.0);
+	std::vector<double> array = snapshot.toArray<double>();
+	BOOST_REQUIRE_EQUAL(array.size(), 5u);
+	BOOST_CHECK_EQUAL(array[2], 16777217.0);
+
+	Table parsed;
+	BOOST_REQUIRE(DataLoader::parse("v = { 0.1, 3.14159265358979, 16777217, 1e-7, 0x1p60 }", parsed));
+	std::ostringstream expected, actual;
+	expected << snapshot;
+	actual << parsed.getTable(".v");
+	BOOST_CHECK_EQUAL(actual.str(), expected.str());
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(tryLookups, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(tryGetValueAndTable)
+{
+	Table company = state.getGlobalTable("company");
+	const Value *city = company.tryGetValue(".buildings#2.city");
+	BOOST_REQUIRE(city);
+	BOOST_CHECK_EQUAL((string)*city, "Carlow");
+	const Table *buildings = company.tryGetTable(".buildings");
+	BOOST_REQUIRE(buildings);
+	BOOST_CHECK_EQUAL(buildings->size(), 2u);
+	BOOST_CHECK_EQUAL(company.tryGetTable(""), &company);
+
+	LookupResult result;
+	BOOST_CHECK(!company.tryGetValue(".buildings#1.manager", &result));
+	BOOST_CHECK(result.status == LookupStatus::NOT_FOUND);
+	BOOST_CHECK_EQUAL(result.segment, 2u);
+	BOOST_CHECK_EQUAL(string(".buildings#1.manager", result.offset, result.length), ".manager");
+
+	BOOST_CHECK(!company.tryGetValue(".what.really", &result));
+	BOOST_CHECK(result.status == LookupStatus::NOT_A_TABLE);
+	BOOST_CHECK_EQUAL(result.segment, 0u);
+	BOOST_CHECK(!company.tryGetValue(".buildings#1", &result));
+	BOOST_CHECK(result.status == LookupStatus::NOT_A_VALUE);
+	BOOST_CHECK_EQUAL(result.segment, 1u);
+	BOOST_CHECK(!company.tryGetValue(".buildings#x", &result));
+	BOOST_CHECK(result.status == LookupStatus::INVALID_PATH);
+	BOOST_CHECK_EQUAL(result.offset, 10u);
+	BOOST_CHECK(!company.tryGetValue("what", &result));
+	BOOST_CHECK(result.status == LookupStatus::INVALID_PATH);
+	BOOST_CHECK(!company.tryGetValue("", &result));
+	BOOST_CHECK(result.status == LookupStatus::EMPTY_PATH);
+	BOOST_CHECK_EQUAL(toString(LookupStatus::NOT_A_TABLE), string("NOT_A_TABLE"));
+
+	// the throwing lookups fail the same way
+	BOOST_CHECK_THROW(company.getValue(".buildings#x"), path_lookup_exception);
+	BOOST_CHECK_THROW(company.getTable(".what"), path_lookup_exception);
+}
+BOOST_AUTO_TEST_CASE(getOrAndContains)
+{
+	Table company = state.getGlobalTable("company");
+	BOOST_CHECK_EQUAL(company.getOr(".established", 0), 2014);
+	BOOST_CHECK_EQUAL(company.getOr(".missing", 7), 7);
+	BOOST_CHECK_EQUAL(company.getOr(".what", 7), 7);
+	BOOST_CHECK_EQUAL(company.getOr(".buildings#1.revenue", 0.0), 5.0);
+	BOOST_CHECK_EQUAL(company.getOr(".buildings#1.revenue", 1.5f), 5.0f);
+	BOOST_CHECK_EQUAL(company.getOr(".good", false), true);
+	BOOST_CHECK_EQUAL(company.getOr(".established", true), true);
+	BOOST_CHECK_EQUAL(company.getOr(".what", "none"), "Business");
+	BOOST_CHECK_EQUAL(company.getOr(".buildings#3.city", string("none")), "none");
+
+	BOOST_CHECK(company.contains(".buildings#1.bosses#2"));
+	BOOST_CHECK(company.contains(".buildings"));
+	BOOST_CHECK(!company.contains(".buildings#3"));
+	BOOST_CHECK(!company.contains("buildings"));
+	BOOST_CHECK(company.contains(Key("buildings")));
+
+	Value value;
+	BOOST_CHECK(state.tryGetGlobalValue("str1", value) == LookupStatus::FOUND);
+	BOOST_CHECK_EQUAL((string)value, "hello");
+	BOOST_CHECK(state.tryGetGlobalValue("missing", value) == LookupStatus::NOT_FOUND);
+	BOOST_CHECK(state.tryGetGlobalValue("company", value) == LookupStatus::NOT_A_VALUE);
+}
+BOOST_AUTO_TEST_CASE(noAllocations)
+{
+	Table superStructure = state.getGlobalTable("superStructure");
+	string hit = "#1.level2#3.4.5";
+	string miss = "#1.level2#3.4.6";
+	string missingTable = "#1.level2.arrays#12";
+	string fallback(64, 'f');
+	Value value;
+	state.tryGetGlobalValue("N1", value);
+	AllocationCounter counter;
+	BOOST_CHECK(superStructure.tryGetValue(hit));
+	BOOST_CHECK(!superStructure.tryGetValue(miss));
+	BOOST_CHECK(!superStructure.tryGetTable(missingTable));
+	BOOST_CHECK(superStructure.contains(hit));
+	BOOST_CHECK_EQUAL(superStructure.getOr(miss, 3), 3);
+	BOOST_CHECK(&superStructure.getOr(miss, fallback) == &fallback);
+	BOOST_CHECK(&superStructure.getOr(hit, fallback) != &fallback);
+	BOOST_CHECK(superStructure.getOr(miss, "longer than the small string buffer of std::string") != nullptr);
+	BOOST_CHECK(superStructure.getOr(hit, "longer than the small string buffer of std::string") != nullptr);
+	BOOST_CHECK(state.tryGetGlobalValue("missing", value) == LookupStatus::NOT_FOUND);
+	BOOST_CHECK(state.tryGetGlobalValue("N1", value) == LookupStatus::FOUND);
+	BOOST_CHECK_EQUAL(counter.count(), 0u);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(persistentTable, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(withAndWithout)
+{
+	Table company = state.getGlobalTable("company");
+	PersistentTable original(company);
+	BOOST_CHECK_EQUAL(original.size(), company.size());
+	BOOST_CHECK_EQUAL((string)original.getValue(".buildings#2.city"), "Carlow");
+
+	PersistentTable edited = original.with(".buildings#2.city", Value(Value::Type::STRING, "Cork"))
+		.with(".address.street", Value(Value::Type::STRING, "Main"))
+		.without(".what");
+	BOOST_CHECK_EQUAL((string)edited.getValue(".buildings#2.city"), "Cork");
+	BOOST_CHECK_EQUAL((string)edited.getValue(".address.street"), "Main");
+	BOOST_CHECK(!edited.contains(".what"));
+	BOOST_CHECK_EQUAL(edited.size(), original.size());
+
+	// the original version is untouched
+	BOOST_CHECK_EQUAL((string)original.getValue(".buildings#2.city"), "Carlow");
+	BOOST_CHECK_EQUAL((string)original.getValue(".what"), "Business");
+	BOOST_CHECK(!original.contains(".address"));
+
+	// removing something missing gives the same version
+	BOOST_CHECK(original.without(".missing").sameVersion(original));
+	BOOST_CHECK(original.without(".what.really").sameVersion(original));
+	BOOST_CHECK(!original.without(".what").sameVersion(original));
+
+	BOOST_CHECK_THROW(original.with(".what.really", Value(Value::Type::NUMBER, 1.0)), path_lookup_exception);
+	BOOST_CHECK_THROW(original.with("what", Value(Value::Type::NUMBER, 1.0)), path_lookup_exception);
+	BOOST_CHECK_THROW(original.with(".buildings#x", Value(Value::Type::NUMBER, 1.0)), path_lookup_exception);
+	BOOST_CHECK_THROW(original.without(""), path_lookup_exception);
+
+	PersistentTable buildings = edited.getTable(".buildings");
+	PersistentTable moved = PersistentTable().with(".copy", buildings);
+	BOOST_CHECK(moved.getTable(".copy").sameVersion(buildings));
+	BOOST_CHECK_EQUAL((string)moved.getValue(".copy#2.city"), "Cork");
+}
+BOOST_AUTO_TEST_CASE(toTableRoundTrip)
+{
+	Table company = state.getGlobalTable("company");
+	std::ostringstream expected, actual;
+	expected << company;
+	actual << PersistentTable(company).toTable(company.getKey());
+	BOOST_CHECK_EQUAL(actual.str(), expected.str());
+
+	Table superStructure = state.getGlobalTable("superStructure");
+	Table copy = PersistentTable(superStructure).toTable();
+	BOOST_CHECK_EQUAL((string)copy.getValue("#1.level2#3.4.5"), (string)superStructure.getValue("#1.level2#3.4.5"));
+}
+BOOST_AUTO_TEST_CASE(lookups)
+{
+	PersistentTable company(state.getGlobalTable("company"));
+	LookupResult result;
+	BOOST_CHECK(!company.tryGetValue(".buildings#1.manager", &result));
+	BOOST_CHECK(result.status == LookupStatus::NOT_FOUND);
+	BOOST_CHECK_EQUAL(result.segment, 2u);
+	BOOST_CHECK(!company.tryGetValue(".buildings#1", &result));
+	BOOST_CHECK(result.status == LookupStatus::NOT_A_VALUE);
+	BOOST_CHECK(!company.tryGetValue(".buildings#x", &result));
+	BOOST_CHECK(result.status == LookupStatus::INVALID_PATH);
+	BOOST_CHECK_EQUAL(company.tryGetTable(""), &company);
+	BOOST_CHECK(company.contains(".buildings#1.bosses#2"));
+	BOOST_CHECK_THROW(company.getValue(".what.really"), path_lookup_exception);
+	BOOST_CHECK_THROW(company.getTable(".what"), path_lookup_exception);
+
+	string hit = ".buildings#2.city";
+	AllocationCounter counter;
+	BOOST_CHECK(company.tryGetValue(hit));
+	BOOST_CHECK(!company.tryGetValue(".buildings#3"));
+	BOOST_CHECK_EQUAL(counter.count(), 0u);
+}
+BOOST_AUTO_TEST_CASE(manyKeys)
+{
+	// enough keys for several trie levels and for the number and string hashes to collide in the first levels
+	const int count = 5000;
+	PersistentTable table;
+	for (int i = 0; i < count; ++i)
+		table = table.with("#" + std::to_string(i - count / 2), Value(Value::Type::NUMBER, (double)i)).with(".k" + std::to_string(i), Value(Value::Type::NUMBER, (double)-i));
+	BOOST_REQUIRE_EQUAL(table.size(), 2u * count);
+	PersistentTable full = table;
+	for (int i = 0; i < count; i += 2)
+		table = table.without("#" + std::to_string(i - count / 2)).without(".k" + std::to_string(i));
+	BOOST_REQUIRE_EQUAL(table.size(), (std::size_t)count);
+	for (int i = 0; i < count; ++i)
+	{
+		bool kept = i % 2 == 1;
+		BOOST_CHECK_EQUAL(table.contains("#" + std::to_string(i - count / 2)), kept);
+		BOOST_CHECK_EQUAL(table.contains(".k" + std::to_string(i)), kept);
+		BOOST_CHECK_EQUAL((int)full.getValue(".k" + std::to_string(i)), -i);
+	}
+	std::size_t visited = 0;
+	table.forEach([&visited](const Key &, const Value *value, const PersistentTable *) { visited += value ? 1 : 0; });
+	BOOST_CHECK_EQUAL(visited, (std::size_t)count);
+
+	Table ordered = table.toTable();
+	BOOST_CHECK_EQUAL(ordered.size(), (std::size_t)count);
+	BOOST_CHECK_EQUAL((int)ordered.getValue("#" + std::to_string(1 - count / 2)), 1);
+	for (int i = 0; i < count; ++i)
+		table = table.without("#" + std::to_string(i - count / 2)).without(".k" + std::to_string(i));
+	BOOST_CHECK(table.empty());
+}
+BOOST_AUTO_TEST_CASE(editSharesUntouchedNodes)
+{
+	luaStateLargeFixture large;
+	PersistentTable table(large.state.getGlobalTable("large"));
+	std::size_t allocations;
+	PersistentTable edited;
+	{
+		AllocationCounter counter;
+		edited = table.with("#42.value", Value(Value::Type::NUMBER, 7.0));
+		allocations = counter.count();
+	}
+	BOOST_TEST_MESSAGE("allocations for an edit of a table with 20000 entries: " << allocations);
+	// the nodes on the way down both tables, the new fields and the parsed path
+	BOOST_CHECK_LE(allocations, 20u);
+	BOOST_CHECK_EQUAL((int)edited.getValue("#42.value"), 7);
+	BOOST_CHECK_EQUAL((int)table.getValue("#42.value"), 42);
+	BOOST_CHECK(edited.getTable("#43").sameVersion(table.getTable("#43")));
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(tableEdits, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(setAndErase)
+{
+	TableEdit edit = state.editGlobalTable("company");
+	edit.set(".what", Value(Value::Type::STRING, "Retail"))
+		.set(".buildings#2.city", Value(Value::Type::STRING, "Cork"))
+		.set(".buildings#2.floors", Value(Value::Type::NUMBER, 12.5))
+		.set(".address.street#3", Value(Value::Type::BOOL, true))
+		.erase(".really")
+		.erase(".buildings#1.bosses")
+		.erase(".missing.field");
+	BOOST_CHECK_EQUAL(edit.size(), 7u);
+	// nothing is written before apply
+	BOOST_CHECK_EQUAL((string)state.getGlobalTable("company").getValue(".what"), "Business");
+	edit.apply();
+	BOOST_CHECK(edit.empty());
+
+	Table company = state.getGlobalTable("company");
+	BOOST_CHECK_EQUAL((string)company.getValue(".what"), "Retail");
+	BOOST_CHECK_EQUAL((string)company.getValue(".buildings#2.city"), "Cork");
+	BOOST_CHECK_EQUAL((double)company.getValue(".buildings#2.floors"), 12.5);
+	BOOST_CHECK_EQUAL((bool)company.getValue(".address.street#3"), true);
+	BOOST_CHECK(!company.contains(".really"));
+	BOOST_CHECK(!company.contains(".buildings#1.bosses"));
+	// the rest is untouched
+	BOOST_CHECK_EQUAL((int)company.getValue(".established"), 2014);
+	BOOST_CHECK_EQUAL((string)company.getValue(".buildings#1.city"), "Dublin");
+
+	TableEdit globals = state.editGlobalTable("");
+	globals.set(".N1", Value(Value::Type::NUMBER, 6.0)).erase(".str1").set(".fresh.x", Value(Value::Type::NUMBER, 1.0));
+	globals.apply();
+	BOOST_CHECK_EQUAL((int)state.getGlobalValue("N1"), 6);
+	Value removed;
+	BOOST_CHECK(state.tryGetGlobalValue("str1", removed) == LookupStatus::NOT_FOUND);
+	BOOST_CHECK_EQUAL((int)state.getGlobalTable("fresh").getValue(".x"), 1);
+
+	TableEdit created = state.editGlobalTable("created");
+	created.set("#1", Value(Value::Type::STRING, "a")).apply();
+	BOOST_CHECK_EQUAL((string)state.getGlobalTable("created").getValue("#1"), "a");
+}
+BOOST_AUTO_TEST_CASE(failures)
+{
+	TableEdit edit = state.editGlobalTable("company");
+	BOOST_CHECK_THROW(edit.set("", Value(Value::Type::NUMBER, 1.0)), path_lookup_exception);
+	BOOST_CHECK_THROW(edit.set(".a#x", Value(Value::Type::NUMBER, 1.0)), path_lookup_exception);
+	BOOST_CHECK_THROW(edit.set(".a", Value(Value::Type::TABLE, "->")), type_mismatch_exception);
+	BOOST_CHECK(edit.empty());
+
+	// a value in the way stops the batch at that change
+	edit.set(".established", Value(Value::Type::NUMBER, 2015.0))
+		.set(".what.really", Value(Value::Type::NUMBER, 1.0))
+		.set(".sector", Value(Value::Type::STRING, "Retail"));
+	BOOST_CHECK_THROW(edit.apply(), path_lookup_exception);
+	BOOST_CHECK_EQUAL(edit.size(), 2u);
+	Table company = state.getGlobalTable("company");
+	BOOST_CHECK_EQUAL((int)company.getValue(".established"), 2015);
+	BOOST_CHECK_EQUAL((string)company.getValue(".sector"), "Construction");
+
+	TableEdit notATable = state.editGlobalTable("str1");
+	notATable.set(".a", Value(Value::Type::NUMBER, 1.0));
+	BOOST_CHECK_THROW(notATable.apply(), type_mismatch_exception);
+	BOOST_CHECK_EQUAL((string)state.getGlobalValue("str1"), "hello");
+}
+BOOST_AUTO_TEST_CASE(largeBatch)
+{
+	TableEdit edit = state.editGlobalTable("tuning");
+	for (int i = 1; i <= 500; ++i)
+		edit.set("#" + std::to_string(i % 10) + ".value#" + std::to_string(i), Value(Value::Type::NUMBER, (double)i));
+	edit.apply();
+	Table tuning = state.getGlobalTable("tuning");
+	BOOST_CHECK_EQUAL(tuning.size(), 10u);
+	BOOST_CHECK_EQUAL((int)tuning.getValue("#3.value#123"), 123);
+	BOOST_CHECK_EQUAL(tuning.getTable("#0.value").size(), 50u);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(luaWriter, luaStateLoadedFixture);
+BOOST_AUTO_TEST_CASE(reloadsToSameTable)
+{
+	const WriteStyle styles[] = { WriteStyle::COMPACT, WriteStyle::PRETTY };
+	const char *names[] = { "cars", "company", "superStructure", "t1", "table1" };
+	for (WriteStyle style : styles)
+	{
+		for (const char *name : names)
+		{
+			Table table = state.getGlobalTable(name);
+			string source = LuaWriter::toString(table, style);
+			LuaState reloaded;
+			reloaded.loadString(source);
+			BOOST_REQUIRE(reloaded.isLoaded());
+			std::ostringstream expected, actual;
+			expected << table;
+			actual << reloaded.getGlobalTable(name);
+			BOOST_CHECK_EQUAL(actual.str(), expected.str());
+		}
+	}
+
+	Table globals = state.getGlobals();
+	LuaState reloaded;
+	reloaded.loadString(LuaWriter::toString(globals, WriteStyle::COMPACT));
+	std::ostringstream expected, actual;
+	expected << globals;
+	actual << reloaded.getGlobals();
+	BOOST_CHECK_EQUAL(actual.str(), expected.str());
+}
+BOOST_AUTO_TEST_CASE(format)
+{
+	LuaState source;
+	source.loadString("t = { 10, 20, [4] = 40, name = \"a\", [\"not a name\"] = true, [\"end\"] = 1.5, nested = {} }");
+	Table t = source.getGlobalTable("t");
+	BOOST_CHECK_EQUAL(LuaWriter::toString(t, WriteStyle::COMPACT),
+		"t={10,20,[4]=40,[\"end\"]=1.5,name=\"a\",nested={},[\"not a name\"]=true}\n");
+	BOOST_CHECK_EQUAL(LuaWriter::toString(t.getTable(".nested"), WriteStyle::PRETTY), "nested = {}\n");
+
+	std::ostringstream pretty;
+	StreamSink sink(pretty);
+	LuaWriter::write(t, sink, WriteStyle::PRETTY);
+	BOOST_CHECK_EQUAL(pretty.str(),
+		"t = {\n\t10,\n\t20,\n\t[4] = 40,\n\t[\"end\"] = 1.5,\n\tname = \"a\",\n\tnested = {},\n\t[\"not a name\"] = true,\n}\n");
+}
+BOOST_AUTO_TEST_CASE(escapesAndSpecialNumbers)
+{
+	LuaState source;
+	source.loadString("s = { quote = \"a\\\"b\\\\c\", lines = \"x\\n\\r\\ty\", bin = \"\\0\\1\\0012\\127\\200\", "
+		"big = 1e300 * 1e300, small = -1e300 * 1e300, [-3] = 0.1 }");
+	Table s = source.getGlobalTable("s");
+	string text = LuaWriter::toString(s, WriteStyle::COMPACT);
+	BOOST_CHECK(text.find("big=1/0") != string::npos);
+	BOOST_CHECK(text.find("small=-1/0") != string::npos);
+	BOOST_CHECK(text.find("bin=\"\\000\\001\\0012\\127\310\"") != string::npos);
+	LuaState reloaded;
+	reloaded.loadString(text);
+	Table copy = reloaded.getGlobalTable("s");
+	BOOST_CHECK_EQUAL((string)copy.getValue(".quote"), "a\"b\\c");
+	BOOST_CHECK_EQUAL((string)copy.getValue(".lines"), "x\n\r\ty");
+	BOOST_CHECK_EQUAL((string)copy.getValue(".bin"), string("\0\1\0012\177\310", 6));
+	BOOST_CHECK_EQUAL((double)copy.getValue("#-3"), 0.1);
+	BOOST_CHECK(std::isinf((double)copy.getValue(".big")));
+}
+BOOST_AUTO_TEST_CASE(chunks)
+{
+	LuaState large;
+	string text;
+	for (int i = 0; i < 5000; ++i)
+		text += "\"item" + std::to_string(i) + "\",";
+	large.loadString("big = {" + text + "}");
+	std::size_t chunks = 0;
+	string joined;
+	CallbackSink sink([&chunks, &joined](const char *data, std::size_t length) {
+		++chunks;
+		joined.append(data, length);
+	});
+	LuaWriter::write(large.getGlobalTable("big"), sink, WriteStyle::COMPACT);
+	BOOST_CHECK_GT(chunks, 1u);
+	BOOST_CHECK_EQUAL(joined, "big={" + text.substr(0, text.size() - 1) + "}\n");
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(exports, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(json)
+{
+	state.loadString("arr = { 10, 20.5, \"a\\\"b\\n\\1\", true, { x = 1 } } "
+		"sparse = { [2] = 1, [5] = 2 } empty = {} odd = { 1/0, 0/0, name = \"n\" } "
+		"nested = { list = { { 1, 2 }, {} }, flag = false }");
+	BOOST_CHECK_EQUAL(JsonWriter::toString(state.getGlobalTable("arr")), "[10,20.5,\"a\\\"b\\n\\u0001\",true,{\"x\":1}]");
+	BOOST_CHECK_EQUAL(JsonWriter::toString(state.getGlobalTable("sparse")), "{\"2\":1,\"5\":2}");
+	BOOST_CHECK_EQUAL(JsonWriter::toString(state.getGlobalTable("empty")), "{}");
+	BOOST_CHECK_EQUAL(JsonWriter::toString(state.getGlobalTable("odd")), "{\"1\":null,\"2\":null,\"name\":\"n\"}");
+	BOOST_CHECK_EQUAL(JsonWriter::toString(state.getGlobalTable("nested"), WriteStyle::PRETTY),
+		"{\n\t\"flag\": false,\n\t\"list\": [\n\t\t[\n\t\t\t1,\n\t\t\t2\n\t\t],\n\t\t{}\n\t]\n}");
+
+	// straight from the state the arrays and single field objects come out the same
+	const char *names[] = { "arr", "empty", "nested" };
+	for (const char *name : names)
+	{
+		string live;
+		StringSink sink(live);
+		JsonWriter::write(state, name, sink);
+		if (string(name) != "nested")
+			BOOST_CHECK_EQUAL(live, JsonWriter::toString(state.getGlobalTable(name)));
+		else
+			BOOST_CHECK_EQUAL(live.size(), JsonWriter::toString(state.getGlobalTable(name)).size());
+	}
+
+	string ignored;
+	StringSink sink(ignored);
+	BOOST_CHECK_THROW(JsonWriter::write(state, "missing", sink), path_lookup_exception);
+	state.loadString("cyclic = { } cyclic.self = cyclic");
+	BOOST_CHECK_THROW(JsonWriter::write(state, "cyclic", sink), lua_state_exception);
+	// the stack was cleaned up
+	BOOST_CHECK_EQUAL(JsonWriter::toString(state.getGlobalTable("sparse")), "{\"2\":1,\"5\":2}");
+}
+BOOST_AUTO_TEST_CASE(messagePack)
+{
+	state.loadString("values = { 1, -1, 200, -200, 70000, 1.5, \"ab\", true, false } map = { a = 1 } "
+		"long = { s = \"" + string(40, 'x') + "\" } big = { 1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16 }");
+	const unsigned char expected[] = {
+		0x99, 0x01, 0xff, 0xcc, 0xc8, 0xd1, 0xff, 0x38, 0xce, 0x00, 0x01, 0x11, 0x70,
+		0xcb, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0, 0xa2, 'a', 'b', 0xc3, 0xc2 };
+	string values = MessagePackWriter::toString(state.getGlobalTable("values"));
+	BOOST_CHECK(values == string((const char*)expected, sizeof(expected)));
+	BOOST_CHECK(MessagePackWriter::toString(state.getGlobalTable("map")) == string("\x81\xa1" "a\x01", 4));
+	string longString = MessagePackWriter::toString(state.getGlobalTable("long"));
+	BOOST_CHECK(longString.substr(0, 5) == string("\x81\xa1s\xd9\x28", 5));
+	BOOST_CHECK_EQUAL(longString.size(), 45u);
+	string big = MessagePackWriter::toString(state.getGlobalTable("big"));
+	BOOST_CHECK(big.substr(0, 4) == string("\xdc\x00\x10\x01", 4));
+
+	string live;
+	StringSink sink(live);
+	MessagePackWriter::write(state, "values", sink);
+	BOOST_CHECK(live == values);
+}
+BOOST_AUTO_TEST_CASE(boundedChunks)
+{
+	string source = "big = {";
+	for (int i = 0; i < 20000; ++i)
+		source += "{ name = \"item" + std::to_string(i) + "\", value = " + std::to_string(i) + ".25 },";
+	state.loadString(source + "}");
+	std::size_t largest = 0;
+	std::size_t total = 0;
+	CallbackSink sink([&largest, &total](const char *, std::size_t length) {
+		largest = std::max(largest, length);
+		total += length;
+	});
+	JsonWriter::write(state, "big", sink, WriteStyle::PRETTY);
+	BOOST_CHECK_GT(total, 32u * 1024);
+	BOOST_CHECK_LE(largest, 32u * 1024);
+	MessagePackWriter::write(state, "big", sink);
+	BOOST_CHECK_LE(largest, 32u * 1024);
+}
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_FIXTURE_TEST_SUITE(jsonReader, luaStateInitFixture);
+BOOST_AUTO_TEST_CASE(mapping)
+{
+	Table data = JsonReader::parse("{ \"name\": \"n\", \"list\": [10, 20.5, -3e2, true, { \"x\": false }],\n"
+		"\"empty\": {}, \"none\": [], \"nested\": { \"a\": { \"b\": [[1], [2]] } } }", Key("data"));
+	BOOST_CHECK_EQUAL(data.getValue(".name"), Value(Value::Type::STRING, "n"));
+	BOOST_CHECK_EQUAL(data.getValue(".list#1"), Value(Value::Type::NUMBER, 10.0));
+	BOOST_CHECK_EQUAL(data.getValue(".list#2"), Value(Value::Type::NUMBER, 20.5));
+	BOOST_CHECK_EQUAL(data.getValue(".list#3"), Value(Value::Type::NUMBER, -300.0));
+	BOOST_CHECK_EQUAL(data.getValue(".list#4"), Value(Value::Type::BOOL, true));
+	BOOST_CHECK_EQUAL(data.getValue(".list#5.x"), Value(Value::Type::BOOL, false));
+	BOOST_CHECK_EQUAL(data.getValue(".nested.a.b#2#1"), Value(Value::Type::NUMBER, 2.0));
+	BOOST_CHECK(data.getTable(".empty").empty());
+	BOOST_CHECK(data.getTable(".none").empty());
+
+	// the same data loaded through lua gives the same table
+	state.loadString("data = { name = \"n\", list = { 10, 20.5, -3e2, true, { x = false } }, "
+		"empty = {}, none = {}, nested = { a = { b = { { 1 }, { 2 } } } } }");
+	BOOST_CHECK_EQUAL(LuaWriter::toString(data), LuaWriter::toString(state.getGlobalTable("data")));
+
+	Table array = JsonReader::parse(" [\"a\", null, \"c\"] ");
+	BOOST_CHECK_EQUAL(array.getValue("#1"), Value(Value::Type::STRING, "a"));
+	BOOST_CHECK(!array.contains("#2"));
+	BOOST_CHECK_EQUAL(array.getValue("#3"), Value(Value::Type::STRING, "c"));
+	BOOST_CHECK(!JsonReader::parse("{\"a\": null}").contains(".a"));
+	// the last of repeated names wins
+	BOOST_CHECK_EQUAL(JsonReader::parse("{\"a\": 1, \"a\": 2}").getValue(".a"), Value(Value::Type::NUMBER, 2.0));
+	// a null after a value removes the name like a nil in lua
+	Table repeated = JsonReader::parse("{\"a\": 1, \"a\": null, \"b\": null, \"b\": 2, \"c\": 3, \"c\": 4}");
+	BOOST_CHECK(!repeated.contains(".a"));
+	BOOST_CHECK_EQUAL(repeated.getValue(".b"), Value(Value::Type::NUMBER, 2.0));
+	BOOST_CHECK_EQUAL(repeated.getValue(".c"), Value(Value::Type::NUMBER, 4.0));
+	BOOST_CHECK_EQUAL(repeated.size(), 2u);
+}
+BOOST_AUTO_TEST_CASE(strings)
+{
+	Table table = JsonReader::parse("[\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\", \"\\u0041\\u00e9\\u20ac\\ud83d\\ude00\", \"\xEF\xBB\xBF\"]");
+	BOOST_CHECK_EQUAL(table.getValue("#1"), Value(Value::Type::STRING, "a\"b\\c/d\b\f\n\r\t"));
+	BOOST_CHECK_EQUAL(table.getValue("#2"), Value(Value::Type::STRING, "A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"));
+	BOOST_CHECK_EQUAL(table.getValue("#3"), Value(Value::Type::STRING, "\xEF\xBB\xBF"));
+	// a byte order mark before the document is skipped
+	BOOST_CHECK_EQUAL(JsonReader::parse("\xEF\xBB\xBF[1]").getValue("#1"), Value(Value::Type::NUMBER, 1.0));
+
+	// JsonWriter output reads back to the same table
+	state.loadString("data = { s = \"q\\\"\\n\\1\", list = { 1, 2.5, false, { deep = \"x\" } }, e = {}, [\"k y\"] = 1e300 }");
+	Table original = state.getGlobalTable("data");
+	string json = JsonWriter::toString(original);
+	BOOST_CHECK_EQUAL(LuaWriter::toString(JsonReader::parse(json, Key("data"))), LuaWriter::toString(original));
+	BOOST_CHECK_EQUAL(LuaWriter::toString(JsonReader::parse(JsonWriter::toString(original, WriteStyle::PRETTY), Key("data"))),
+		LuaWriter::toString(original));
+}
+BOOST_AUTO_TEST_CASE(errors)
+{
+	const char *invalid[] = { "", "1", "\"s\"", "null", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{a: 1}", "[01]", "[1.]",
+		"[.5]", "[+1]", "[1e]", "[tru]", "[\"a]", "[\"a\nb\"]", "[\"a\tb\"]", "[\"\x01\"]",
+		"[\"0123456789abcdef0123456789abcdef\x1f\"]", "[\"\\x\"]", "[\"\\u12\"]", "[\"\\ud800\"]",
+		"[\"\\udc00\"]", "[] []", "{\"a\": 1, \"a\": {}}", "{\"a\": {}, \"a\": null}" };
+	ScanLevel previous = scanLevel();
+	for (int level = 0; level <= (int)supportedScanLevel(); ++level)
+	{
+		setScanLevel((ScanLevel)level);
+		for (const char *json : invalid)
+			BOOST_CHECK_THROW(JsonReader::parse(json), json_parse_exception);
+		// DEL and bytes of UTF-8 sequences are not control characters
+		BOOST_CHECK_EQUAL(JsonReader::parse("[\"0123456789abcdef0123456789abcdef\x7f\xc3\xa9\"]").getValue("#1"),
+			Value(Value::Type::STRING, "0123456789abcdef0123456789abcdef\x7f\xc3\xa9"));
+	}
+	setScanLevel(previous);
+
+	try
+	{
+		JsonReader::parse("{\n  \"a\": [1, 2,\n  x] }");
+		BOOST_FAIL("no exception");
+	}
+	catch (const json_parse_exception &e)
+	{
+		BOOST_CHECK_EQUAL(e.offset(), 18u);
+		BOOST_CHECK(string(e.what()).find("line 3, column 3") != string::npos);
+	}
+
+	string deep(2000, '[');
+	BOOST_CHECK_THROW(JsonReader::parse(deep + string(2000, ']')), json_parse_exception);
+	BOOST_CHECK_THROW(JsonReader::loadFile("no/such/file.json"), json_parse_exception);
+}
+BOOST_AUTO_TEST_SUITE_END();
@@ -1 +1,12 @@
 #include "utils.hpp"
+#include "AllocationCounting.hpp"
+
+AllocationCounter::AllocationCounter()
+	: start((std::size_t)threadAllocationCount())
+{
+}
+
+std::size_t AllocationCounter::count() const
+{
+	return (std::size_t)threadAllocationCount() - start;
+}
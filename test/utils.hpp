@@ -9,5 +9,15 @@
 #include <iostream>
 #include <iomanip>
 
+/** @brief Counts the calls to the global operator new made by the current thread
+	since the counter was constructed*/
+class AllocationCounter
+{
+public:
+	AllocationCounter();
+	std::size_t count() const;
+private:
+	std::size_t start;
+};
 
 #endif // !UTILS_HPP